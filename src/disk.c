@@ -0,0 +1,327 @@
+/* disk.c
+ * Disk request queue, seek model and I/O schedulers (see disk.h).
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "disk.h"
+
+static const char *sched_names[] = {"fifo", "sstf", "scan", "deadline"};
+
+const char *disk_sched_name(disk_sched_t sched)
+{
+    return sched <= DISK_DEADLINE ? sched_names[sched] : "?";
+}
+
+/* One unsigned field of a spec, at most 'max'; advances *s past it */
+static int parse_field(const char **s, uint64_t max, uint64_t *out)
+{
+    char *end;
+    if (**s < '0' || **s > '9')
+        return -1;
+    unsigned long long v = strtoull(*s, &end, 10);
+    if (v > max)
+        return -1;
+    *out = v;
+    *s = end;
+    return 0;
+}
+
+int disk_parse(const char *spec, disk_cfg_t *out)
+{
+    disk_cfg_t c = {0, DISK_FIFO, 0, 0, DISK_READ_EXPIRE_NS, DISK_WRITE_EXPIRE_NS};
+    size_t name_len = strcspn(spec, ":");
+    const char *args = spec[name_len] == ':' ? spec + name_len + 1 : NULL;
+
+    if (name_len == 4 && strncmp(spec, "none", 4) == 0)
+    {
+        if (args)
+            return -1;
+        *out = c;
+        return 0;
+    }
+    int sched = -1;
+    for (int i = 0; i <= DISK_DEADLINE; ++i)
+        if (strlen(sched_names[i]) == name_len && strncmp(spec, sched_names[i], name_len) == 0)
+            sched = i;
+    if (sched < 0)
+        return -1;
+    c.enabled = 1;
+    c.sched = (disk_sched_t)sched;
+    uint64_t v[4] = {DISK_SEEK_MIN_NS, DISK_SEEK_MAX_NS, c.read_expire_ns, c.write_expire_ns};
+    for (int i = 0; args && i < 4; i++)
+    {
+        if (*args != ',' && parse_field(&args, i < 2 ? UINT32_MAX : UINT64_MAX / 2, &v[i]) != 0)
+            return -1;
+        if (*args == '\0')
+            args = NULL;
+        else if (*args++ != ',' || i == 3)
+            return -1;
+    }
+    if (v[0] > v[1])
+        return -1;
+    c.seek_min_ns = (uint32_t)v[0];
+    c.seek_max_ns = (uint32_t)v[1];
+    c.read_expire_ns = v[2];
+    c.write_expire_ns = v[3];
+    *out = c;
+    return 0;
+}
+
+disk_t *disk_create(const disk_cfg_t *cfg, int nslots, uint32_t read_ns, uint32_t write_ns, int k)
+{
+    if (nslots <= 0 || k <= 0 || cfg->seek_min_ns > cfg->seek_max_ns)
+        return NULL;
+    disk_t *d = calloc(1, sizeof(*d));
+    if (!d)
+        return NULL;
+    d->cfg = *cfg;
+    d->nslots = nslots;
+    d->read_ns = read_ns;
+    d->write_ns = write_ns;
+    d->k = k;
+    d->dir = 1;
+    d->cap = 64;
+    d->q = malloc((size_t)d->cap * sizeof(*d->q));
+    d->waits = calloc((size_t)k, sizeof(*d->waits));
+    d->ready = calloc((size_t)k, sizeof(*d->ready));
+    if (!d->q || !d->waits || !d->ready)
+    {
+        disk_destroy(d);
+        return NULL;
+    }
+    return d;
+}
+
+void disk_destroy(disk_t *d)
+{
+    if (!d)
+        return;
+    free(d->q);
+    free(d->waits);
+    free(d->ready);
+    free(d);
+}
+
+void disk_submit(disk_t *d, int slot, int n, int write, uint64_t at, int waiter)
+{
+    if (d->len == d->cap)
+    {
+        disk_req_t *q = realloc(d->q, (size_t)d->cap * 2 * sizeof(*q));
+        if (q)
+        {
+            d->q = q;
+            d->cap *= 2;
+        }
+        else
+            disk_step(d); /* no room: serve one to make some */
+    }
+    disk_req_t *r = &d->q[d->len++];
+    r->at = at;
+    r->deadline = at + (write ? d->cfg.write_expire_ns : d->cfg.read_expire_ns);
+    r->seq = d->seq++;
+    r->slot = slot;
+    r->n = n;
+    r->waiter = waiter;
+    r->write = write;
+    if (waiter >= 0)
+        d->waits[waiter]++;
+    if (d->len > d->len_max)
+        d->len_max = d->len;
+}
+
+uint64_t disk_next(const disk_t *d)
+{
+    if (d->len == 0)
+        return UINT64_MAX;
+    uint64_t first = d->q[0].at;
+    for (int i = 1; i < d->len; ++i)
+        if (d->q[i].at < first)
+            first = d->q[i].at;
+    return first > d->busy_until ? first : d->busy_until;
+}
+
+static inline int seek_dist(const disk_t *d, const disk_req_t *r)
+{
+    return r->slot > d->head ? r->slot - d->head : d->head - r->slot;
+}
+
+/* a arrived before b */
+static inline int earlier(const disk_req_t *a, const disk_req_t *b)
+{
+    return a->at != b->at ? a->at < b->at : a->seq < b->seq;
+}
+
+/* Among the requests arrived by s, the one with the shortest seek in
+ * direction dir (+1 / -1, 0 = either way), -1 if there is none */
+static int nearest(const disk_t *d, uint64_t s, int dir)
+{
+    int best = -1;
+    for (int i = 0; i < d->len; ++i)
+    {
+        const disk_req_t *r = &d->q[i];
+        if (r->at > s || (dir > 0 && r->slot < d->head) || (dir < 0 && r->slot > d->head))
+            continue;
+        if (best < 0)
+            best = i;
+        else
+        {
+            int a = seek_dist(d, r), b = seek_dist(d, &d->q[best]);
+            if (a < b || (a == b && earlier(r, &d->q[best])))
+                best = i;
+        }
+    }
+    return best;
+}
+
+/* deadline: an expired request, else C-LOOK over the reads, else over the writes */
+static int pick_deadline(const disk_t *d, uint64_t s)
+{
+    int expired = -1, up = -1, low = -1;
+    int reads = 0;
+    for (int i = 0; i < d->len; ++i)
+        reads |= d->q[i].at <= s && !d->q[i].write;
+    for (int i = 0; i < d->len; ++i)
+    {
+        const disk_req_t *r = &d->q[i];
+        if (r->at > s)
+            continue;
+        if (r->deadline <= s &&
+            (expired < 0 || r->deadline < d->q[expired].deadline ||
+             (r->deadline == d->q[expired].deadline && r->seq < d->q[expired].seq)))
+            expired = i;
+        if (reads && r->write)
+            continue;
+        if (r->slot >= d->head && (up < 0 || r->slot < d->q[up].slot ||
+                                   (r->slot == d->q[up].slot && earlier(r, &d->q[up]))))
+            up = i;
+        if (low < 0 || r->slot < d->q[low].slot || (r->slot == d->q[low].slot && earlier(r, &d->q[low])))
+            low = i;
+    }
+    return expired >= 0 ? expired : up >= 0 ? up : low;
+}
+
+/* Index of the request the scheduler serves at time s */
+static int pick(disk_t *d, uint64_t s)
+{
+    switch (d->cfg.sched)
+    {
+    case DISK_SSTF:
+        return nearest(d, s, 0);
+    case DISK_SCAN:
+    {
+        int i = nearest(d, s, d->dir);
+        if (i < 0)
+        {
+            d->dir = -d->dir;
+            i = nearest(d, s, d->dir);
+        }
+        return i;
+    }
+    case DISK_DEADLINE:
+        return pick_deadline(d, s);
+    default:
+    {
+        int best = -1;
+        for (int i = 0; i < d->len; ++i)
+            if (d->q[i].at <= s && (best < 0 || earlier(&d->q[i], &d->q[best])))
+                best = i;
+        return best;
+    }
+    }
+}
+
+static uint64_t seek_time(const disk_t *d, int dist)
+{
+    if (dist == 0)
+        return 0;
+    double span = d->cfg.seek_max_ns - d->cfg.seek_min_ns;
+    double frac = d->nslots > 1 ? (double)dist / (d->nslots - 1) : 1.0;
+    return d->cfg.seek_min_ns + (uint64_t)(span * sqrt(frac));
+}
+
+static int bucket(uint64_t v)
+{
+    if (v < 32)
+        return (int)v;
+    int e = 63 - __builtin_clzll(v);
+    return 32 + (e - 5) * 16 + (int)((v >> (e - 4)) & 15);
+}
+
+/* Largest latency in bucket b */
+static uint64_t bucket_max(int b)
+{
+    if (b < 32)
+        return (uint64_t)b;
+    int e = (b - 32) / 16 + 5, sub = (b - 32) % 16;
+    return ((uint64_t)(17 + sub) << (e - 4)) - 1;
+}
+
+void disk_step(disk_t *d)
+{
+    uint64_t s = disk_next(d);
+    if (s == UINT64_MAX)
+        return;
+    int i = pick(d, s);
+    disk_req_t r = d->q[i];
+    d->q[i] = d->q[--d->len];
+
+    uint64_t seek = seek_time(d, seek_dist(d, &r));
+    uint64_t ns = seek + (uint64_t)r.n * (r.write ? d->write_ns : d->read_ns);
+    uint64_t done = s + ns;
+    d->head = r.slot + r.n - 1;
+    d->busy_until = done;
+    d->busy_ns += ns;
+    d->seek_ns += seek;
+    if (r.waiter >= 0)
+    {
+        d->waits[r.waiter]--;
+        if (done > d->ready[r.waiter])
+            d->ready[r.waiter] = done;
+    }
+
+    uint64_t lat = done - r.at;
+    if (d->served++ == 0)
+        d->first_at = r.at;
+    else if (r.at < d->first_at)
+        d->first_at = r.at;
+    d->last_done = done;
+    d->lat_sum += lat;
+    if (lat > d->lat_max)
+        d->lat_max = lat;
+    d->hist[bucket(lat)]++;
+}
+
+void disk_run(disk_t *d, uint64_t t)
+{
+    while (disk_next(d) < t)
+        disk_step(d);
+}
+
+uint64_t disk_wait(disk_t *d, int pid)
+{
+    while (d->waits[pid] > 0)
+        disk_step(d);
+    return d->ready[pid];
+}
+
+uint64_t disk_percentile(const disk_t *d, double q)
+{
+    if (d->served == 0)
+        return 0;
+    uint64_t want = (uint64_t)ceil(q * (double)d->served), seen = 0;
+    if (want == 0)
+        want = 1;
+    for (int b = 0; b < DISK_HIST_BUCKETS; ++b)
+    {
+        seen += d->hist[b];
+        if (seen >= want)
+        {
+            uint64_t v = bucket_max(b);
+            return v < d->lat_max ? v : d->lat_max;
+        }
+    }
+    return d->lat_max;
+}
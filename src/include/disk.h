@@ -0,0 +1,155 @@
+#ifndef DISK_H
+#define DISK_H
+
+/* disk.h
+ * Simulated disk under the swap device (swap.h): a request queue, a seek
+ * model and an I/O scheduler.
+ *
+ * Swap slots are laid out in order, slot s at position s. A request for n
+ * consecutive slots moves the head from its position to the first one,
+ * then transfers the n pages in n * read_ns or n * write_ns (swap.h), and
+ * leaves the head on the last. A seek over d slots costs
+ *   0                                                    if d == 0
+ *   seek_min + (seek_max - seek_min) * sqrt(d / (nslots - 1))  otherwise
+ * (a short seek is dominated by settling, a long one by the arm's travel).
+ *
+ * The disk serves one request at a time. Whenever it is free it picks the
+ * next request among the ones that have arrived:
+ *   fifo     : earliest arrival
+ *   sstf     : shortest seek from the head (ties: earliest arrival)
+ *   scan     : elevator: nearest request in the head's direction of travel,
+ *              reversing when there is none ahead (LOOK)
+ *   deadline : a request past its deadline (arrival + read_expire or
+ *              write_expire) first, earliest deadline first; otherwise reads
+ *              before writes, each in ascending slot order from the head,
+ *              wrapping around to the lowest slot (C-LOOK)
+ *
+ * Requests arrive at virtual times (pace.h), not necessarily in the order
+ * they are submitted, and the disk decides lazily: the pick at time s only
+ * considers requests that arrived by s, so it is made once nothing can be
+ * submitted with an earlier arrival. disk_run(d, t) makes the picks that
+ * fall before t: after it, no request may arrive before t. A request may
+ * name a waiter, the process blocked until it completes; disk_wait() makes
+ * picks until none of a waiter's requests is left in the queue.
+ *
+ * Configuration (mmu/master/vms-replay -I, needs -D swap):
+ *   none (the default: fifo without seeks, each request takes its transfer
+ *   time) or
+ *   fifo|sstf|scan|deadline[:seek_min,seek_max[,read_expire,write_expire]]
+ *     empty fields keep the defaults, all in ns:
+ *     seek_min     : DISK_SEEK_MIN_NS
+ *     seek_max     : DISK_SEEK_MAX_NS
+ *     read_expire  : DISK_READ_EXPIRE_NS  (deadline only)
+ *     write_expire : DISK_WRITE_EXPIRE_NS (deadline only)
+ *
+ * Per-request latency (arrival to completion) goes to a log-linear
+ * histogram, 16 buckets per power of two, so percentiles are exact below
+ * 32 ns and within 1/16 above.
+ */
+
+#include <stdint.h>
+
+#define DISK_SEEK_MIN_NS 500000u
+#define DISK_SEEK_MAX_NS 10000000u
+#define DISK_READ_EXPIRE_NS 500000000ull
+#define DISK_WRITE_EXPIRE_NS 5000000000ull
+
+#define DISK_HIST_BUCKETS 976
+
+typedef enum {
+    DISK_FIFO = 0,
+    DISK_SSTF,
+    DISK_SCAN,
+    DISK_DEADLINE
+} disk_sched_t;
+
+typedef struct {
+    int enabled;            /* 0 = fifo without seeks */
+    disk_sched_t sched;
+    uint32_t seek_min_ns;
+    uint32_t seek_max_ns;
+    uint64_t read_expire_ns;
+    uint64_t write_expire_ns;
+} disk_cfg_t;
+
+typedef struct {
+    uint64_t at;            /* arrival */
+    uint64_t deadline;
+    uint64_t seq;           /* submission order, breaks ties */
+    int32_t slot;           /* first slot */
+    int32_t n;              /* slots */
+    int32_t waiter;         /* blocked process, -1 = none */
+    int write;
+} disk_req_t;
+
+typedef struct {
+    disk_cfg_t cfg;
+    int nslots;
+    uint32_t read_ns;
+    uint32_t write_ns;
+    int k;
+    disk_req_t *q;          /* queued requests, unordered */
+    int len;
+    int cap;
+    uint64_t seq;
+    int head;               /* last slot of the last request served */
+    int dir;                /* scan: +1 / -1 */
+    uint64_t busy_until;    /* completion time of the last request picked */
+    int *waits;             /* k: queued requests a process waits for */
+    uint64_t *ready;        /* k: latest completion of those picked */
+    uint64_t served;
+    uint64_t busy_ns;       /* total service time */
+    uint64_t seek_ns;       /* part of it spent seeking */
+    uint64_t lat_sum;
+    uint64_t lat_max;
+    uint64_t first_at;      /* arrival of the first request served */
+    uint64_t last_done;
+    int len_max;
+    uint64_t hist[DISK_HIST_BUCKETS];
+} disk_t;
+
+/* Parse a -I spec ("none" gives enabled = 0). Returns 0 on success, -1 if malformed. */
+int disk_parse(const char *spec, disk_cfg_t *out);
+
+/* "fifo", "sstf", "scan" or "deadline" */
+const char *disk_sched_name(disk_sched_t sched);
+
+/* Create an idle disk of nslots slots for k processes, head at slot 0.
+ * Returns NULL on bad config / OOM.
+ */
+disk_t *disk_create(const disk_cfg_t *cfg, int nslots, uint32_t read_ns, uint32_t write_ns, int k);
+void disk_destroy(disk_t *d);
+
+/* Queue a request for n slots from 'slot' arriving at 'at'; waiter is -1
+ * or the process blocked on it */
+void disk_submit(disk_t *d, int slot, int n, int write, uint64_t at, int waiter);
+
+/* Start time of the next pick, UINT64_MAX if the queue is empty */
+uint64_t disk_next(const disk_t *d);
+
+/* Make the next pick */
+void disk_step(disk_t *d);
+
+/* Make the picks that start before t */
+void disk_run(disk_t *d, uint64_t t);
+
+/* Make picks until no request of pid is queued; returns when the last of
+ * them completes (0 if pid never waited) */
+uint64_t disk_wait(disk_t *d, int pid);
+
+/* pid still waits for a request that was not picked */
+static inline int disk_waiting(const disk_t *d, int pid)
+{
+    return d->waits[pid] > 0;
+}
+
+/* Latest completion of the requests pid waited for */
+static inline uint64_t disk_ready(const disk_t *d, int pid)
+{
+    return d->ready[pid];
+}
+
+/* Latency (ns) below which a fraction q of the served requests completed */
+uint64_t disk_percentile(const disk_t *d, double q);
+
+#endif /* DISK_H */
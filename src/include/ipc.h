@@ -32,6 +32,16 @@ typedef int ipc_mqid_t;   /* message queue id */
 #define MSGTYPE_PROC_REQ     1  /* process -> MMU requests (or generic request) */
 #define MSGTYPE_MMU_REPLY    2  /* MMU -> process replies */
 #define MSGTYPE_SCHED_NOTIFY 3  /* MMU -> Scheduler notifications */
+#define MSGTYPE_PROC_BATCH   4  /* process -> MMU batched requests */
+#define MSGTYPE_MMU_BATCH    5  /* MMU -> process batched replies */
+
+/* MSGTYPE_SCHED_NOTIFY: ints[0] = p_ind, ints[1] = one of these */
+enum {
+    SCHED_NOTE_DONE    = 0,  /* the process made its last reference */
+    SCHED_NOTE_FAULT   = 1,  /* page fault(s) handled */
+    SCHED_NOTE_SUSPEND = 2,  /* load control swapped the process out (loadctl.h) */
+    SCHED_NOTE_RESUME  = 3   /* ... and lets it run again */
+};
 
 /* Generic message payload size: change if needed. Keep small to avoid msg limits. */
 #define IPC_PAYLOAD_INTS 4
@@ -45,6 +55,37 @@ typedef struct {
     int ints[IPC_PAYLOAD_INTS];
 } ipc_msg_t;
 
+/* Max references carried by one batch message. The full struct stays well
+ * under the default msgmax (8192 bytes).
+ */
+#define IPC_BATCH_MAX 256
+
+/* Per-entry status of a batch reply */
+enum {
+    BATCH_ST_HIT     = 0,  /* page was resident */
+    BATCH_ST_FAULT   = 1,  /* page fault handled, vals[i] is the new frame */
+    BATCH_ST_FAILED  = 2,  /* page fault could not be handled */
+    BATCH_ST_INVALID = 3,  /* illegal reference; entries after it are not resolved */
+    BATCH_ST_END     = 4   /* end-of-reference marker acknowledged */
+};
+
+/* Batched request/reply:
+ *  - request (MSGTYPE_PROC_BATCH): vals[0..count) are page numbers
+ *    (MMU_END_OF_REF as the last entry ends the stream)
+ *  - reply   (MSGTYPE_MMU_BATCH):  vals[i] is the frame number or MMU_* code,
+ *    status[i] one of BATCH_ST_*; count may be shorter than the request
+ *    if an invalid reference cut the batch.
+ * Only the used prefix of vals[] travels over the queue.
+ */
+typedef struct {
+    long mtype;
+    int pid;                            /* process index (p_ind) */
+    int count;                          /* used entries in vals[] */
+    int m_req;                          /* legal upper bound for pid (requests) */
+    signed char status[IPC_BATCH_MAX];  /* BATCH_ST_* (replies) */
+    int vals[IPC_BATCH_MAX];
+} ipc_batch_msg_t;
+
 /* ---------- Shared memory helpers ---------- */
 
 /* Create (or get if exists) a shared memory segment.
@@ -99,6 +140,81 @@ ssize_t ipc_recv_msg(ipc_mqid_t mqid, ipc_msg_t *msg, long mtype);
 /* Helper: non-blocking receive (IPC_NOWAIT). Returns >0 bytes on success, 0 if no message, -1 on error. */
 ssize_t ipc_recv_msg_nb(ipc_mqid_t mqid, ipc_msg_t *msg, long mtype);
 
+/* Send a batch message; only the first msg->count entries of vals[] are sent.
+ * Returns 0 on success, -1 on failure (including count outside [0, IPC_BATCH_MAX]).
+ */
+int ipc_send_batch(ipc_mqid_t mqid, const ipc_batch_msg_t *msg);
+
+/* Receive a batch message (blocking). Same mtype semantics as ipc_recv_msg.
+ * Returns number of bytes read (>0) on success, -1 on failure.
+ */
+ssize_t ipc_recv_batch(ipc_mqid_t mqid, ipc_batch_msg_t *msg, long mtype);
+
+/* ---------- Channels: pluggable transport for MQ2 / MQ3 traffic ---------- */
+
+/* A channel carries any message struct that starts with 'long mtype'
+ * (ipc_msg_t, ipc_batch_msg_t) between one hub and its peers:
+ *   MQ3: hub = MMU,       peers = processes (peer index = p_ind)
+ *   MQ2: hub = scheduler, peer 0 = MMU
+ *
+ * Transports, picked at startup (-x on every binary):
+ *   IPC_TRANSPORT_MQ  : the SysV queue under 'key' (mtype selects). Messages
+ *                       from the hub travel under an mtype derived from the
+ *                       peer, so peers waiting at the same time get their own.
+ *   IPC_TRANSPORT_SHM : a SysV shm segment under the same 'key' (shm and msg
+ *                       keys are separate namespaces) holding one lock-free
+ *                       single-producer/single-consumer ring per peer and
+ *                       direction. Waiters spin briefly, then sleep on a futex.
+ *                       mtype is carried but not used for selection.
+ */
+typedef enum {
+    IPC_TRANSPORT_MQ = 0,
+    IPC_TRANSPORT_SHM = 1
+} ipc_transport_t;
+
+#define IPC_HUB -1  /* 'self' of the hub end of a channel */
+
+typedef struct {
+    ipc_transport_t kind;
+    int self;          /* IPC_HUB or peer index */
+    ipc_mqid_t mqid;   /* MQ transport */
+    void *seg;         /* SHM transport: attached ring segment */
+    int next_peer;     /* SHM hub: round-robin start for receives */
+} ipc_chan_t;
+
+/* Parse "mq" / "shm". Returns 0 and sets *out on success, -1 otherwise. */
+int ipc_transport_parse(const char *name, ipc_transport_t *out);
+
+/* Create the ring segment for a channel with 'npeers' peers under 'key'
+ * (master does this; SHM transport only). Returns shmid or -1.
+ */
+ipc_shmid_t ipc_ring_create(key_t key, int npeers);
+
+/* Open an existing channel as 'self' (IPC_HUB or a peer index).
+ * Returns 0 on success, -1 on failure.
+ */
+int ipc_chan_open(ipc_chan_t *ch, ipc_transport_t kind, key_t key, int self);
+
+/* Detach from the channel (does not remove it). */
+void ipc_chan_close(ipc_chan_t *ch);
+
+/* Send 'bytes' bytes of msg (including mtype). The hub names the receiving
+ * peer; a peer always sends to the hub and passes any value.
+ * Blocks while the ring is full. Returns 0 on success, -1 on failure.
+ */
+int ipc_chan_send(ipc_chan_t *ch, int peer, const void *msg, size_t bytes);
+
+/* Receive one message (blocking) into msg (at most max_bytes, including mtype).
+ * MQ transport filters on mtype like ipc_recv_msg; the hub of an SHM channel
+ * takes the next message from any peer. Returns bytes stored (>0) or -1.
+ */
+ssize_t ipc_chan_recv(ipc_chan_t *ch, void *msg, size_t max_bytes, long mtype);
+
+/* Bytes of a batch message that are actually used (header + count vals) */
+static inline size_t ipc_batch_bytes(const ipc_batch_msg_t *msg) {
+    return offsetof(ipc_batch_msg_t, vals) + (size_t)msg->count * sizeof(int);
+}
+
 /* ---------- Convenience wrappers for the VM simulator ---------- */
 
 /* Create the three message queues used by the lab:
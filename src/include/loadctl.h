@@ -0,0 +1,162 @@
+#ifndef LOADCTL_H
+#define LOADCTL_H
+
+/* loadctl.h
+ * Load control: per-process frame allocation by working set or page-fault
+ * frequency, and suspension of whole processes when memory is overcommitted.
+ *
+ * Without it, local replacement hands out free frames first come, first
+ * served: whoever faults first keeps its frames until ffl_alloc() runs dry,
+ * later processes can only replace their own pages (or fail when they have
+ * none), and with k*m >> f they all thrash. With it, the MMU core
+ * (mmu_core.c) asks this module at every fault whether the process should
+ * grow (take a free frame) or replace one of its own pages, and which of
+ * its pages have left its working set. Those go back to the FFL, so frames
+ * move between processes only through the free list.
+ *
+ * Time is per process: a process's virtual time advances by one with each
+ * of its own references (hits and faults), so a process that is not running
+ * does not age.
+ *
+ * Configuration (mmu/master/vms-replay -L):
+ *   none (the default: no load control)
+ *   ws[:tau]   working set: at each fault of a process, its resident pages
+ *              not referenced in its last tau references are released.
+ *              Faults always take a free frame. Default tau LC_WS_TAU.
+ *   pff[:lo,hi]
+ *              page-fault frequency, measured as 1 / (references since the
+ *              process's previous fault):
+ *                rate < lo : release the pages not referenced since the
+ *                            previous fault, then take a free frame
+ *                rate > hi : take a free frame
+ *                otherwise : replace one of its own pages (the policy's
+ *                            victim; with -g, its least recently
+ *                            referenced page)
+ *              Defaults LC_PFF_LO, LC_PFF_HI.
+ *
+ * Overload: when a fault should take a free frame and there is none, even
+ * after releasing every process's stale pages, the working sets no longer
+ * fit in f frames. The active process with the highest p_ind other than the
+ * faulting one is then suspended (swapped out): all of its frames return to
+ * the FFL and lc_poll() reports it, so the scheduler can stop running it.
+ * A suspended process is resumed once the FFL holds as many frames as it
+ * had when it was suspended, when no other active process is left, or when
+ * it makes a reference anyway. A process that ends (lc_exit) releases all
+ * of its frames.
+ */
+
+#include <stdint.h>
+#include "types.h"
+
+#define LC_WS_TAU 1000
+#define LC_PFF_LO 0.01
+#define LC_PFF_HI 0.05
+
+typedef enum {
+    LC_NONE = 0,
+    LC_WS,
+    LC_PFF
+} lc_mode_t;
+
+typedef struct {
+    lc_mode_t mode;
+    uint32_t tau;   /* ws: window in references */
+    double lo;      /* pff: fault-rate bounds, faults per reference */
+    double hi;
+} lc_cfg_t;
+
+/* Process states */
+enum {
+    LC_ACTIVE = 0,
+    LC_SUSPENDED,
+    LC_EXITED
+};
+
+/* lc_poll() results */
+enum {
+    LC_EV_NONE = 0,
+    LC_EV_SUSPEND,
+    LC_EV_RESUME
+};
+
+typedef struct {
+    lc_cfg_t cfg;
+    int k;
+    int m;
+    lru_link_t *link;      /* k*m pages + k sentinels: per-process recency list of resident pages */
+    uint64_t *last;        /* k*m: owner's virtual time of the last reference */
+    uint64_t *vt;          /* k: references made */
+    uint64_t *last_fault;  /* k: vt at the previous fault */
+    uint64_t *cut;         /* k, pff: pages last referenced before this are released */
+    int *resident;         /* k: resident pages */
+    int *saved;            /* k: resident pages when suspended */
+    signed char *state;    /* k: LC_ACTIVE / LC_SUSPENDED / LC_EXITED */
+    signed char *reported; /* k: suspended as last seen by lc_poll() */
+    uint64_t trimmed;      /* frames released from working sets */
+    uint64_t swapped;      /* frames released by suspensions */
+    uint64_t suspends;
+    uint64_t resumes;
+} lc_t;
+
+/* Parse a -L spec ("none" gives mode LC_NONE). Returns 0 on success, -1 if malformed. */
+int lc_parse(const char *spec, lc_cfg_t *out);
+
+/* Create the state for k processes of m pages, all active with nothing
+ * resident. Returns NULL on bad config / OOM.
+ */
+lc_t *lc_create(const lc_cfg_t *cfg, int k, int m);
+void lc_destroy(lc_t *lc);
+
+/* "none", "ws" or "pff" */
+const char *lc_mode_name(lc_mode_t mode);
+
+/* pid referenced its resident page */
+void lc_touch(lc_t *lc, int pid, int page);
+
+/* pid faulted. Returns 1 if the fault should take a free frame, 0 if it
+ * should replace one of pid's pages. Call lc_map() once the page is mapped.
+ */
+int lc_fault(lc_t *lc, int pid);
+
+/* page of pid became resident / stopped being resident */
+void lc_map(lc_t *lc, int pid, int page);
+void lc_unmap(lc_t *lc, int pid, int page);
+
+/* A resident page of pid outside its working set (counted as trimmed),
+ * or -1. The caller releases it (which calls lc_unmap) and asks again.
+ */
+int lc_stale(lc_t *lc, int pid);
+
+/* Least recently referenced resident page of pid, or -1 */
+static inline int lc_lru(const lc_t *lc, int pid)
+{
+    int s = lc->k * lc->m + pid;
+    int n = lc->link[s].next;
+    return n == s ? -1 : n - pid * lc->m;
+}
+
+/* Pick an active process other than pid to suspend and mark it suspended;
+ * the caller releases its pages. Returns its p_ind, or -1 if there is none.
+ */
+int lc_pick_suspend(lc_t *lc, int pid);
+
+/* Pick a suspended process that fits in 'free_frames' (or any, if no
+ * process is active) and mark it active. Returns its p_ind, or -1.
+ */
+int lc_pick_resume(lc_t *lc, int free_frames);
+
+/* pid made its last reference; the caller releases its pages */
+void lc_exit(lc_t *lc, int pid);
+
+static inline int lc_suspended(const lc_t *lc, int pid)
+{
+    return lc->state[pid] == LC_SUSPENDED;
+}
+
+/* Next suspension or resumption not reported yet (LC_EV_*, pid in *pid),
+ * or LC_EV_NONE. A process suspended and resumed between two polls is not
+ * reported.
+ */
+int lc_poll(lc_t *lc, int *pid);
+
+#endif /* LOADCTL_H */
@@ -5,15 +5,71 @@
  * Entry point for the simulation.
  *
  * Usage:
- *   master <k> <m> <n> <ref_len>
+ *   master [-b batch] [-p policy] [-g] [-s seed] [-x mq|shm] [-t trace_dir] [-P pace] [-T tlb] [-L loadctl] [-F prefetch] [-R around] [-D swap] [-I iosched] [-w write_pct] [-A] <k> <m> <n> <ref_len>
  *
  * Where:
+ *   batch   : references per MMU message (0 = one at a time); forwarded
+ *             to the MMU and every process
+ *   policy  : page-replacement policy forwarded to the MMU (default lru)
+ *   -g      : global replacement (forwarded to the MMU); default local
+ *   seed    : srand() seed for the reference strings (default: time); reuse
+ *             it to replay the same references under another policy
+ *   mq|shm  : transport of the MMU <-> process/scheduler traffic (default mq);
+ *             shm uses the lock-free rings described in ipc.h. MQ1 (ready
+ *             queue) stays a SysV queue either way.
+ *   trace_dir: record binary traces of the MMU, scheduler and processes
+ *             there (created if missing; see trace.h, read with vms-tracedump)
+ *   pace    : none (default) | real[:delay_us] | virtual[:hit,fault,ctx],
+ *             forwarded to the MMU and scheduler (see pace.h)
+ *   tlb     : TLB model forwarded to the MMU (see tlb.h), default none
+ *   loadctl : load control forwarded to the MMU, none (default) |
+ *             ws[:tau] | pff[:lo,hi] (see loadctl.h)
+ *   prefetch: stride prefetching forwarded to the MMU, none (default) |
+ *             depth[,free|evict] (see prefetch.h)
+ *   around  : fault-around forwarded to the MMU, none (default) |
+ *             pages[,watermark] (see prefetch.h)
+ *   swap    : swap device forwarded to the MMU, none (default) |
+ *             swap[:read_ns,write_ns,slots,cluster,readahead] (see swap.h)
+ *   iosched : disk scheduler under the swap device forwarded to the MMU
+ *             (needs -D swap), none (default) |
+ *             fifo|sstf|scan|deadline[:seek_min,seek_max[,read_expire,write_expire]]
+ *             (see disk.h)
+ *   write_pct: percentage of references generated as writes (REFS_WRITE,
+ *             see refs.h), default 0; the other references are reads
+ *   -A      : asynchronous faults (needs -P virtual), forwarded to the MMU
+ *             and scheduler: a faulting process waits for its page while
+ *             the next one runs
+ *
+ * The generated reference strings are also written to ./tmp/refs.bin
+ * (format in refs.h) and passed to the MMU with -r.
+ *
  *   k       : number of processes
  *   m       : max virtual pages per process
  *   n       : number of physical frames
  *   ref_len : length of reference string per process
  */
 
-int master_run(int k, int m, int n, int ref_len);
+#include "ipc.h"
+
+typedef struct {
+    int batch;           /* references per MMU message (0 = one at a time) */
+    const char *policy;  /* replacement policy name */
+    int global;          /* global replacement */
+    unsigned seed;       /* reference-string seed, if 'seeded' */
+    int seeded;
+    ipc_transport_t transport;  /* MQ2/MQ3 transport */
+    const char *trace_dir;      /* binary trace directory, or NULL */
+    const char *pace;           /* -P spec, already validated */
+    const char *tlb;            /* -T spec, already validated */
+    const char *loadctl;        /* -L spec, already validated */
+    const char *prefetch;       /* -F spec, already validated */
+    const char *around;         /* -R spec, already validated */
+    const char *swap;           /* -D spec, already validated */
+    const char *iosched;        /* -I spec, already validated */
+    int write_pct;              /* 0..100 */
+    int async;                  /* -A */
+} master_opts_t;
+
+int master_run(int k, int m, int n, int ref_len, const master_opts_t *opts);
 
 #endif /* MASTER_H */
@@ -14,19 +14,28 @@
 /* ---------- Page table init ---------- */
 
 /* Initialize all k page tables (each of size m) in SM1.
- * Sets frame_no = -1, valid = 0, last_used = 0 for every PTE.
+ * Unmaps every PTE (word = 0), sets last_used = 0 and empties
+ * every process's recency list.
  * Returns 0 on success.
  */
 int pt_init_all(void *sm1_base, int k, int m);
 
-/* Set a mapping (on page fault resolution): pte[page_no] := (frame_no, valid=1, last_used=ts) */
-int pt_set_mapping(void *sm1_base, int pid, int m, int page_no, int frame_no, int ts);
+/* Set a mapping (on page fault resolution): pte[page_no] := (frame_no, valid, last_used=ts)
+ * and make page_no the MRU entry of the process's recency list.
+ * frame_no must be below PTE_MAX_FRAMES. last_used is 32 bits: callers pass
+ * the low bits of their clock, so recency ranks wrap every 2^32 stamps. */
+int pt_set_mapping(void *sm1_base, int pid, int m, int page_no, int frame_no, uint32_t ts);
 
-/* Invalidate a page (on eviction): pte[page_no].valid = 0, frame_no = -1 */
+/* Invalidate a page (on eviction): clear the PTE word, unlink from recency list */
 int pt_invalidate(void *sm1_base, int pid, int m, int page_no);
 
-/* Touch a page on access: update last_used to 'ts'. (Call this on hits) */
-int pt_touch(void *sm1_base, int pid, int m, int page_no, int ts);
+/* Touch a page on access: update last_used to 'ts' and move it to the MRU end. (Call this on hits) */
+int pt_touch(void *sm1_base, int pid, int m, int page_no, uint32_t ts);
+
+/* Move a resident page to the MRU end of its recency list without touching
+ * last_used. No bounds checks: the hit path has already validated page_no.
+ */
+void lru_touch(void *sm1_base, int pid, int m, int page_no);
 
 /* Validate if a (pid, page_no) pair is within [0, m_req[pid]) — caller passes each process's m_req.
  * Returns 1 if legal, 0 if illegal.
@@ -35,13 +44,20 @@ int is_legal_page(int page_no, int m_req_for_pid);
 
 /* ---------- Free Frame List (FFL) management (SM2) ---------- */
 
-/* Compute bytes required for SM2: metadata + f integers. */
+/* Compute bytes required for SM2: metadata + f integers + frame table. */
 static inline size_t sm2_bytes_for_f(int f) {
-    return sizeof(free_frame_list_t) + (size_t)f * sizeof(int);
+    return sizeof(free_frame_list_t) + (size_t)f * sizeof(int) +
+           ((size_t)f + 1) * sizeof(frame_entry_t);
+}
+
+/* Frame table of an initialized SM2: entries [0, f) per frame, [f] sentinel */
+static inline frame_entry_t *frame_table(free_frame_list_t *ffl) {
+    return (frame_entry_t *)(ffl->frames + ffl->total_frames);
 }
 
 /* Initialize FFL on an already-attached SM2 region of size sm2_bytes_for_f(f).
- * Pre-fills frames with 0..f-1 and sets count=f.
+ * Pre-fills frames with 0..f-1, sets count=f and marks every frame free in
+ * the frame table.
  * Returns 0 on success, -1 on bad params.
  */
 int ffl_init(free_frame_list_t *ffl, int f);
@@ -52,11 +68,48 @@ int ffl_alloc(free_frame_list_t *ffl);
 /* Push a frame back to free list; returns 0 on success, -1 if full/invalid. */
 int ffl_free(free_frame_list_t *ffl, int frame_idx);
 
+/* ---------- Frame table (SM2) ---------- */
+/* The MMU records every mapping change here, so any frame can be traced back
+ * to its page for global replacement. No bounds checks: callers pass frames
+ * they just allocated or read from a valid PTE.
+ */
+
+/* frame now holds (pid, page); it becomes the MRU entry of the global list */
+void ft_map(frame_entry_t *ft, int f, int frame, int pid, int page);
+
+/* frame is being released: clear its owner and unlink it */
+void ft_unmap(frame_entry_t *ft, int f, int frame);
+
+/* Move a used frame to the MRU end of the global list */
+void ft_touch(frame_entry_t *ft, int f, int frame);
+
+/* Least recently mapped/touched used frame, or -1 if none is used */
+static inline int ft_lru(const frame_entry_t *ft, int f) {
+    int head = ft[f].next;
+    return head == f ? -1 : head;
+}
+
 /* ---------- Local LRU victim selection ---------- */
-/* Choose the least-recently-used VALID page of process pid, scanning its page table.
+/* Least-recently-used VALID page of process pid: head of its recency list.
  * Returns the page_no (>=0) to evict, or -1 if no valid page exists.
- * Complexity: O(m). Good enough for the assignment.
+ * Complexity: O(1). The caller evicts it with pt_invalidate().
+ */
+int lru_victim_local(void *sm1_base, int pid, int m);
+
+/* The same victim found by scanning the page table for the smallest
+ * last_used among valid pages. Used by the lru-scan policy and to
+ * cross-check the recency list. Ties go to the lowest page_no.
+ * Complexity: O(m), vectorized (AVX2 or SSE4.1 when the CPU has them).
  */
 int choose_lru_victim_local(void *sm1_base, int pid, int m);
 
+/* Pick the choose_lru_victim_local() implementation: "scalar", "sse4.1",
+ * "avx2", or NULL for the best one the CPU supports (the default, chosen on
+ * first use). Returns 0, or -1 if unknown or unsupported here.
+ */
+int lru_scan_select(const char *isa);
+
+/* Name of the implementation in use */
+const char *lru_scan_name(void);
+
 #endif /* MEMORY_H */
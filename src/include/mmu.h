@@ -5,11 +5,50 @@
  * Public API and CLI contract for the MMU module.
  *
  * CLI (recommended):
- *   mmu <sm1_key> <sm2_key> <mq_sched_key> <mq_proc_key> <k> <m> <f>
+ *   mmu [-b batch] [-p policy] [-g] [-r refs_file] [-x mq|shm] [-P pace] [-T tlb] [-L loadctl] [-F prefetch] [-R around] [-D swap] [-I iosched] [-A] <sm1_key> <sm2_key> <mq_sched_key> <mq_proc_key> <k> <m> <f>
+ *
+ * Options (must precede the positional arguments):
+ *   -b batch      : >0 selects the batched protocol (processes send up to
+ *                   'batch' references per message); 0 (default) keeps the
+ *                   one-reference-per-message protocol
+ *   -p policy     : page-replacement policy: fifo | lru (default) | lru-scan | clock | random | opt
+ *   -g            : global replacement: when no frame is free, the victim may
+ *                   belong to any process (see policy.h); default is local
+ *   -r refs_file  : reference strings written by master (refs.h); required by opt
+ *   -x transport  : mq (default) = SysV queues; shm = per-process shared-memory
+ *                   rings under the same MQ2/MQ3 keys (see ipc_chan_t in ipc.h)
+ *   -P pace       : none (default) | real[:delay_us] | virtual[:hit,fault,ctx];
+ *                   real waits delay_us after every request, virtual reports
+ *                   simulated latencies with the stats (see pace.h)
+ *   -T tlb        : model a TLB, entries[,ways[,lru|fifo|random[,asid|flush[,lookup_ns]]]]
+ *                   (see tlb.h); TLB hit rates are printed with the stats
+ *   -L loadctl    : none (default) | ws[:tau] | pff[:lo,hi]: allocate frames
+ *                   by working set or page-fault frequency, release frames of
+ *                   finished processes, suspend processes when the working
+ *                   sets do not fit (see loadctl.h)
+ *   -F prefetch   : none (default) | depth[,free|evict]: on faults of a process
+ *                   with a sequential or constant-stride pattern, also map the
+ *                   next depth pages (see prefetch.h)
+ *   -R around     : none (default) | pages[,watermark]: fault-around, a fault
+ *                   also maps the other pages of its aligned window of that
+ *                   many pages, while more than watermark frames are free
+ *                   (see prefetch.h)
+ *   -D swap       : none (default) | swap[:read_ns,write_ns,slots,cluster,readahead]:
+ *                   simulated swap device; evicting a page written by a write
+ *                   reference (refs.h REFS_WRITE) writes it back, faulting it
+ *                   in again reads it, optionally with its neighbours in swap
+ *                   (see swap.h)
+ *   -I iosched    : none (default) | fifo|sstf|scan|deadline[:seek_min,seek_max[,read_expire,write_expire]]:
+ *                   disk under the swap device (needs -D swap), with seeks
+ *                   between slots and the given request scheduler (see disk.h)
+ *   -A            : asynchronous faults (needs -P virtual): the reply to a
+ *                   faulting request is held until the page arrives in
+ *                   simulated time, and other processes' requests are
+ *                   served meanwhile (see mmu_core.h)
  *
  * Where:
  *   sm1_key       : key_t for SM1 (page tables), ftok-derived (pass as int)
- *   sm2_key       : key_t for SM2 (free frame list), ftok-derived (pass as int)
+ *   sm2_key       : key_t for SM2 (free frame list, frame table), ftok-derived (pass as int)
  *   mq_sched_key  : key_t for MQ2 (MMU <-> Scheduler)
  *   mq_proc_key   : key_t for MQ3 (MMU <-> Processes)
  *   k             : number of processes (0..k-1)
@@ -19,7 +58,7 @@
  * Message protocol (SysV queues; see ipc.h):
  *   - Process -> MMU (MQ3, mtype=MSGTYPE_PROC_REQ):
  *       msg.ints[0] = pid
- *       msg.ints[1] = page_no
+ *       msg.ints[1] = page_no  (| REFS_WRITE for a write, see refs.h)
  *       msg.ints[2] = m_req_for_pid  (the legal upper bound for this pid)
  *   - MMU -> Process (MQ3, mtype=MSGTYPE_MMU_REPLY):
  *       msg.ints[0] = pid
@@ -27,15 +66,48 @@
  *           >=0  : frame number (hit or fault resolved)
  *           -2   : MMU_INVALID_PAGE (illegal reference)
  *           -9   : MMU_END_OF_REF (if you choose to send an end marker)
+ *   - Batched mode (-b): MSGTYPE_PROC_BATCH / MSGTYPE_MMU_BATCH carrying an
+ *     ipc_batch_msg_t; the batch is resolved in order and answered with one
+ *     reply holding a frame (or MMU_* code) and a BATCH_ST_* status per entry.
  *   - MMU -> Scheduler (MQ2, mtype=MSGTYPE_SCHED_NOTIFY):
  *       msg.ints[0] = pid
- *       msg.ints[1] = 1 if page fault handled, 0 otherwise
+ *       msg.ints[1] = SCHED_NOTE_FAULT (1) if page fault handled,
+ *                     SCHED_NOTE_DONE (0) when the process ended,
+ *                     SCHED_NOTE_SUSPEND / SCHED_NOTE_RESUME (2 / 3) from load control
+ *     (in batched mode at most one fault notification is sent per batch;
+ *     with -A one per fault that holds the reply, so the scheduler can start
+ *     another process)
  *
- * The MMU maintains a global timestamp that increments on every *valid* access.
+ * The MMU maintains a global timestamp that increments on every *valid* access,
+ * and prints per-process hit/fault/eviction counters when it shuts down.
  */
 
+#include "ipc.h"
+#include "pace.h"
+#include "tlb.h"
+#include "loadctl.h"
+#include "prefetch.h"
+#include "swap.h"
+
+/* Tunables selected on the command line */
+typedef struct {
+    int batch;           /* 0: single-reference protocol, >0: batched protocol */
+    const char *policy;  /* replacement policy name (NULL = "lru"), see policy.h */
+    int global;          /* global instead of local replacement */
+    const char *refs_path;  /* reference file for offline policies, or NULL */
+    ipc_transport_t transport;  /* MQ2/MQ3 transport */
+    pace_t pace;                /* pacing mode and cost model */
+    tlb_cfg_t tlb;              /* entries == 0: no TLB */
+    lc_cfg_t lc;                /* mode LC_NONE: no load control */
+    pf_cfg_t prefetch;          /* depth 0: no prefetching */
+    fa_cfg_t around;            /* pages 0: no fault-around */
+    swap_cfg_t swap;            /* enabled 0: no swap device */
+    disk_cfg_t disk;            /* enabled 0: fifo without seeks */
+    int async;                  /* hold replies to faults until the page arrives */
+} mmu_opts_t;
+
 int mmu_run(int sm1_key, int sm2_key,
             int mq_sched_key, int mq_proc_key,
-            int k, int m, int f);
+            int k, int m, int f, const mmu_opts_t *opts);
 
 #endif /* MMU_H */
@@ -0,0 +1,147 @@
+#ifndef MMU_CORE_H
+#define MMU_CORE_H
+
+/* mmu_core.h
+ * Address-resolution logic of the MMU, independent of IPC.
+ *
+ * The mmu binary wraps it with SysV queues; vms-replay drives it directly
+ * from a reference file. Both therefore produce the same hit/fault counts
+ * for the same references.
+ *
+ * resolve semantics (per access of process p_ind to page_no):
+ *   - illegal page   -> MMU_INVALID_PAGE
+ *   - resident       -> frame (hit; policy on_hit)
+ *   - not resident   -> frame from the FFL, else the policy's victim of the
+ *                       same process (of any process with global
+ *                       replacement) is evicted and its frame reused
+ *                       (*pfh_out = 1); MMU_PAGE_FAULT if neither exists
+ *
+ * Every mapping change is mirrored in the SM2 frame table (ft_map), so its
+ * reverse map and global recency list are valid in both modes.
+ *
+ * In PACE_VIRTUAL mode every access advances now_ns (and the process's
+ * sim_ns) by pace.hit_ns or pace.fault_ns (illegal references cost a hit),
+ * plus pace.ctx_ns when p_ind differs from the previous access's process.
+ *
+ * With a TLB (tlb.h) the lookup comes first; a TLB miss costs one extra
+ * memory access (the page-table walk), resident pages are filled after the
+ * walk or the fault, an evicted page is shot down, and a change of p_ind
+ * flushes a TLB configured without ASIDs.
+ *
+ * With load control (loadctl.h) a fault first asks it whether to grow or
+ * replace; the faulting process's pages outside its working set are
+ * released to the FFL, and if the FFL is still empty when the process
+ * should grow, every process's stale pages are, then if need be another
+ * process is suspended and all of its pages are released. Suspended
+ * processes are resumed as frames free up.
+ *
+ * With prefetching (prefetch.h) a fault, and the first reference to a
+ * prefetched page, also map the pages the process's stride predicts, from
+ * free frames or, if configured, by evicting the policy's victim. With
+ * fault-around (prefetch.h) a fault also maps the pages of its window that
+ * need no I/O, while more free frames than the watermark are left.
+ *
+ * page_no may carry REFS_WRITE (refs.h): a write sets PTE_DIRTY in the
+ * page's PTE. With a swap device (swap.h) evicting a dirty page writes it
+ * back and a fault on a page that was written back reads it in, with
+ * readahead also the process's other pages near it in swap, into free
+ * frames; in virtual mode the faulting process is charged until both
+ * complete, which depends on the other requests in the disk's queue.
+ *
+ * Async faults (virtual mode only): a fault no longer stops the clock.
+ * Its fault_ns and swap I/O pass in the background, the faulting process
+ * is blocked until its page arrives (mmu_core_blocked) and its sim_ns still
+ * counts the wait, while now_ns advances only with the other processes'
+ * accesses. When the disk (disk.h) has not picked its requests yet, the
+ * arrival is not known: the process stays blocked until it is, and is
+ * past. The caller must not resolve references of a blocked process, and
+ * when every process that could run is blocked, lets the clock run to the
+ * earliest arrival with mmu_core_idle (counted as CPU idle time).
+ */
+
+#include <stdio.h>
+#include "types.h"
+#include "policy.h"
+#include "refs.h"
+#include "pace.h"
+#include "tlb.h"
+#include "loadctl.h"
+#include "prefetch.h"
+#include "swap.h"
+
+typedef struct {
+    void *sm1_base;            /* page tables (SM1 layout, types.h) */
+    free_frame_list_t *ffl;    /* SM2 */
+    frame_entry_t *frames;     /* SM2 frame table */
+    int k;
+    int m;
+    int f;
+    uint64_t ts;               /* global timestamp, +1 per valid access; PTE
+                                  stamps keep its low 32 bits (memory.h) */
+    repl_policy_t *pol;
+    proc_stats_t *stats;       /* k counters, index p_ind */
+    pace_t pace;               /* mode none after init; set by the caller */
+    uint64_t now_ns;           /* virtual clock (PACE_VIRTUAL only) */
+    int last_pid;              /* p_ind of the previous access, -1 before the first */
+    int global;                /* victims may come from any process */
+    tlb_t *tlb;                /* NULL = no TLB; set by the caller, freed by destroy */
+    lc_t *lc;                  /* NULL = no load control; set by the caller, freed by destroy */
+    pf_t *pf;                  /* NULL = no prefetching; set by the caller, freed by destroy */
+    fa_cfg_t around;           /* pages 0 = no fault-around; set by the caller */
+    swap_t *swap;              /* NULL = no swap device; set by the caller, freed by destroy */
+    int async;                 /* faults complete in the background (PACE_VIRTUAL); set by the caller */
+    uint64_t *ready_ns;        /* k, async: when the last fault's page arrives */
+    signed char *io_wait;      /* k, async: ready_ns still waits for the disk */
+    signed char *ended;        /* k: made its last reference */
+    int exited;                /* processes ended */
+    uint64_t idle_ns;          /* async: time every process was blocked */
+} mmu_core_t;
+
+/* Set up a core over already-initialized SM1/SM2 and create policy 'policy'
+ * (NULL = "lru") with local or global replacement. 'refs' may be NULL
+ * unless the policy is offline.
+ * Returns 0 on success, -1 on unknown policy / OOM.
+ */
+int mmu_core_init(mmu_core_t *core, void *sm1_base, free_frame_list_t *ffl,
+                  int k, int m, int f, const char *policy, int global, const refs_t *refs);
+
+/* Release the policy, TLB and counters (not SM1/SM2). */
+void mmu_core_destroy(mmu_core_t *core);
+
+/* Resolve one access; see the header comment. */
+int mmu_resolve(mmu_core_t *core, int p_ind, int page_no, int m_req_for_pid, int *pfh_out);
+
+/* p_ind made its last reference. With load control its frames return to
+ * the FFL (and suspended processes that now fit are resumed); without it
+ * they stay mapped, as before. Its swap slots are freed, its dirty pages
+ * are not written back. Once every process has ended the disk serves the
+ * requests left in its queue.
+ */
+void mmu_core_exit(mmu_core_t *core, int p_ind);
+
+/* Async faults: p_ind waits for a page and may not make references */
+int mmu_core_blocked(mmu_core_t *core, int p_ind);
+
+/* Async faults: every process that could run is blocked; the CPU idles
+ * until the earliest page arrival of a process that has not ended. Returns
+ * 0 (the clock unchanged) if no such process waits.
+ */
+int mmu_core_idle(mmu_core_t *core);
+
+/* Log per-process and total counters ("[MMU] stats ..." lines); with global
+ * replacement they include frames stolen by other processes, with
+ * prefetching or fault-around the pages mapped ahead, used and wasted, in
+ * virtual mode they end with simulated time and effective access time. With a
+ * TLB, "[MMU] tlb ..." lines follow with hit rates and a translation EAT,
+ * with load control one "[MMU] loadctl ..." line with its counters.
+ * With a swap device the lines count writes, write-backs and swap-ins (with
+ * readahead the pages read ahead, used and wasted) and an "[MMU] swap ..."
+ * line describes the device, followed with -I by an
+ * "[MMU] disk ..." line: requests served, queue depth (maximum, and mean
+ * by Little's law), latency percentiles, throughput, utilization and seek
+ * time. With async faults the total line adds the CPU's idle time and
+ * utilization.
+ */
+void mmu_core_print_stats(const mmu_core_t *core);
+
+#endif /* MMU_CORE_H */
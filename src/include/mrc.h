@@ -0,0 +1,68 @@
+#ifndef MRC_H
+#define MRC_H
+
+/* mrc.h
+ * LRU miss-ratio curves from one pass over a reference file (Mattson's
+ * stack algorithm).
+ *
+ * LRU is a stack algorithm: a reference with stack distance d (the number
+ * of distinct pages used since the previous reference to the same page,
+ * that page included) hits with f frames exactly when d <= f. A histogram
+ * of distances therefore gives the fault count for every f at once:
+ *   faults(f) = cold + sum over d > f of hist[d]
+ * where cold counts first references. Distances come from a Fenwick tree
+ * over access times holding a 1 at each page's last access, so each
+ * reference costs O(log n) and a trace of n references O(n log n).
+ *
+ * Columns (vms-replay -m):
+ *   p<i>   : process i alone with f frames of its own (local LRU)
+ *   global : all processes in p_ind order sharing f frames (global LRU,
+ *            the same counts as vms-replay -g -p lru with f frames)
+ * A process's references stop at its first illegal page, as in a replay.
+ * Rows run from 1 frame to the largest finite distance of any column;
+ * beyond it every column stays at its cold-miss count.
+ *
+ * The exact curves need O(n) memory for the tree. mrc_build_sampled()
+ * estimates them with fixed-size SHARDS instead: only pages whose spatial
+ * hash falls below a threshold are tracked, at most 'cap' at a time, the
+ * threshold dropping as new pages would exceed the cap. Distances and
+ * counts are scaled by the inverse sampling rate, so memory is O(cap) plus
+ * the distance histograms (O(k*m)), whatever the trace length. Counts
+ * are rescaled so each column's references add up to the true number.
+ * Each estimate comes with err, a 2-sigma bound: the variance of
+ * references sampled independently at their rates, times the references
+ * per sampled page, since a page's references are sampled together; plus
+ * how far the curve moves within 2 sigma of the scaled distance around f
+ * (about Binomial(f, R) tracked pages over R), which dominates where the
+ * curve is steep.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include "refs.h"
+
+typedef struct {
+    int k;              /* processes; column k is the global curve */
+    int rows;           /* frame counts 1 .. rows */
+    uint64_t *faults;   /* (k+1) * rows: faults of column c with f frames at [c*rows + f-1] */
+    uint64_t *refs;     /* k+1: references counted per column */
+    double *err;        /* sampled only, laid out as faults: 2-sigma error of the estimate */
+    double *rate;       /* sampled only, k+1: final sampling rate per column */
+} mrc_t;
+
+/* Compute every column of 'refs'. Returns 0, or -1 on OOM. */
+int mrc_build(const refs_t *refs, mrc_t *out);
+
+/* Estimate every column with SHARDS, tracking at most 'cap' pages at a
+ * time. Returns 0, or -1 on OOM or cap <= 0. */
+int mrc_build_sampled(const refs_t *refs, int cap, mrc_t *out);
+
+/* Write "frames,p0,...,p<k-1>,global" and one row per frame count; each
+ * column is followed by <column>_err for sampled curves.
+ * Returns 0, or -1 on a write error. */
+int mrc_write_csv(const mrc_t *mrc, FILE *fp);
+
+/* Release what mrc_build() allocated. */
+void mrc_free(mrc_t *mrc);
+
+#endif /* MRC_H */
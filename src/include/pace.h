@@ -0,0 +1,55 @@
+#ifndef PACE_H
+#define PACE_H
+
+/* pace.h
+ * How fast the simulation runs, and how long its events take.
+ *
+ * Modes (selected with -P on master, mmu, scheduler and vms-replay):
+ *   none                        : run flat out, no time model (default)
+ *   real[:delay_us]             : sleep delay_us of wall-clock time per MMU
+ *                                 request and per dispatch, so a run can be
+ *                                 watched (default PACE_REAL_DELAY_US)
+ *   virtual[:hit,fault,ctx]     : run flat out and advance a simulated clock
+ *                                 by the modeled cost (ns) of every hit, page
+ *                                 fault and context switch
+ *
+ * Latencies the MMU reports (simulated time, effective access time) come from
+ * the virtual clock only, so they are identical from run to run and between
+ * the mmu binary and vms-replay.
+ */
+
+#include <stdint.h>
+
+typedef enum {
+    PACE_NONE = 0,
+    PACE_REAL,
+    PACE_VIRTUAL
+} pace_mode_t;
+
+#define PACE_REAL_DELAY_US 500000ul  /* real mode default: 0.5 s per event */
+
+/* virtual mode defaults (ns) */
+#define PACE_HIT_NS   100ull         /* memory access through the page table */
+#define PACE_FAULT_NS 8000000ull     /* page fault serviced from disk */
+#define PACE_CTX_NS   5000ull        /* switching to another process */
+
+typedef struct {
+    pace_mode_t mode;
+    unsigned long delay_us;  /* real */
+    uint64_t hit_ns;         /* virtual: cost model */
+    uint64_t fault_ns;
+    uint64_t ctx_ns;
+} pace_t;
+
+/* Parse a -P spec (see above). Missing fields keep their defaults.
+ * Returns 0 on success, -1 on a malformed spec.
+ */
+int pace_parse(const char *spec, pace_t *out);
+
+/* Mode name: "none", "real" or "virtual". */
+const char *pace_mode_name(pace_mode_t mode);
+
+/* Real mode: wait delay_us of wall-clock time. No-op in the other modes. */
+void pace_wait(const pace_t *p);
+
+#endif /* PACE_H */
@@ -0,0 +1,102 @@
+#ifndef POLICY_H
+#define POLICY_H
+
+/* policy.h
+ * Pluggable page-replacement policies for the MMU.
+ *
+ * A policy is a table of callbacks plus private state. The MMU keeps the
+ * PTEs (and the SM1 recency lists, see memory.h) up to date itself and calls
+ * into the policy only at these points:
+ *   on_hit        : resident page was accessed              (NULL = nothing to do)
+ *   on_fault      : page was just mapped into a frame on a demand reference
+ *                   (NULL = nothing to do)
+ *   choose_victim : FFL is empty, pick a resident page of pid to evict
+ *   choose_global : FFL is empty, pick a resident page of any process
+ *                   (global replacement only)
+ *   on_evict      : victim is about to be unmapped           (NULL = nothing to do)
+ *   on_map        : page was mapped ahead of any reference to it (prefetching);
+ *                   on_fault for the policies that do not tell them apart
+ *
+ * A hit therefore costs at most one indirect call. The MMU also stamps the
+ * page's SM1 last_used on every hit, but only for policies that read it
+ * (uses_ts); the others leave the timestamp array untouched on hits.
+ *
+ * Global replacement (mmu/master/vms-replay -g): the policy is created with
+ * the SM2 frame table (types.h) and every fault that finds no free frame
+ * calls choose_global instead of choose_victim. Every frame is in use at that
+ * point, so a policy can pick a frame and read its owner from the table.
+ * Each built-in policy applies its own rule to all resident pages: the global
+ * recency list for fifo and lru, a hand over frames for the clock family, one
+ * set of ARC lists over all pages for arc and car, one set of generations
+ * for mglru, one LIRS stack for lirs, a uniform frame for random, and for opt the furthest next use, assuming processes run in
+ * p_ind order (as vms-replay runs them; the live FCFS scheduler may not).
+ *
+ * Built-in policies (selected with mmu -p <name>):
+ *   fifo   : evict the page mapped earliest (SM1 list order, untouched by hits)
+ *   lru    : exact LRU via the SM1 recency lists (default)
+ *   lru-scan : exact LRU by scanning the SM1 timestamps at eviction; hits
+ *            only write the timestamp, faults cost O(m) (vectorized)
+ *   clock  : second chance; reference bits packed 64 to a word, a hand per
+ *            process swept a word at a time (hits set one bit)
+ *   esc    : enhanced second chance, prefers unreferenced pages whose PTE
+ *            is not PTE_DIRTY
+ *   gclock : generalized clock, referenced pages earn up to GCLOCK_MAX
+ *            extra revolutions
+ *   arc    : adaptive replacement cache, resident lists T1/T2 and ghost
+ *            lists B1/B2 of evicted pages steer the T1 target; scan resistant
+ *   car    : CLOCK-based ARC, hits only set a reference bit
+ *   mglru[:interval] : multi-generational LRU; hits set an accessed bit,
+ *            every 'interval' accesses an aging pass opens a new generation
+ *            for the accessed pages, victims come from the oldest one
+ *   lirs   : low inter-reference recency set; pages reused within a short
+ *            distance stay resident, so loops larger than memory still hit
+ *   random : uniform choice among the resident pages of the process
+ *   opt    : Belady's offline optimum; needs the reference file (mmu -r)
+ *
+ * Offline policies (opt) follow each process through its reference string:
+ * on_hit and on_fault must be the process's next reference, in order. Only
+ * a reference whose fault failed (no free frame, no page to evict) may be
+ * left out.
+ */
+
+#include "types.h"
+#include "refs.h"
+
+typedef struct repl_policy repl_policy_t;
+
+struct repl_policy {
+    const char *name;
+    void (*on_hit)(repl_policy_t *pol, int pid, int page_no);
+    void (*on_fault)(repl_policy_t *pol, int pid, int page_no);
+    int  (*choose_victim)(repl_policy_t *pol, int pid);  /* page_no, or -1 if none */
+    int  (*choose_global)(repl_policy_t *pol, int *pid_out);  /* page_no of *pid_out, or -1 */
+    void (*on_evict)(repl_policy_t *pol, int pid, int page_no);
+    void (*on_map)(repl_policy_t *pol, int pid, int page_no);
+    void (*destroy)(repl_policy_t *pol);                  /* frees priv */
+    int uses_ts;     /* reads last_used: the MMU stamps it on hits */
+
+    void *sm1_base;  /* page tables the policy reads (valid bits, recency lists) */
+    frame_entry_t *frames;  /* SM2 frame table; NULL = local replacement */
+    int k;           /* processes */
+    int m;           /* pages per process */
+    int f;           /* physical frames */
+    const refs_t *refs;  /* reference strings, NULL if the MMU was given none */
+    const char *args;    /* "name:args" suffix, for the policy's init only */
+    void *priv;      /* policy-private state (MMU memory, not shared) */
+};
+
+/* Create policy 'name' (or "name:args" for policies that take arguments)
+ * over an attached SM1. 'frames' is the SM2 frame table for global
+ * replacement, NULL for local. 'refs' may be NULL unless the policy is
+ * offline (opt). Returns NULL on unknown name, bad args, missing refs or OOM.
+ */
+repl_policy_t *policy_create(const char *name, void *sm1_base, frame_entry_t *frames,
+                             int k, int m, int f, const refs_t *refs);
+
+/* Release the policy and its private state. NULL is ignored. */
+void policy_destroy(repl_policy_t *pol);
+
+/* Space-separated list of the built-in names, for usage messages. */
+const char *policy_names(void);
+
+#endif /* POLICY_H */
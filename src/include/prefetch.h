@@ -0,0 +1,100 @@
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+/* prefetch.h
+ * Stride prefetching on page faults.
+ *
+ * A detector per process watches the pages it references (repeats of the
+ * same page are ignored). When the last PF_MIN_RUN steps had the same
+ * non-zero stride (1 or -1 for a sequential scan), the pattern is
+ * confirmed. A demand fault of a process with a confirmed pattern then maps
+ * the next 'depth' pages along it (page + stride, page + 2*stride, ...,
+ * skipping pages that are resident or outside the process's legal range).
+ * The first reference to a prefetched page is a hit and prefetches again
+ * from there, so a steady scan stays ahead of its faults.
+ *
+ * Prefetched pages carry PTE_PREFETCHED until their first reference; the
+ * MMU counts them as used then, or as wasted if they are unmapped first.
+ * Prefetch reads are not charged to the process in virtual pacing: they
+ * overlap with its run.
+ *
+ * Configuration (mmu/master/vms-replay -F):
+ *   none (the default) or depth[,free|evict]
+ *     depth : pages mapped ahead (1..PF_MAX_DEPTH)
+ *     free  : use free frames only, stop when the FFL is empty (default)
+ *     evict : when no frame is free, evict the policy's victim, the same
+ *             one a demand fault would (never the faulting page or a page
+ *             prefetched by the same fault)
+ *
+ * Fault-around, after Linux's fault_around_bytes, needs no pattern: a
+ * demand fault on page p also maps the other pages of p's aligned window
+ * of 'pages' pages (from p - p % pages) that are legal, not resident and
+ * have no copy in swap, as long as the FFL holds more than 'watermark'
+ * frames and load control (loadctl.h) did not tell the fault to replace. They need no I/O, so the fault's fault_ns pays for all of them;
+ * pages in swap are left to readahead (swap.h). They carry PTE_AROUND until
+ * their first reference and are counted as used or wasted like prefetched
+ * pages.
+ *
+ * Configuration (mmu/master/vms-replay -R):
+ *   none (the default) or pages[,watermark]
+ *     pages     : window size (2..FA_MAX_PAGES)
+ *     watermark : free frames left for demand faults (default 0)
+ */
+
+#include <stdint.h>
+
+#define PF_MAX_DEPTH 64
+#define PF_MIN_RUN 2
+#define FA_MAX_PAGES 64
+
+typedef struct {
+    int depth;    /* 0 = no prefetching */
+    int evict;    /* may evict to make room */
+} pf_cfg_t;
+
+typedef struct {
+    pf_cfg_t cfg;
+    int k;
+    int32_t *last;     /* k: last page referenced, -1 before the first */
+    int32_t *stride;   /* k: last step */
+    int32_t *run;      /* k: consecutive steps equal to stride */
+} pf_t;
+
+typedef struct {
+    int pages;        /* 0 = no fault-around */
+    int watermark;    /* map only while more frames than this are free */
+} fa_cfg_t;
+
+/* Parse a -F spec ("none" gives depth 0). Returns 0 on success, -1 if malformed. */
+int pf_parse(const char *spec, pf_cfg_t *out);
+
+/* Parse a -R spec ("none" gives pages 0). Returns 0 on success, -1 if malformed. */
+int fa_parse(const char *spec, fa_cfg_t *out);
+
+/* Detector state for k processes. Returns NULL on bad config / OOM. */
+pf_t *pf_create(const pf_cfg_t *cfg, int k);
+void pf_destroy(pf_t *pf);
+
+/* pid referenced page (hit or fault) */
+static inline void pf_observe(pf_t *pf, int pid, int page)
+{
+    int32_t step = page - pf->last[pid];
+    if (step == 0)
+        return;
+    if (pf->last[pid] >= 0 && step == pf->stride[pid])
+        pf->run[pid]++;
+    else
+    {
+        pf->stride[pid] = pf->last[pid] >= 0 ? step : 0;
+        pf->run[pid] = pf->last[pid] >= 0;
+    }
+    pf->last[pid] = page;
+}
+
+/* Confirmed stride of pid, or 0 if its references show no pattern */
+static inline int pf_stride(const pf_t *pf, int pid)
+{
+    return pf->run[pid] >= PF_MIN_RUN ? pf->stride[pid] : 0;
+}
+
+#endif /* PREFETCH_H */
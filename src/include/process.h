@@ -5,17 +5,25 @@
  * Process-side interface: generate references and talk to MMU.
  *
  * CLI usage (called by master via fork/exec):
- *   process <pid> <mq_ready_key> <mq_proc_key> <ref_len> <ref_0> <ref_1> ... <ref_n>
+ *   process [-b batch] [-x mq|shm] <mq_ready_key> <mq_proc_key> <ref_len> <p_ind> <m_req> <ref_0> <ref_1> ... <ref_n>
  *
  * Arguments:
- *   pid          : unique process ID (0..k-1)
+ *   batch        : >0 sends up to 'batch' references per MMU message
+ *                  (capped at IPC_BATCH_MAX); 0 (default) sends one at a time
+ *   -x           : transport of MQ3 (see ipc_chan_t in ipc.h), default mq
  *   mq_ready_key : MQ1 (ready queue key)
  *   mq_proc_key  : MQ3 (proc<->MMU key)
  *   ref_len      : number of page references
+ *   p_ind        : process index (0..k-1)
+ *   m_req        : pages the process may use; references outside [0, m_req)
+ *                  are INVALID (sent to the MMU with each request)
  *   ref_i        : each reference (page number, may include illegal values)
  */
 
+#include "ipc.h"
+
 int process_run(int mq_ready_key, int mq_proc_key,
-                int ref_len, int *ref_str, int p_ind);
+                int ref_len, int *ref_str, int p_ind, int m_req, int batch,
+                ipc_transport_t transport);
 
 #endif /* PROCESS_H */
@@ -0,0 +1,77 @@
+#ifndef REFS_H
+#define REFS_H
+
+/* refs.h
+ * Reference-string files: master writes every process's reference string to
+ * one file so offline consumers (OPT policy, replay, analysis) see exactly
+ * what the processes will send.
+ *
+ * File layout (native endianness, all fields 32-bit):
+ *   uint32_t magic   = REFS_MAGIC
+ *   int32_t  k       : number of processes
+ *   int32_t  m       : pages per process
+ *   uint32_t len[k]  : reference-string length of each process
+ *   int32_t  refs[]  : process 0's references, then process 1's, ...
+ *
+ * A reference is a page number, or'ed with REFS_WRITE if the access is a
+ * write (files without writes are read-only traces). Negative references
+ * are illegal pages and never writes.
+ *
+ * Loaded files are mmap'ed read-only, so a 10^8-entry trace costs page cache,
+ * not heap.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define REFS_MAGIC 0x52534D56u /* "VMSR" */
+
+#define REFS_WRITE 0x40000000
+
+/* Page of a reference (illegal negative ones are returned unchanged) */
+static inline int32_t ref_page(int32_t ref) {
+    return ref >= 0 ? ref & ~REFS_WRITE : ref;
+}
+
+static inline int ref_is_write(int32_t ref) {
+    return ref >= 0 && (ref & REFS_WRITE) != 0;
+}
+
+/* Sentinel in a next-use index: the page is never referenced again. */
+#define REFS_NEVER UINT32_MAX
+
+typedef struct {
+    int k;
+    int m;
+    const uint32_t *len;     /* k lengths */
+    uint64_t *off;           /* k start offsets into refs[] (heap) */
+    const int32_t *refs;     /* all references, process-major */
+    void *map;               /* mmap base */
+    size_t map_bytes;
+} refs_t;
+
+/* Write k reference strings (refs[i] has lens[i] entries) to path.
+ * Returns 0 on success, -1 on failure (errno set / message printed).
+ */
+int refs_write(const char *path, int k, int m, int *const refs[], const uint32_t lens[]);
+
+/* Map a reference file. Returns 0 on success, -1 on failure. */
+int refs_load(const char *path, refs_t *out);
+
+/* Unmap and release everything refs_load() allocated. */
+void refs_free(refs_t *r);
+
+/* References of process pid: refs_of(r, pid)[0 .. r->len[pid]) */
+static inline const int32_t *refs_of(const refs_t *r, int pid) {
+    return r->refs + r->off[pid];
+}
+
+/* Build the next-use index of process pid in one backward pass:
+ * next[i] = smallest j > i with refs[j] == refs[i], or REFS_NEVER.
+ * 'next' must hold r->len[pid] entries; 'scratch' must hold r->m entries.
+ * Out-of-range references (invalid pages) get REFS_NEVER.
+ * Returns 0 on success, -1 on bad arguments.
+ */
+int refs_next_use(const refs_t *r, int pid, uint32_t *next, uint32_t *scratch);
+
+#endif /* REFS_H */
@@ -5,14 +5,22 @@
  * FCFS Scheduler interface.
  *
  * CLI usage:
- *   scheduler <mq_ready_key> <mq_sched_key> <num_procs>
+ *   scheduler [-A] [-x mq|shm] [-P pace] <mq_ready_key> <mq_sched_key> <num_procs>
  *
  * Where:
+ *   -A           : also start the next process at every page fault (for the
+ *                  MMU's -A: the faulting process waits for its page)
+ *   -x           : transport of MQ2 (see ipc_chan_t in ipc.h), default mq
+ *   -P           : pacing (pace.h); real mode waits before every dispatch
  *   mq_ready_key : key for ready queue (MQ1)
  *   mq_sched_key : key for scheduler<->MMU communication (MQ2)
  *   num_procs    : number of processes to schedule
  */
 
-int scheduler_run(int mq_ready_key, int mq_sched_key, int num_procs);
+#include "ipc.h"
+#include "pace.h"
+
+int scheduler_run(int mq_ready_key, int mq_sched_key, int num_procs, ipc_transport_t transport,
+                  const pace_t *pace, int overlap);
 
 #endif /* SCHEDULER_H */
@@ -0,0 +1,123 @@
+#ifndef SWAP_H
+#define SWAP_H
+
+/* swap.h
+ * Simulated swap device: slot allocation and a latency model.
+ *
+ * A page gets a swap slot the first time it is written back, and keeps it
+ * until its process ends. Evicting a dirty page (PTE_DIRTY, set by write
+ * references) writes it to its slot. A clean page whose slot holds a copy
+ * is dropped at no cost, as is a clean page that never left memory. A
+ * fault on a page that has a slot reads it back (a swap-in); other faults
+ * need no device I/O.
+ *
+ * Requests go to a disk (disk.h) that serves one at a time, by default in
+ * arrival order with each taking read_ns or write_ns; -I adds seeks that
+ * depend on the slot and another scheduler. The MMU core issues them at
+ * the virtual clock (pace.h virtual mode) and the faulting process waits
+ * until these complete:
+ *   - the write-back of the page it evicts (the frame is reused after it)
+ *   - the read of its own page
+ * Write-backs of pages released by load control and prefetch reads are not
+ * waited for, but they keep the disk busy. Without virtual pacing only the
+ * counts matter.
+ *
+ * Clustering (cluster > 1): slots are handed out in aligned clusters of
+ * 'cluster' slots, one cluster at a time per process, so the pages a
+ * process evicts one after the other land in consecutive slots even when
+ * other processes evict in between. A dirty page's old copy is stale, so
+ * its write-back moves it to its process's current cluster. When no
+ * cluster is entirely free, any free slot is taken.
+ *
+ * Readahead (readahead > 1): a fault that reads page p from slot s also
+ * reads the other pages of the same process whose slots are in s's aligned
+ * window of 'readahead' slots and that are not resident, as long as the
+ * FFL has frames for them. The slots from the lowest to the highest one
+ * read go to the disk as a single request, which the faulting process
+ * waits for. The pages are mapped like prefetched ones (PTE_READAHEAD
+ * until their first reference); the MMU counts them as used or wasted.
+ *
+ * Configuration (mmu/master/vms-replay -D):
+ *   none (the default: evictions cost nothing) or
+ *   swap[:read_ns,write_ns,slots,cluster,readahead]
+ *     empty or left out fields keep the defaults
+ *     read_ns   : SWAP_READ_NS
+ *     write_ns  : SWAP_WRITE_NS
+ *     slots     : device size in pages (default k*m, never full)
+ *     cluster   : slots per cluster (default 0: the next free slot after
+ *                 the last one allocated, a page keeps its slot)
+ *     readahead : window in slots, at most SWAP_MAX_READAHEAD (default 0: none)
+ * When every slot is taken, a dirty page is dropped instead of written
+ * back and counted as 'full'.
+ */
+
+#include <stdint.h>
+#include "disk.h"
+
+#define SWAP_READ_NS 100000u
+#define SWAP_WRITE_NS 200000u
+#define SWAP_MAX_READAHEAD 256
+
+typedef struct {
+    int enabled;
+    uint32_t read_ns;
+    uint32_t write_ns;
+    int slots;          /* 0 = k*m */
+    int cluster;        /* slots per cluster, 0 or 1 = no clustering */
+    int readahead;      /* window in slots, 0 or 1 = no readahead */
+} swap_cfg_t;
+
+typedef struct {
+    swap_cfg_t cfg;
+    int k;
+    int m;
+    int nslots;
+    int32_t *slot;          /* k*m: slot of each page, -1 = none */
+    int32_t *owner;         /* nslots: pid * m + page in each slot, -1 = free */
+    uint64_t *map;          /* nslots bits: slot in use */
+    int used;
+    int hint;               /* next-fit start of the slot search */
+    int32_t *cl_next;       /* k, clustering: next slot of the process's cluster */
+    int32_t *cl_end;        /* k: end of that cluster */
+    uint64_t clusters;      /* clusters started */
+    disk_t *disk;
+    uint64_t reads;
+    uint64_t writes;
+    uint64_t full;          /* write-backs dropped for lack of a slot */
+} swap_t;
+
+/* Parse a -D spec ("none" gives enabled = 0). Returns 0 on success, -1 if malformed. */
+int swap_parse(const char *spec, swap_cfg_t *out);
+
+/* Create an empty device for k processes of m pages on a disk configured
+ * by 'disk'. Returns NULL on bad config / OOM.
+ */
+swap_t *swap_create(const swap_cfg_t *cfg, const disk_cfg_t *disk, int k, int m);
+void swap_destroy(swap_t *sw);
+
+/* Slot holding a copy of (pid, page), or -1 */
+static inline int swap_slot(const swap_t *sw, int pid, int page)
+{
+    return sw->slot[(size_t)pid * sw->m + page];
+}
+
+/* Page of pid held in slot, or -1 */
+static inline int swap_page(const swap_t *sw, int slot, int pid)
+{
+    int32_t n = sw->owner[slot] - pid * sw->m;
+    return sw->owner[slot] >= 0 && n >= 0 && n < sw->m ? n : -1;
+}
+
+/* Queue the write-back of (pid, page) arriving at 'at', allocating its slot
+ * if needed; waiter is -1 or the process blocked on it (disk_submit).
+ * Returns 1, or 0 if the device is full (nothing written).
+ */
+int swap_write(swap_t *sw, int pid, int page, uint64_t at, int waiter);
+
+/* Queue one read of the n slots from 'slot' arriving at 'at' */
+void swap_read(swap_t *sw, int slot, int n, uint64_t at, int waiter);
+
+/* pid ended: free all of its slots */
+void swap_release(swap_t *sw, int pid);
+
+#endif /* SWAP_H */
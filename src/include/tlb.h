@@ -0,0 +1,111 @@
+#ifndef TLB_H
+#define TLB_H
+
+/* tlb.h
+ * Software model of a set-associative TLB in front of the page tables.
+ *
+ * The MMU core consults it before the page-table lookup. A TLB hit gives
+ * the frame without reading the PTE; a miss walks the page table and, if
+ * the page is resident, fills an entry. Replacement bookkeeping (PTE
+ * timestamps, policy on_hit) still runs on TLB hits, the way hardware still
+ * sets accessed bits, so the TLB changes costs and hit rates but never
+ * which page gets evicted.
+ *
+ * Configuration (mmu/master/vms-replay -T):
+ *   none (no TLB, the default) or
+ *   entries[,ways[,lru|fifo|random[,asid|flush[,lookup_ns]]]]
+ *     entries   : total entries; entries/ways must be a power of two
+ *     ways      : associativity (1..TLB_MAX_WAYS, default 4)
+ *     lru/fifo/random : replacement within a set (default lru)
+ *     asid      : entries are tagged with the process (p_ind), survive
+ *                 context switches (default)
+ *     flush     : the whole TLB is flushed when the running process changes
+ *     lookup_ns : cost of a lookup for the effective-access-time estimate
+ *                 (default TLB_LOOKUP_NS)
+ *
+ * Consistency: the MMU calls tlb_invalidate() for every page it unmaps
+ * (a shootdown), and detects context switches as a change of p_ind between
+ * consecutive accesses (processes run one at a time under FCFS).
+ */
+
+#include <stdint.h>
+
+#define TLB_MAX_WAYS 64
+#define TLB_LOOKUP_NS 1u
+#define TLB_NO_TAG UINT64_MAX
+
+typedef enum {
+    TLB_REPL_LRU = 0,
+    TLB_REPL_FIFO,
+    TLB_REPL_RANDOM
+} tlb_repl_t;
+
+typedef struct {
+    int entries;
+    int ways;
+    tlb_repl_t repl;
+    int flush_on_switch;    /* 0 = ASID-tagged */
+    unsigned lookup_ns;
+} tlb_cfg_t;
+
+typedef struct {
+    tlb_cfg_t cfg;
+    unsigned set_mask;      /* sets - 1 */
+    uint64_t *tag;          /* entries; (asid << 32 | page) or TLB_NO_TAG */
+    int32_t *frame;         /* entries */
+    uint64_t *stamp;        /* entries; lru: last use, fifo: fill time, 0 = empty */
+    uint64_t clock;
+    uint32_t rng;           /* random replacement */
+    int k;
+    uint64_t *hits;         /* k, per process */
+    uint64_t *misses;       /* k */
+    uint64_t flushes;
+    uint64_t shootdowns;    /* entries removed by tlb_invalidate */
+} tlb_t;
+
+/* Parse a -T spec ("none" gives entries = 0). Returns 0 on success, -1 if malformed. */
+int tlb_parse(const char *spec, tlb_cfg_t *out);
+
+/* Create an empty TLB for k processes. Returns NULL on bad config / OOM. */
+tlb_t *tlb_create(const tlb_cfg_t *cfg, int k);
+void tlb_destroy(tlb_t *t);
+
+/* "lru", "fifo" or "random" */
+const char *tlb_repl_name(tlb_repl_t repl);
+
+static inline uint64_t tlb_key(int asid, int page)
+{
+    return ((uint64_t)(uint32_t)asid << 32) | (uint32_t)page;
+}
+
+/* Frame cached for (asid, page), or -1 on a miss. Counts the outcome.
+ * The way scan has no data-dependent branches.
+ */
+static inline int tlb_lookup(tlb_t *t, int asid, int page)
+{
+    uint64_t key = tlb_key(asid, page);
+    int base = (int)((unsigned)page & t->set_mask) * t->cfg.ways;
+    int way = -1;
+    for (int w = 0; w < t->cfg.ways; w++)
+        way = t->tag[base + w] == key ? w : way;
+    if (way < 0)
+    {
+        t->misses[asid]++;
+        return -1;
+    }
+    t->hits[asid]++;
+    if (t->cfg.repl == TLB_REPL_LRU)
+        t->stamp[base + way] = ++t->clock;
+    return t->frame[base + way];
+}
+
+/* Cache (asid, page) -> frame after a miss, replacing an entry of its set. */
+void tlb_fill(tlb_t *t, int asid, int page, int frame);
+
+/* Drop (asid, page) if cached (the page is being unmapped). */
+void tlb_invalidate(tlb_t *t, int asid, int page);
+
+/* Drop every entry. */
+void tlb_flush(tlb_t *t);
+
+#endif /* TLB_H */
@@ -0,0 +1,210 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+/* trace.h
+ * Logging and hot-path tracing shared by all binaries.
+ *
+ * Text logging: a .c file defines TRACE_TAG (e.g. "MMU") before including
+ * this header and uses
+ *   LOG_ERR(fmt, ...)   : errors                   (TRACE_LVL_ERROR)
+ *   LOG(fmt, ...)       : start/stop, per-process  (TRACE_LVL_INFO)
+ *   LOG_DEBUG(fmt, ...) : per-reference text       (TRACE_LVL_DEBUG)
+ * A level above TRACE_LEVEL compiles to nothing: its arguments only appear
+ * inside sizeof (TRACE_UNUSED), so they are type-checked but never evaluated.
+ *
+ * Binary events: TRACE_EV() appends one fixed-size record (trace_rec_t) to
+ * a ring buffer owned by the calling OS process; a background thread drains
+ * the ring into
+ *   $VMS_TRACE/<component>.<id>.trace
+ * Events are compiled in at TRACE_LVL_EVENT and above and recorded only when
+ * VMS_TRACE names a directory (master -t / vms-replay -t set it). With tracing
+ * off at run time an event costs one predictable branch. vms-tracedump turns
+ * trace files back into text.
+ *
+ * Build with e.g. `make TRACE_LEVEL=2` to strip events and debug text.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdatomic.h>
+
+#define TRACE_LVL_OFF   0
+#define TRACE_LVL_ERROR 1
+#define TRACE_LVL_INFO  2
+#define TRACE_LVL_EVENT 3
+#define TRACE_LVL_DEBUG 4
+
+#ifndef TRACE_LEVEL
+#define TRACE_LEVEL TRACE_LVL_EVENT
+#endif
+
+#ifndef TRACE_TAG
+#define TRACE_TAG "VMS"
+#endif
+
+#define TRACE_ENV "VMS_TRACE"  /* trace directory, inherited by children */
+
+/* ---------- Text ---------- */
+
+#define TRACE_TEXT(stream, fmt, ...)                                \
+    do                                                              \
+    {                                                               \
+        fprintf(stream, "[" TRACE_TAG "] " fmt "\n", ##__VA_ARGS__); \
+        fflush(stream);                                             \
+    } while (0)
+
+#define TRACE_UNUSED(expr) ((void)sizeof(expr))
+
+#if TRACE_LEVEL >= TRACE_LVL_ERROR
+#define LOG_ERR(fmt, ...) TRACE_TEXT(stderr, fmt, ##__VA_ARGS__)
+#else
+#define LOG_ERR(fmt, ...) TRACE_UNUSED(printf(fmt, ##__VA_ARGS__))
+#endif
+
+#if TRACE_LEVEL >= TRACE_LVL_INFO
+#define LOG(fmt, ...) TRACE_TEXT(stdout, fmt, ##__VA_ARGS__)
+#else
+#define LOG(fmt, ...) TRACE_UNUSED(printf(fmt, ##__VA_ARGS__))
+#endif
+
+#if TRACE_LEVEL >= TRACE_LVL_DEBUG
+#define LOG_DEBUG(fmt, ...) TRACE_TEXT(stdout, fmt, ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(fmt, ...) TRACE_UNUSED(printf(fmt, ##__VA_ARGS__))
+#endif
+
+/* ---------- Binary events ---------- */
+
+/* Event types; field use per type (unused fields are 0):
+ *                      pid     page    frame   aux
+ *   HIT            :   p_ind   page    frame   1 if a TLB hit
+ *   FAULT          :   p_ind   page    frame   -          (free frame)
+ *   EVICT          :   p_ind   page    frame   victim page
+ *   INVALID        :   p_ind   page    -       legal limit
+ *   FAIL           :   p_ind   page    -       -          (no victim)
+ *   END            :   p_ind   -       -       -          (MMU saw end-of-ref)
+ *   PROC_REF       :   os pid  page    frame   -          (process got a reply)
+ *   SCHED_FAULT    :   os pid  -       -       -
+ *   SCHED_DONE     :   os pid  -       -       -
+ *   RUN            :   -       run #   f       -          (vms-replay: new policy)
+ *   STEAL          :   victim  page    frame   p_ind that took the frame
+ *                      (global replacement, after the faulting process's EVICT)
+ *   RELEASE        :   p_ind   page    frame   why (0 trimmed, 1 suspended, 2 exit)
+ *                      (load control returned the frame to the FFL)
+ *   SUSPEND        :   p_ind   -       -       frames it held
+ *   RESUME         :   p_ind   -       -       -
+ *   PREFETCH       :   p_ind   page    frame   evicted page of the victim, -1 if free
+ *   SWAP_OUT       :   owner   page    frame   swap slot  (dirty page written back)
+ *   SWAP_IN        :   p_ind   page    frame   swap slot  (page read back on a fault)
+ *   READAHEAD      :   p_ind   page    frame   swap slot  (read with a SWAP_IN's page)
+ *   AROUND         :   p_ind   page    frame   faulting page (fault-around)
+ * ts is the MMU's logical clock where one exists, 0 otherwise.
+ */
+enum {
+    TRACE_EV_HIT = 1,
+    TRACE_EV_FAULT,
+    TRACE_EV_EVICT,
+    TRACE_EV_INVALID,
+    TRACE_EV_FAIL,
+    TRACE_EV_END,
+    TRACE_EV_PROC_REF,
+    TRACE_EV_SCHED_FAULT,
+    TRACE_EV_SCHED_DONE,
+    TRACE_EV_RUN,
+    TRACE_EV_STEAL,
+    TRACE_EV_RELEASE,
+    TRACE_EV_SUSPEND,
+    TRACE_EV_RESUME,
+    TRACE_EV_PREFETCH,
+    TRACE_EV_SWAP_OUT,
+    TRACE_EV_SWAP_IN,
+    TRACE_EV_READAHEAD,
+    TRACE_EV_AROUND,
+    TRACE_EV_COUNT
+};
+
+typedef struct {
+    uint64_t ts;
+    uint16_t type;   /* TRACE_EV_* */
+    uint16_t flags;  /* reserved */
+    int32_t pid;
+    int32_t page;
+    int32_t frame;
+    int32_t aux;
+    int32_t pad;
+} trace_rec_t;
+
+_Static_assert(sizeof(trace_rec_t) == 32, "trace records are 32 bytes on disk");
+
+/* Trace file: one header, then records until EOF */
+#define TRACE_MAGIC 0x54534D56u /* "VMST" */
+#define TRACE_VERSION 1
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t rec_bytes;  /* sizeof(trace_rec_t) */
+    char comp[16];       /* component, e.g. "mmu" */
+    int32_t id;          /* component instance (p_ind for processes) */
+    int32_t os_pid;
+} trace_file_hdr_t;
+
+#define TRACE_RING_RECS (1u << 16)  /* power of two */
+
+/* Single-producer (the traced thread) / single-consumer (writer) ring */
+typedef struct {
+    _Alignas(64) _Atomic uint64_t head;  /* next slot to fill (producer) */
+    uint64_t tail_cache;                 /* producer's last view of tail */
+    uint64_t stalls;                     /* times the producer found it full */
+    uint64_t dropped;                    /* records lost after the writer failed */
+    _Alignas(64) _Atomic uint64_t tail;  /* next slot to drain (writer) */
+    _Atomic int failed;                  /* writer gave up on an I/O error */
+    _Alignas(64) trace_rec_t rec[TRACE_RING_RECS];
+} trace_ring_t;
+
+extern trace_ring_t *g_trace;  /* NULL while tracing is off */
+
+/* Start tracing for this OS process if VMS_TRACE is set and events are
+ * compiled in. The file is flushed and closed at exit (atexit). Returns 0 if
+ * tracing is on or off as configured, -1 if it was requested but failed.
+ */
+int trace_open(const char *comp, int id);
+
+/* Drain the ring and close the file (idempotent; registered with atexit). */
+void trace_close(void);
+
+/* Producer slow path: wait for the writer to free a slot. Returns 0, or -1
+ * if the writer has failed and the record must be dropped. */
+int trace_wait_space(trace_ring_t *r, uint64_t head);
+
+static inline void trace_emit(int type, uint64_t ts, int pid, int page, int frame, int aux)
+{
+    trace_ring_t *r = g_trace;
+    uint64_t h = atomic_load_explicit(&r->head, memory_order_relaxed);
+    if (h - r->tail_cache >= TRACE_RING_RECS && trace_wait_space(r, h) != 0)
+        return;
+    trace_rec_t *e = &r->rec[h & (TRACE_RING_RECS - 1)];
+    e->ts = ts;
+    e->type = (uint16_t)type;
+    e->flags = 0;
+    e->pid = pid;
+    e->page = page;
+    e->frame = frame;
+    e->aux = aux;
+    e->pad = 0;
+    atomic_store_explicit(&r->head, h + 1, memory_order_release);
+}
+
+#if TRACE_LEVEL >= TRACE_LVL_EVENT
+#define TRACE_EV(type, ts, pid, page, frame, aux)                       \
+    do                                                                  \
+    {                                                                   \
+        if (__builtin_expect(g_trace != NULL, 0))                       \
+            trace_emit((type), (uint64_t)(ts), (pid), (page), (frame), (aux)); \
+    } while (0)
+#else
+#define TRACE_EV(type, ts, pid, page, frame, aux) \
+    TRACE_UNUSED((type) + (ts) + (pid) + (page) + (frame) + (aux))
+#endif
+
+#endif /* TRACE_H */
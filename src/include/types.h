@@ -5,11 +5,20 @@
  * Core data structures for the VM simulator.
  *
  * Shared memory layout (SM1):
- *   We store k page tables back-to-back. Each page table has exactly m entries (virtual pages).
- *   PTE fields: frame_no, valid bit, last_used timestamp.
+ *   We store k page-table regions back-to-back. Each region is a structure of
+ *   arrays over the process's m virtual pages:
+ *     pte_t    word[m]       frame number and flag bits (pte_* accessors below)
+ *     uint32_t last_used[m]  timestamp of the last access
+ *     lru_link_t link[m+1]   link[p] chains resident page p into the process's
+ *                            recency list, link[m] is the list sentinel
+ *   Victim scans read only the word and last_used arrays, 8 bytes per page,
+ *   contiguous, so they vectorize (see choose_lru_victim_local()).
  *
  * Shared memory layout (SM2):
- *   Free frame list (FFL) holding up to f frame indices and simple queue metadata.
+ *   Free frame list (FFL) holding up to f frame indices and simple queue metadata,
+ *   followed by the frame table: f+1 frame_entry_t, the reverse map of each
+ *   frame to its (pid, page) plus a global recency list over the used frames
+ *   (entry [f] is the sentinel). See frame_table() in memory.h.
  *
  * NOTE: Only the MMU updates timestamps (global access counter), so page-table
  * writes are serialized through MMU logic.
@@ -21,18 +30,74 @@
 #define MAX_PROCESSES   256   /* sanity cap for tests; not hard-locked */
 #define MAX_VPAGES      4096  /* cap on m; adjust as needed */
 
+/* Packed PTE word:
+ *   bits 0..PTE_FLAG_BITS-1 : flags (PTE_VALID, PTE_DIRTY, PTE_PREFETCHED, PTE_READAHEAD,
+ *                             PTE_AROUND)
+ *   bits PTE_FLAG_BITS..31  : frame number (meaningful only while valid)
+ * An unmapped page has word = 0.
+ */
+#define PTE_VALID      0x1u
+#define PTE_DIRTY      0x2u   /* written since mapped: eviction writes it back (swap.h) */
+#define PTE_PREFETCHED 0x4u   /* mapped by prefetch.h, not referenced since */
+#define PTE_READAHEAD  0x8u   /* read in by swap readahead (swap.h), not referenced since */
+#define PTE_AROUND     0x10u  /* mapped by fault-around (prefetch.h), not referenced since */
+#define PTE_FLAG_BITS  5
+#define PTE_FLAG_MASK  ((1u << PTE_FLAG_BITS) - 1)
+#define PTE_MAX_FRAMES (1u << (32 - PTE_FLAG_BITS))
+
 typedef struct {
-    int  frame_no;   /* >=0 if mapped, else -1 */
-    int  valid;      /* 1 if in memory, 0 if not */
-    int  last_used;  /* global timestamp when last accessed (for LRU) */
+    uint32_t word;       /* frame << PTE_FLAG_BITS | flags */
 } pte_t;
 
+static inline int pte_valid(const pte_t *pte) {
+    return (pte->word & PTE_VALID) != 0;
+}
+
+/* Frame of a valid PTE */
+static inline int pte_frame(const pte_t *pte) {
+    return (int)(pte->word >> PTE_FLAG_BITS);
+}
+
+/* Map to 'frame' (< PTE_MAX_FRAMES); the other flag bits are cleared */
+static inline void pte_map(pte_t *pte, int frame) {
+    pte->word = ((uint32_t)frame << PTE_FLAG_BITS) | PTE_VALID;
+}
+
+static inline void pte_unmap(pte_t *pte) {
+    pte->word = 0;
+}
+
+/* Intrusive recency-list node for one page (indices into the same page table).
+ * sentinel.next is the LRU page, sentinel.prev the MRU page; a non-resident
+ * page has prev = next = -1.
+ */
+typedef struct {
+    int prev;
+    int next;
+} lru_link_t;
+
 /* Per-process (optional) counters kept in SM1 footer or elsewhere.
  * If you prefer, you can keep these in the master/MMU private memory, not required in SHM.
  */
 typedef struct {
     int page_faults;
     int invalid_refs;
+    int hits;
+    int evictions;
+    int stolen;       /* frames taken by other processes' faults (global replacement) */
+    int prefetched;       /* pages mapped ahead by prefetch.h */
+    int prefetch_used;    /* ... referenced later */
+    int prefetch_wasted;  /* ... unmapped before any reference */
+    int writes;       /* write references (refs.h REFS_WRITE) */
+    int write_backs;  /* dirty pages written to swap (swap.h) */
+    int swap_ins;     /* faults that read the page back from swap */
+    int readahead;        /* pages read in around a swap-in (swap.h) */
+    int readahead_used;   /* ... referenced later */
+    int readahead_wasted; /* ... unmapped before any reference */
+    int around;           /* pages mapped around a fault (prefetch.h fault-around) */
+    int around_used;      /* ... referenced later */
+    int around_wasted;    /* ... unmapped before any reference */
+    uint64_t sim_ns;  /* simulated time of this process's accesses (pace.h virtual mode) */
 } proc_stats_t;
 
 /* Free Frame List (SM2) — single-producer (MMU) model is fine for this simulator. */
@@ -45,6 +110,17 @@ typedef struct {
     int frames[];      /* flexible array member; allocate with sizeof + f*sizeof(int) */
 } free_frame_list_t;
 
+/* Frame table entry (SM2): who holds the frame, and its place in the global
+ * recency list (prev/next are frame numbers, f = sentinel, -1 = not linked).
+ * sentinel.next is the least recently mapped/touched frame.
+ */
+typedef struct {
+    int pid;    /* owner p_ind, -1 if the frame is free */
+    int page;   /* owner's virtual page */
+    int prev;
+    int next;
+} frame_entry_t;
+
 /* ---------- Constants for special MMU returns ---------- */
 enum {
     MMU_HIT_MIN      = 0,  /* any non-negative is treated as a frame number */
@@ -56,16 +132,30 @@ enum {
 // inline → removes function call overhead
 // Without static, putting this function in a header file would generate a multiple definition error if included in several .c files
 /* ---------- Helpers for working with SM1 layout ---------- */
-/* We store k page tables each of length m, contiguous:
- * SM1 size in bytes = k * m * sizeof(pte_t)
+/* We store k page-table regions each of m PTEs, m timestamps and (m+1) LRU links, contiguous:
+ * SM1 size in bytes = k * pt_region_bytes(m)
  */
+static inline size_t pt_region_bytes(int m) {
+    return (size_t)m * (sizeof(pte_t) + sizeof(uint32_t)) + ((size_t)m + 1) * sizeof(lru_link_t);
+}
+
 static inline size_t sm1_bytes_for_k_m(int k, int m) {
-    return (size_t)k * (size_t)m * sizeof(pte_t);
+    return (size_t)k * pt_region_bytes(m);
 }
 
 /* Compute pointer to the start of process 'pid' page table inside SM1 (0 <= pid < k) */
 static inline pte_t* pt_base_for_pid(void *sm1_base, int pid, int m) {
-    return (pte_t*)sm1_base + ((size_t)pid * (size_t)m);
+    return (pte_t*)((char*)sm1_base + (size_t)pid * pt_region_bytes(m));
+}
+
+/* last_used timestamps of process 'pid', one per page */
+static inline uint32_t* pt_ts_for_pid(void *sm1_base, int pid, int m) {
+    return (uint32_t*)(pt_base_for_pid(sm1_base, pid, m) + m);
+}
+
+/* LRU links of process 'pid': entries [0, m) per page, entry [m] is the sentinel */
+static inline lru_link_t* lru_links_for_pid(void *sm1_base, int pid, int m) {
+    return (lru_link_t*)(pt_ts_for_pid(sm1_base, pid, m) + m);
 }
 
 /* Bounds checking helper (callers should guard in debug builds) */
@@ -73,4 +163,9 @@ static inline pte_t* pte_addr(void *sm1_base, int pid, int m, int page_no) {
     return pt_base_for_pid(sm1_base, pid, m) + page_no;
 }
 
+/* last_used of (pid, page_no) */
+static inline uint32_t* pte_ts_addr(void *sm1_base, int pid, int m, int page_no) {
+    return pt_ts_for_pid(sm1_base, pid, m) + page_no;
+}
+
 #endif /* TYPES_H */
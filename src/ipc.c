@@ -1,10 +1,16 @@
 #include "ipc.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <limits.h>
 #include <sys/types.h>
 #include <sys/ipc.h>
 #include <sys/msg.h>
 #include <sys/shm.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <sched.h>
 #include <errno.h>
 #include <string.h>
 #include <unistd.h>
@@ -143,6 +149,298 @@ ssize_t ipc_recv_msg_nb(ipc_mqid_t mqid, ipc_msg_t *msg, long mtype)
     return msg_len;
 }
 
+/* ---------- Batched messages ---------- */
+
+int ipc_send_batch(ipc_mqid_t mqid, const ipc_batch_msg_t *msg)
+{
+    if (msg->count < 0 || msg->count > IPC_BATCH_MAX)
+    {
+        fprintf(stderr, "ipc_send_batch: bad count %d\n", msg->count);
+        return -1;
+    }
+    /* trim the unused tail of vals[] so a short batch costs a short copy */
+    size_t payload_sz = ipc_batch_bytes(msg) - sizeof(long);
+    if (msgsnd(mqid, (void *)msg, payload_sz, 0) == -1)
+    {
+        perror("msgsnd(batch)");
+        return -1;
+    }
+    return 0;
+}
+
+ssize_t ipc_recv_batch(ipc_mqid_t mqid, ipc_batch_msg_t *msg, long mtype)
+{
+    ssize_t payload_sz = sizeof(ipc_batch_msg_t) - sizeof(long);
+    ssize_t msg_len = msgrcv(mqid, msg, payload_sz, mtype, 0);
+    if (msg_len == -1)
+    {
+        perror("msgrcv(batch)");
+        return -1;
+    }
+    return msg_len;
+}
+
+/* ---------- Shared-memory ring transport ---------- */
+
+/* Segment layout: header, then 2*npeers rings: ring[2p] = peer p -> hub ("up"),
+ * ring[2p+1] = hub -> peer p ("down"). Every ring has exactly one producer
+ * and one consumer, so head/tail need no CAS.
+ */
+
+#define IPC_RING_MAGIC 0x52494E47u          /* "RING" */
+#define IPC_RING_SLOTS 4                    /* requests are synchronous; 4 is plenty */
+#define IPC_RING_SLOT_BYTES ((sizeof(ipc_batch_msg_t) + 63) & ~(size_t)63)
+#define IPC_SPIN_ITERS 4000                 /* polls before sleeping on the futex */
+
+/* Futex word plus a count of sleepers, so the fast path never syscalls */
+typedef struct {
+    _Atomic uint32_t seq;
+    _Atomic uint32_t sleepers;
+} ipc_bell_t;
+
+typedef struct {
+    _Alignas(64) _Atomic uint32_t tail;  /* written by the producer */
+    _Alignas(64) _Atomic uint32_t head;  /* written by the consumer */
+    _Alignas(64) ipc_bell_t data;        /* rung on push (down rings; up rings ring the hub bell) */
+    ipc_bell_t space;                    /* rung on pop, for a producer facing a full ring */
+    uint32_t len[IPC_RING_SLOTS];
+    _Alignas(64) unsigned char slot[IPC_RING_SLOTS][IPC_RING_SLOT_BYTES];
+} ipc_ring_t;
+
+typedef struct {
+    uint32_t magic;
+    int32_t npeers;
+    _Alignas(64) ipc_bell_t hub_bell;    /* rung by every up-ring push */
+    _Alignas(64) ipc_ring_t rings[];
+} ipc_ring_seg_t;
+
+static size_t ring_seg_bytes(int npeers)
+{
+    return sizeof(ipc_ring_seg_t) + 2 * (size_t)npeers * sizeof(ipc_ring_t);
+}
+
+static void cpu_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#else
+    sched_yield();
+#endif
+}
+
+static void bell_ring(ipc_bell_t *b)
+{
+    atomic_fetch_add(&b->seq, 1);
+    if (atomic_load(&b->sleepers))
+        syscall(SYS_futex, &b->seq, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+/* Sleep until the bell moves past 'seen'. Callers re-check their condition. */
+static void bell_wait(ipc_bell_t *b, uint32_t seen)
+{
+    atomic_fetch_add(&b->sleepers, 1);
+    if (atomic_load(&b->seq) == seen)
+        syscall(SYS_futex, &b->seq, FUTEX_WAIT, seen, NULL, NULL, 0);
+    atomic_fetch_sub(&b->sleepers, 1);
+}
+
+static int ring_push(ipc_ring_t *r, ipc_bell_t *bell, const void *msg, size_t bytes)
+{
+    uint32_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    int spins = 0;
+    while (tail - atomic_load_explicit(&r->head, memory_order_acquire) >= IPC_RING_SLOTS)
+    {
+        uint32_t seen = atomic_load(&r->space.seq);
+        if (tail - atomic_load_explicit(&r->head, memory_order_acquire) < IPC_RING_SLOTS)
+            break;
+        if (++spins < IPC_SPIN_ITERS)
+            cpu_relax();
+        else
+            bell_wait(&r->space, seen);
+    }
+    uint32_t i = tail % IPC_RING_SLOTS;
+    memcpy(r->slot[i], msg, bytes);
+    r->len[i] = (uint32_t)bytes;
+    atomic_store_explicit(&r->tail, tail + 1, memory_order_release);
+    bell_ring(bell);
+    return 0;
+}
+
+/* Non-blocking pop. Returns bytes, or 0 if the ring is empty. */
+static ssize_t ring_pop(ipc_ring_t *r, void *msg, size_t max_bytes)
+{
+    uint32_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    if (atomic_load_explicit(&r->tail, memory_order_acquire) == head)
+        return 0;
+    uint32_t i = head % IPC_RING_SLOTS;
+    size_t n = r->len[i] < max_bytes ? r->len[i] : max_bytes;
+    memcpy(msg, r->slot[i], n);
+    atomic_store_explicit(&r->head, head + 1, memory_order_release);
+    bell_ring(&r->space);
+    return (ssize_t)n;
+}
+
+int ipc_transport_parse(const char *name, ipc_transport_t *out)
+{
+    if (strcmp(name, "mq") == 0)
+        *out = IPC_TRANSPORT_MQ;
+    else if (strcmp(name, "shm") == 0)
+        *out = IPC_TRANSPORT_SHM;
+    else
+        return -1;
+    return 0;
+}
+
+ipc_shmid_t ipc_ring_create(key_t key, int npeers)
+{
+    if (npeers <= 0)
+        return -1;
+    ipc_shmid_t shmid = ipc_create_shm(key, ring_seg_bytes(npeers), IPC_CREAT | 0666);
+    if (shmid == -1)
+        return -1;
+    ipc_ring_seg_t *seg = ipc_attach_shm(shmid);
+    if (!seg)
+        return -1;
+    memset(seg, 0, ring_seg_bytes(npeers));
+    seg->npeers = npeers;
+    seg->magic = IPC_RING_MAGIC;
+    ipc_detach_shm(seg);
+    return shmid;
+}
+
+int ipc_chan_open(ipc_chan_t *ch, ipc_transport_t kind, key_t key, int self)
+{
+    memset(ch, 0, sizeof(*ch));
+    ch->kind = kind;
+    ch->self = self;
+    if (kind == IPC_TRANSPORT_MQ)
+    {
+        ch->mqid = ipc_create_mq(key, 0666);
+        return ch->mqid == -1 ? -1 : 0;
+    }
+    ipc_shmid_t shmid = shmget(key, 0, 0666);
+    if (shmid == -1)
+    {
+        perror("shmget(ring)");
+        return -1;
+    }
+    ipc_ring_seg_t *seg = ipc_attach_shm(shmid);
+    if (!seg)
+        return -1;
+    if (seg->magic != IPC_RING_MAGIC || self < IPC_HUB || self >= seg->npeers)
+    {
+        fprintf(stderr, "ipc_chan_open: bad ring segment or peer %d\n", self);
+        ipc_detach_shm(seg);
+        return -1;
+    }
+    ch->seg = seg;
+    return 0;
+}
+
+void ipc_chan_close(ipc_chan_t *ch)
+{
+    if (ch->kind == IPC_TRANSPORT_SHM && ch->seg)
+        ipc_detach_shm(ch->seg);
+    ch->seg = NULL;
+}
+
+/* MQ transport: mtype of a hub -> peer message, so that peers waiting on
+ * the same queue at the same time each get their own (MSGTYPE_* < 16) */
+static long mq_peer_type(long mtype, int peer)
+{
+    return mtype + 16L * (peer + 1);
+}
+
+int ipc_chan_send(ipc_chan_t *ch, int peer, const void *msg, size_t bytes)
+{
+    if (bytes < sizeof(long) || bytes > IPC_RING_SLOT_BYTES)
+    {
+        fprintf(stderr, "ipc_chan_send: bad size %zu\n", bytes);
+        return -1;
+    }
+    if (ch->kind == IPC_TRANSPORT_MQ)
+    {
+        union {
+            long mtype;
+            unsigned char bytes[IPC_RING_SLOT_BYTES];
+        } tagged;
+        if (ch->self == IPC_HUB)
+        {
+            memcpy(&tagged, msg, bytes);
+            tagged.mtype = mq_peer_type(tagged.mtype, peer);
+            msg = &tagged;
+        }
+        if (msgsnd(ch->mqid, (void *)msg, bytes - sizeof(long), 0) == -1)
+        {
+            perror("msgsnd(chan)");
+            return -1;
+        }
+        return 0;
+    }
+    ipc_ring_seg_t *seg = ch->seg;
+    if (ch->self == IPC_HUB)
+    {
+        if (peer < 0 || peer >= seg->npeers)
+            return -1;
+        ipc_ring_t *down = &seg->rings[2 * peer + 1];
+        return ring_push(down, &down->data, msg, bytes);
+    }
+    return ring_push(&seg->rings[2 * ch->self], &seg->hub_bell, msg, bytes);
+}
+
+ssize_t ipc_chan_recv(ipc_chan_t *ch, void *msg, size_t max_bytes, long mtype)
+{
+    if (ch->kind == IPC_TRANSPORT_MQ)
+    {
+        long want = ch->self == IPC_HUB ? mtype : mq_peer_type(mtype, ch->self);
+        ssize_t n = msgrcv(ch->mqid, msg, max_bytes - sizeof(long), want, 0);
+        if (n == -1)
+        {
+            if (errno != EINTR) /* callers retry */
+                perror("msgrcv(chan)");
+            return -1;
+        }
+        *(long *)msg = mtype;
+        return n + (ssize_t)sizeof(long);
+    }
+    ipc_ring_seg_t *seg = ch->seg;
+    int spins = 0;
+    if (ch->self != IPC_HUB)
+    {
+        ipc_ring_t *down = &seg->rings[2 * ch->self + 1];
+        for (;;)
+        {
+            uint32_t seen = atomic_load(&down->data.seq);
+            ssize_t n = ring_pop(down, msg, max_bytes);
+            if (n > 0)
+                return n;
+            if (++spins < IPC_SPIN_ITERS)
+                cpu_relax();
+            else
+                bell_wait(&down->data, seen);
+        }
+    }
+    /* hub: round-robin over the up rings so no peer starves the others */
+    for (;;)
+    {
+        uint32_t seen = atomic_load(&seg->hub_bell.seq);
+        for (int j = 0; j < seg->npeers; ++j)
+        {
+            int p = (ch->next_peer + j) % seg->npeers;
+            ssize_t n = ring_pop(&seg->rings[2 * p], msg, max_bytes);
+            if (n > 0)
+            {
+                ch->next_peer = (p + 1) % seg->npeers;
+                return n;
+            }
+        }
+        if (++spins < IPC_SPIN_ITERS)
+            cpu_relax();
+        else
+            bell_wait(&seg->hub_bell, seen);
+    }
+}
+
 /* ---------- Convenience wrappers for VM simulator ---------- */
 // either all three queues are ready, or none exist
 
@@ -0,0 +1,271 @@
+/* loadctl.c
+ * Working-set / page-fault-frequency load control (see loadctl.h).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "loadctl.h"
+
+static const char *mode_names[] = {"none", "ws", "pff"};
+
+const char *lc_mode_name(lc_mode_t mode)
+{
+    return mode <= LC_PFF ? mode_names[mode] : "?";
+}
+
+/* A rate in [0, 1]: "0.05", "1e-3" */
+static int parse_rate(const char *s, double *out)
+{
+    char *end;
+    double v = strtod(s, &end);
+    if (end == s || *end != '\0' || !(v >= 0.0 && v <= 1.0))
+        return -1;
+    *out = v;
+    return 0;
+}
+
+int lc_parse(const char *spec, lc_cfg_t *out)
+{
+    lc_cfg_t c = {LC_NONE, LC_WS_TAU, LC_PFF_LO, LC_PFF_HI};
+    size_t len = strcspn(spec, ":");
+    const char *args = spec[len] ? spec + len + 1 : NULL;
+    if (len == 4 && strncmp(spec, "none", 4) == 0 && !args)
+    {
+        *out = c;
+        return 0;
+    }
+    if (len == 2 && strncmp(spec, "ws", 2) == 0)
+    {
+        c.mode = LC_WS;
+        if (args)
+        {
+            char *end;
+            long v = strtol(args, &end, 10);
+            if (end == args || *end != '\0' || v < 1 || v > (1L << 30))
+                return -1;
+            c.tau = (uint32_t)v;
+        }
+    }
+    else if (len == 3 && strncmp(spec, "pff", 3) == 0)
+    {
+        c.mode = LC_PFF;
+        if (args)
+        {
+            char buf[64];
+            char *comma;
+            if (strlen(args) >= sizeof(buf))
+                return -1;
+            strcpy(buf, args);
+            if (!(comma = strchr(buf, ',')))
+                return -1;
+            *comma = '\0';
+            if (parse_rate(buf, &c.lo) != 0 || parse_rate(comma + 1, &c.hi) != 0 || c.lo > c.hi)
+                return -1;
+        }
+    }
+    else
+        return -1;
+    *out = c;
+    return 0;
+}
+
+lc_t *lc_create(const lc_cfg_t *cfg, int k, int m)
+{
+    if (cfg->mode == LC_NONE || k <= 0 || m <= 0)
+        return NULL;
+    lc_t *lc = calloc(1, sizeof(*lc));
+    if (!lc)
+        return NULL;
+    lc->cfg = *cfg;
+    lc->k = k;
+    lc->m = m;
+    size_t pages = (size_t)k * m;
+    lc->link = malloc((pages + (size_t)k) * sizeof(*lc->link));
+    lc->last = calloc(pages, sizeof(*lc->last));
+    lc->vt = calloc((size_t)k, sizeof(*lc->vt));
+    lc->last_fault = calloc((size_t)k, sizeof(*lc->last_fault));
+    lc->cut = calloc((size_t)k, sizeof(*lc->cut));
+    lc->resident = calloc((size_t)k, sizeof(*lc->resident));
+    lc->saved = calloc((size_t)k, sizeof(*lc->saved));
+    lc->state = calloc((size_t)k, sizeof(*lc->state));
+    lc->reported = calloc((size_t)k, sizeof(*lc->reported));
+    if (!lc->link || !lc->last || !lc->vt || !lc->last_fault || !lc->cut || !lc->resident ||
+        !lc->saved || !lc->state || !lc->reported)
+    {
+        lc_destroy(lc);
+        return NULL;
+    }
+    for (size_t n = 0; n < pages; ++n)
+        lc->link[n].prev = lc->link[n].next = -1;
+    for (int pid = 0; pid < k; ++pid)
+    {
+        int s = (int)pages + pid;
+        lc->link[s].prev = lc->link[s].next = s;
+    }
+    return lc;
+}
+
+void lc_destroy(lc_t *lc)
+{
+    if (!lc)
+        return;
+    free(lc->link);
+    free(lc->last);
+    free(lc->vt);
+    free(lc->last_fault);
+    free(lc->cut);
+    free(lc->resident);
+    free(lc->saved);
+    free(lc->state);
+    free(lc->reported);
+    free(lc);
+}
+
+static inline void lc_unlink(lc_t *lc, int n)
+{
+    lru_link_t *l = lc->link;
+    l[l[n].prev].next = l[n].next;
+    l[l[n].next].prev = l[n].prev;
+}
+
+/* append n at the MRU end of pid's list */
+static inline void lc_push(lc_t *lc, int pid, int n)
+{
+    lru_link_t *l = lc->link;
+    int s = lc->k * lc->m + pid;
+    l[n].prev = l[s].prev;
+    l[n].next = s;
+    l[l[s].prev].next = n;
+    l[s].prev = n;
+}
+
+/* A reference by a suspended process brings it back */
+static inline void lc_reference(lc_t *lc, int pid)
+{
+    lc->vt[pid]++;
+    if (lc->state[pid] == LC_SUSPENDED)
+    {
+        lc->state[pid] = LC_ACTIVE;
+        lc->resumes++;
+    }
+}
+
+void lc_touch(lc_t *lc, int pid, int page)
+{
+    int n = pid * lc->m + page;
+    lc_reference(lc, pid);
+    lc->last[n] = lc->vt[pid];
+    lc_unlink(lc, n);
+    lc_push(lc, pid, n);
+}
+
+int lc_fault(lc_t *lc, int pid)
+{
+    lc_reference(lc, pid);
+    if (lc->cfg.mode != LC_PFF)
+        return 1;
+    uint64_t prev = lc->last_fault[pid];
+    double rate = 1.0 / (double)(lc->vt[pid] - prev);
+    lc->last_fault[pid] = lc->vt[pid];
+    if (rate < lc->cfg.lo)
+    {
+        lc->cut[pid] = prev;
+        return 1;
+    }
+    return rate > lc->cfg.hi || lc->resident[pid] == 0;
+}
+
+void lc_map(lc_t *lc, int pid, int page)
+{
+    int n = pid * lc->m + page;
+    lc->last[n] = lc->vt[pid];
+    lc_push(lc, pid, n);
+    lc->resident[pid]++;
+}
+
+void lc_unmap(lc_t *lc, int pid, int page)
+{
+    int n = pid * lc->m + page;
+    if (lc->link[n].prev < 0)
+        return;
+    lc_unlink(lc, n);
+    lc->link[n].prev = lc->link[n].next = -1;
+    lc->resident[pid]--;
+}
+
+int lc_stale(lc_t *lc, int pid)
+{
+    int page = lc_lru(lc, pid);
+    if (page < 0)
+        return -1;
+    uint64_t last = lc->last[pid * lc->m + page];
+    uint64_t cut;
+    if (lc->cfg.mode == LC_WS)
+        cut = lc->vt[pid] > lc->cfg.tau ? lc->vt[pid] - lc->cfg.tau + 1 : 0;
+    else
+        cut = lc->cut[pid];
+    if (last >= cut)
+        return -1;
+    lc->trimmed++;
+    return page;
+}
+
+int lc_pick_suspend(lc_t *lc, int pid)
+{
+    for (int q = lc->k - 1; q >= 0; --q)
+    {
+        if (q == pid || lc->state[q] != LC_ACTIVE || lc->resident[q] == 0)
+            continue;
+        lc->state[q] = LC_SUSPENDED;
+        lc->saved[q] = lc->resident[q];
+        lc->swapped += (uint64_t)lc->resident[q];
+        lc->suspends++;
+        return q;
+    }
+    return -1;
+}
+
+int lc_pick_resume(lc_t *lc, int free_frames)
+{
+    int active = 0, first = -1;
+    for (int q = 0; q < lc->k; ++q)
+    {
+        if (lc->state[q] == LC_ACTIVE)
+            active++;
+        else if (lc->state[q] == LC_SUSPENDED)
+        {
+            if (lc->saved[q] <= free_frames)
+            {
+                first = q;
+                break;
+            }
+            if (first < 0)
+                first = q;
+        }
+    }
+    if (first < 0 || (active && lc->saved[first] > free_frames))
+        return -1;
+    lc->state[first] = LC_ACTIVE;
+    lc->resumes++;
+    return first;
+}
+
+void lc_exit(lc_t *lc, int pid)
+{
+    lc->state[pid] = LC_EXITED;
+}
+
+int lc_poll(lc_t *lc, int *pid)
+{
+    for (int q = 0; q < lc->k; ++q)
+    {
+        signed char now = lc->state[q] == LC_SUSPENDED;
+        if (now == lc->reported[q])
+            continue;
+        lc->reported[q] = now;
+        *pid = q;
+        return now ? LC_EV_SUSPEND : LC_EV_RESUME;
+    }
+    return LC_EV_NONE;
+}
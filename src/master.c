@@ -11,16 +11,27 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <sys/ipc.h>
 #include <sys/wait.h>
+#include <sys/stat.h>
+#include <errno.h>
 #include <time.h>
 #include "ipc.h"
 #include "types.h"
 #include "master.h"
 #include "utils.h"
 #include "memory.h"
-#include "utils.h"
+#include "refs.h"
+#include "pace.h"
+#include "tlb.h"
+#include "loadctl.h"
+#include "prefetch.h"
+#include "swap.h"
+
+#define TRACE_TAG "MASTER"
+#include "trace.h"
 
 // #define KEY_SM1 0x1111
 // #define KEY_SM2 0x2222
@@ -28,13 +39,6 @@
 // #define KEY_MQ2 0x4444
 // #define KEY_MQ3 0x5555
 
-#define LOG(fmt, ...)                                         \
-    do                                                        \
-    {                                                         \
-        fprintf(stdout, "[MASTER] " fmt "\n", ##__VA_ARGS__); \
-        fflush(stdout);                                       \
-    } while (0)
-
 // adding static makes the function have internal linkage → it is only visible inside the same .c file
 // const char *prog → prog points to a string that cannot be modified.
 // char *const argv[] → argv itself cannot point elsewhere, but its elements (char *) can be changed
@@ -76,10 +80,26 @@ int init_keys()
     return 0;
 }
 
-int master_run(int num_procs, int pgs_per_proc, int n_frms, int ref_len)
+/* Reference strings are written here so the MMU (opt policy) can read them */
+#define REFS_PATH "./tmp/refs.bin"
+
+int master_run(int num_procs, int pgs_per_proc, int n_frms, int ref_len, const master_opts_t *opts)
 {
-    srand(time(NULL));
-    LOG("Starting master: num_procs=%d pgs_per_proc=%d n_frms=%d ref_len=%d", num_procs, pgs_per_proc, n_frms, ref_len);
+    unsigned seed = opts->seeded ? opts->seed : (unsigned)time(NULL);
+    srand(seed);
+    LOG("Starting master: num_procs=%d pgs_per_proc=%d n_frms=%d ref_len=%d seed=%u",
+        num_procs, pgs_per_proc, n_frms, ref_len, seed);
+
+    /* children inherit the trace directory through the environment */
+    if (opts->trace_dir)
+    {
+        if (mkdir(opts->trace_dir, 0777) == -1 && errno != EEXIST)
+        {
+            perror(opts->trace_dir);
+            return 1;
+        }
+        setenv(TRACE_ENV, opts->trace_dir, 1);
+    }
 
     // create keys using ftok
     if (init_keys() == -1)
@@ -100,21 +120,11 @@ int master_run(int num_procs, int pgs_per_proc, int n_frms, int ref_len)
     pte_t *sm1_base = (pte_t *)ipc_attach_shm(shmid_sm1);
     free_frame_list_t *ffl = (free_frame_list_t *)ipc_attach_shm(shmid_sm2);
 
-    // initialising
-    for (int i = 0; i < num_procs * pgs_per_proc; i++)
-    {
-        sm1_base[i].valid = -1;
-        sm1_base[i].frame_no = -1;
-        sm1_base[i].last_used = -1;
-    }
-
-    ffl->total_frames = n_frms;
-    ffl->count = 0;
-    ffl->head = 0;
-    ffl->tail = n_frms % n_frms;
-    for (int i = 0; i < n_frms; i++)
+    // initialising (page tables + recency lists, full free frame list)
+    if (pt_init_all(sm1_base, num_procs, pgs_per_proc) != 0 || ffl_init(ffl, n_frms) != 0)
     {
-        ffl->frames[i] = i;
+        fprintf(stderr, "master: bad sizes k=%d m=%d f=%d\n", num_procs, pgs_per_proc, n_frms);
+        return 1;
     }
 
     /* --- Create message queues --- */
@@ -127,7 +137,29 @@ int master_run(int num_procs, int pgs_per_proc, int n_frms, int ref_len)
         return 1;
     }
 
-    char KEY_SM1_str[20], KEY_SM2_str[20], KEY_MQ1_str[20], KEY_MQ2_str[20], KEY_MQ3_str[20], k_str[20], m_str[20], n_str[20];
+    /* --- SHM transport: rings for MQ3 (one per process) and MQ2 (MMU only) --- */
+    ipc_shmid_t ring_mq2 = -1, ring_mq3 = -1;
+    if (opts->transport == IPC_TRANSPORT_SHM)
+    {
+        ring_mq3 = ipc_ring_create(KEY_MQ3, num_procs);
+        ring_mq2 = ipc_ring_create(KEY_MQ2, 1);
+        if (ring_mq2 == -1 || ring_mq3 == -1)
+        {
+            perror("ipc_ring_create");
+            return 1;
+        }
+    }
+    char *xport_str = opts->transport == IPC_TRANSPORT_SHM ? "shm" : "mq";
+    /* switches for the MMU: -g, -A, both, or "--", which just ends the options */
+    char mmu_flags[4] = "-";
+    if (opts->global)
+        strcat(mmu_flags, "g");
+    if (opts->async)
+        strcat(mmu_flags, "A");
+    if (!mmu_flags[1])
+        strcat(mmu_flags, "-");
+
+    char KEY_SM1_str[20], KEY_SM2_str[20], KEY_MQ1_str[20], KEY_MQ2_str[20], KEY_MQ3_str[20], k_str[20], m_str[20], n_str[20], batch_str[20];
     int_to_str((int)KEY_SM1, KEY_SM1_str, sizeof(KEY_SM1_str));
     int_to_str((int)KEY_SM2, KEY_SM2_str, sizeof(KEY_SM2_str));
     int_to_str((int)KEY_MQ1, KEY_MQ1_str, sizeof(KEY_MQ1_str));
@@ -136,10 +168,47 @@ int master_run(int num_procs, int pgs_per_proc, int n_frms, int ref_len)
     int_to_str(num_procs, k_str, sizeof(k_str));
     int_to_str(pgs_per_proc, m_str, sizeof(m_str));
     int_to_str(n_frms, n_str, sizeof(n_str));
+    int_to_str(opts->batch, batch_str, sizeof(batch_str));
+
+    // generate reference strings up front and save them for offline consumers
+    int **all_refs = malloc(num_procs * sizeof(int *));
+    uint32_t *lens = malloc(num_procs * sizeof(uint32_t));
+    for (int p_ind = 0; p_ind < num_procs; p_ind++)
+    {
+        // int m_req = 1 + rand() % m;
+        int *refs = malloc(ref_len * sizeof(int));
+        for (int i = 0; i < ref_len; i++)
+        {
+            // all legal for now(do +2 for illegal)
+            int choice = rand() % (pgs_per_proc); // some may be illegal
+            if (opts->write_pct > 0 && rand() % 100 < opts->write_pct)
+                choice |= REFS_WRITE;
+            refs[i] = choice;
+        }
+        all_refs[p_ind] = refs;
+        lens[p_ind] = (uint32_t)ref_len;
+    }
+    if (refs_write(REFS_PATH, num_procs, pgs_per_proc, all_refs, lens) != 0)
+    {
+        fprintf(stderr, "master: cannot write %s\n", REFS_PATH);
+        return 1;
+    }
 
     /* --- Spawn MMU --- */
     char *mmu_argv[] = {
         "./mmu",
+        "-b", batch_str,
+        "-p", (char *)opts->policy,
+        "-r", REFS_PATH,
+        "-x", xport_str,
+        "-P", (char *)opts->pace,
+        "-T", (char *)opts->tlb,
+        "-L", (char *)opts->loadctl,
+        "-F", (char *)opts->prefetch,
+        "-R", (char *)opts->around,
+        "-D", (char *)opts->swap,
+        "-I", (char *)opts->iosched,
+        mmu_flags,
         KEY_SM1_str, // sm1_key
         KEY_SM2_str, // sm2_key
         KEY_MQ2_str, // mq_sched
@@ -153,6 +222,9 @@ int master_run(int num_procs, int pgs_per_proc, int n_frms, int ref_len)
     // spawn scheduler
     char *sched_argv[] = {
         "./scheduler",
+        "-x", xport_str,
+        "-P", (char *)opts->pace,
+        opts->async ? "-A" : "--",
         KEY_MQ1_str,
         KEY_MQ2_str,
         k_str,
@@ -162,45 +234,43 @@ int master_run(int num_procs, int pgs_per_proc, int n_frms, int ref_len)
     // spawn processes
     for (int p_ind = 0; p_ind < num_procs; p_ind++)
     {
-        // int m_req = 1 + rand() % m;
-
-        // generate reference strings
-        int *refs = malloc(ref_len * sizeof(int));
-        for (int i = 0; i < ref_len; i++)
-        {
-            // all legal for now(do +2 for illegal)
-            int choice = rand() % (pgs_per_proc); // some may be illegal
-            refs[i] = choice;
-        }
+        int *refs = all_refs[p_ind];
 
         char ref_len_str[20], p_ind_str[20];
         int_to_str(ref_len, ref_len_str, sizeof(ref_len_str));
         int_to_str(p_ind, p_ind_str, sizeof(p_ind_str));
 
-        char **proc_argv = malloc((6 + ref_len) * sizeof(char *));
+        char **proc_argv = malloc((11 + ref_len) * sizeof(char *));
         proc_argv[0] = "./process";
-        proc_argv[1] = KEY_MQ1_str;
-        proc_argv[2] = KEY_MQ3_str;
-        proc_argv[3] = ref_len_str;
-        proc_argv[4] = p_ind_str;
+        proc_argv[1] = "-b";
+        proc_argv[2] = batch_str;
+        proc_argv[3] = "-x";
+        proc_argv[4] = xport_str;
+        proc_argv[5] = KEY_MQ1_str;
+        proc_argv[6] = KEY_MQ3_str;
+        proc_argv[7] = ref_len_str;
+        proc_argv[8] = p_ind_str;
+        proc_argv[9] = m_str; /* m_req: every process may use all m pages */
 
         for (int i = 0; i < ref_len; i++)
         {
             char *buf = malloc(20);
-            int_to_str(refs[i], buf, sizeof(buf));
-            proc_argv[5 + i] = buf;
+            int_to_str(refs[i], buf, 20);
+            proc_argv[10 + i] = buf;
         }
-        proc_argv[5 + ref_len] = NULL;
+        proc_argv[10 + ref_len] = NULL;
 
         LOG("Spawning process: %d", p_ind);
 
         spawn_child("./process", proc_argv);
         for (int i = 0; i < ref_len; i++)
-            free(proc_argv[5 + i]);
+            free(proc_argv[10 + i]);
         LOG("Cleaning");
         free(proc_argv);
         free(refs);
     }
+    free(all_refs);
+    free(lens);
 
     while (wait(NULL) > 0)
         ;
@@ -211,21 +281,105 @@ int master_run(int num_procs, int pgs_per_proc, int n_frms, int ref_len)
     msgctl(mq1, IPC_RMID, NULL);
     msgctl(mq2, IPC_RMID, NULL);
     msgctl(mq3, IPC_RMID, NULL);
+    if (ring_mq2 != -1)
+        ipc_remove_shm(ring_mq2);
+    if (ring_mq3 != -1)
+        ipc_remove_shm(ring_mq3);
 
     return 0;
 }
 
+static int usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s [-b batch] [-p policy] [-g] [-s seed] [-x mq|shm] [-t trace_dir] [-P pace] [-T tlb] [-L loadctl] [-F prefetch] [-R around] [-D swap] [-I iosched] [-w write_pct] [-A] <n_procs> <n_pgs_per_proc> <n_frms> <ref_len>\n", prog);
+    return 1;
+}
+
 int main(int argc, char **argv)
 {
-    if (argc != 5)
+    master_opts_t opts = {0, "lru", 0, 0, 0, IPC_TRANSPORT_MQ, NULL, "none", "none", "none", "none", "none", "none", "none", 0, 0};
+    pace_t pace = {0};
+    swap_cfg_t swap = {0};
+    disk_cfg_t disk = {0};
+    int opt;
+    while ((opt = getopt(argc, argv, "+Ab:D:F:gI:L:p:P:R:s:t:T:w:x:")) != -1)
     {
-        fprintf(stderr, "Usage: %s <n_procs> <n_pgs_per_proc> <n_frms> <ref_len>\n", argv[0]);
-        return 1;
+        switch (opt)
+        {
+        case 'b':
+            opts.batch = atoi(optarg);
+            break;
+        case 'p':
+            opts.policy = optarg;
+            break;
+        case 'g':
+            opts.global = 1;
+            break;
+        case 'P':
+            if (pace_parse(optarg, &pace) != 0)
+                return usage(argv[0]);
+            opts.pace = optarg;
+            break;
+        case 'A':
+            opts.async = 1;
+            break;
+        case 'T':
+            if (tlb_parse(optarg, &(tlb_cfg_t){0}) != 0)
+                return usage(argv[0]);
+            opts.tlb = optarg;
+            break;
+        case 'L':
+            if (lc_parse(optarg, &(lc_cfg_t){0}) != 0)
+                return usage(argv[0]);
+            opts.loadctl = optarg;
+            break;
+        case 'F':
+            if (pf_parse(optarg, &(pf_cfg_t){0}) != 0)
+                return usage(argv[0]);
+            opts.prefetch = optarg;
+            break;
+        case 'R':
+            if (fa_parse(optarg, &(fa_cfg_t){0}) != 0)
+                return usage(argv[0]);
+            opts.around = optarg;
+            break;
+        case 'D':
+            if (swap_parse(optarg, &swap) != 0)
+                return usage(argv[0]);
+            opts.swap = optarg;
+            break;
+        case 'I':
+            if (disk_parse(optarg, &disk) != 0)
+                return usage(argv[0]);
+            opts.iosched = optarg;
+            break;
+        case 'w':
+            opts.write_pct = atoi(optarg);
+            if (opts.write_pct < 0 || opts.write_pct > 100)
+                return usage(argv[0]);
+            break;
+        case 's':
+            opts.seed = (unsigned)strtoul(optarg, NULL, 10);
+            opts.seeded = 1;
+            break;
+        case 't':
+            opts.trace_dir = optarg;
+            break;
+        case 'x':
+            if (ipc_transport_parse(optarg, &opts.transport) != 0)
+                return usage(argv[0]);
+            break;
+        default:
+            return usage(argv[0]);
+        }
     }
-    int num_procs = atoi(argv[1]);
-    int pgs_per_proc = atoi(argv[2]);
-    int n_frms = atoi(argv[3]);
-    int ref_len = atoi(argv[4]);
+    if (argc - optind != 4 || (opts.async && pace.mode != PACE_VIRTUAL) || (disk.enabled && !swap.enabled))
+        return usage(argv[0]);
+    char **pos = argv + optind;
+    int num_procs = atoi(pos[0]);
+    int pgs_per_proc = atoi(pos[1]);
+    int n_frms = atoi(pos[2]);
+    int ref_len = atoi(pos[3]);
 
-    return master_run(num_procs, pgs_per_proc, n_frms, ref_len);
+    return master_run(num_procs, pgs_per_proc, n_frms, ref_len, &opts);
 }
\ No newline at end of file
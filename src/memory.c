@@ -1,36 +1,75 @@
 /* memory.c
  * Implementation of page-table initialization, free-frame list, and local LRU selection.
+ *
+ * Every mapping change keeps the per-process recency list in SM1 in step with
+ * the PTEs, so the LRU victim is always the head of that list.
  */
 
 #include "memory.h"
 #include <stdio.h>
+#include <string.h>
 #include "types.h"
 
+#if defined(__x86_64__) || defined(__i386__)
+#define LRU_SCAN_X86 1
+#else
+#define LRU_SCAN_X86 0
+#endif
+
+/* ---------- Recency list ops ---------- */
+
+static void lru_unlink(lru_link_t *lk, int page_no)
+{
+    lru_link_t *n = &lk[page_no];
+    lk[n->prev].next = n->next;
+    lk[n->next].prev = n->prev;
+    n->prev = n->next = -1;
+}
+
+/* Append page_no at the MRU end (just before the sentinel). */
+static void lru_push_mru(lru_link_t *lk, int m, int page_no)
+{
+    int mru = lk[m].prev;
+    lk[page_no].prev = mru;
+    lk[page_no].next = m;
+    lk[mru].next = page_no;
+    lk[m].prev = page_no;
+}
+
 /* ---------- Page table ops ---------- */
 
 int pt_init_all(void *sm1_base, int k, int m)
 {
     if (!sm1_base || k <= 0 || m <= 0)
         return -1;
-    pte_t *base = (pte_t *)sm1_base;
-    size_t total = (size_t)k * (size_t)m;
-    for (size_t i = 0; i < total; ++i)
+    for (int pid = 0; pid < k; ++pid)
     {
-        base[i].frame_no = -1;
-        base[i].valid = 0;
-        base[i].last_used = 0;
+        pte_t *pt = pt_base_for_pid(sm1_base, pid, m);
+        uint32_t *ts = pt_ts_for_pid(sm1_base, pid, m);
+        lru_link_t *lk = lru_links_for_pid(sm1_base, pid, m);
+        for (int p = 0; p < m; ++p)
+        {
+            pte_unmap(&pt[p]);
+            ts[p] = 0;
+            lk[p].prev = lk[p].next = -1;
+        }
+        lk[m].prev = lk[m].next = m; /* empty list: sentinel points to itself */
     }
     return 0;
 }
 
-int pt_set_mapping(void *sm1_base, int pid, int m, int page_no, int frame_no, int ts)
+int pt_set_mapping(void *sm1_base, int pid, int m, int page_no, int frame_no, uint32_t ts)
 {
-    if (!sm1_base || pid < 0 || m <= 0 || page_no < 0 || page_no >= m || frame_no < 0)
+    if (!sm1_base || pid < 0 || m <= 0 || page_no < 0 || page_no >= m || frame_no < 0 ||
+        (unsigned)frame_no >= PTE_MAX_FRAMES)
         return -1;
     pte_t *pte = pte_addr(sm1_base, pid, m, page_no);
-    pte->frame_no = frame_no;
-    pte->valid = 1;
-    pte->last_used = ts;
+    lru_link_t *lk = lru_links_for_pid(sm1_base, pid, m);
+    if (pte_valid(pte))
+        lru_unlink(lk, page_no);
+    pte_map(pte, frame_no);
+    *pte_ts_addr(sm1_base, pid, m, page_no) = ts;
+    lru_push_mru(lk, m, page_no);
     return 0;
 }
 
@@ -39,20 +78,30 @@ int pt_invalidate(void *sm1_base, int pid, int m, int page_no)
     if (!sm1_base || pid < 0 || m <= 0 || page_no < 0 || page_no >= m)
         return -1;
     pte_t *pte = pte_addr(sm1_base, pid, m, page_no);
-    pte->frame_no = -1;
-    pte->valid = 0;
+    if (pte_valid(pte))
+        lru_unlink(lru_links_for_pid(sm1_base, pid, m), page_no);
+    pte_unmap(pte);
     /* keep last_used as-is (optional) */
     return 0;
 }
 
-int pt_touch(void *sm1_base, int pid, int m, int page_no, int ts) {
+int pt_touch(void *sm1_base, int pid, int m, int page_no, uint32_t ts) {
     if (!sm1_base || pid < 0 || m <= 0 || page_no < 0 || page_no >= m) return -1;
     pte_t *pte = pte_addr(sm1_base, pid, m, page_no);
-    if (!pte->valid) return -1;
-    pte->last_used = ts;
+    if (!pte_valid(pte)) return -1;
+    *pte_ts_addr(sm1_base, pid, m, page_no) = ts;
+    lru_touch(sm1_base, pid, m, page_no);
     return 0;
 }
 
+void lru_touch(void *sm1_base, int pid, int m, int page_no) {
+    lru_link_t *lk = lru_links_for_pid(sm1_base, pid, m);
+    if (lk[m].prev != page_no) { /* already MRU: nothing to relink */
+        lru_unlink(lk, page_no);
+        lru_push_mru(lk, m, page_no);
+    }
+}
+
 int is_legal_page(int page_no, int m_req_for_pid) {
     return (page_no >= 0 && page_no < m_req_for_pid) ? 1 : 0;
 }
@@ -60,7 +109,7 @@ int is_legal_page(int page_no, int m_req_for_pid) {
 /* ---------- Free Frame List (FFL) ---------- */
 
 int ffl_init(free_frame_list_t *ffl, int f) {
-    if (!ffl || f <= 0) return -1;
+    if (!ffl || f <= 0 || (unsigned)f > PTE_MAX_FRAMES) return -1;
     ffl->total_frames = f;
     ffl->count = f;
     ffl->head = 0;
@@ -71,11 +120,18 @@ int ffl_init(free_frame_list_t *ffl, int f) {
     /* tail points to the next write position; since we prefilled with f entries,
        we advance tail by f in ring terms */
     ffl->tail = f % f; /* which is 0, but keep formula if you adapt later */
+    frame_entry_t *ft = frame_table(ffl);
+    for (int i = 0; i < f; ++i) {
+        ft[i].pid = ft[i].page = -1;
+        ft[i].prev = ft[i].next = -1;
+    }
+    ft[f].pid = ft[f].page = -1;
+    ft[f].prev = ft[f].next = f; /* empty list */
     return 0;
 }
 
 int ffl_alloc(free_frame_list_t *ffl) {
-    if (!ffl || ffl->count > ffl->total_frames) return -1;
+    if (!ffl || ffl->count <= 0) return -1;
     int idx = ffl->frames[ffl->head];
     ffl->head = (ffl->head + 1) % ffl->total_frames;
     ffl->count--;
@@ -91,18 +147,223 @@ int ffl_free(free_frame_list_t *ffl, int frame_idx) {
     return 0;
 }
 
-int choose_lru_victim_local(void *sm1_base, int pid, int m) {
+/* ---------- Frame table ---------- */
+
+static void ft_unlink(frame_entry_t *ft, int frame) {
+    frame_entry_t *e = &ft[frame];
+    ft[e->prev].next = e->next;
+    ft[e->next].prev = e->prev;
+    e->prev = e->next = -1;
+}
+
+static void ft_push_mru(frame_entry_t *ft, int f, int frame) {
+    int mru = ft[f].prev;
+    ft[frame].prev = mru;
+    ft[frame].next = f;
+    ft[mru].next = frame;
+    ft[f].prev = frame;
+}
+
+void ft_map(frame_entry_t *ft, int f, int frame, int pid, int page) {
+    if (ft[frame].prev >= 0)
+        ft_unlink(ft, frame);
+    ft[frame].pid = pid;
+    ft[frame].page = page;
+    ft_push_mru(ft, f, frame);
+}
+
+void ft_unmap(frame_entry_t *ft, int f, int frame) {
+    (void)f;
+    if (ft[frame].prev >= 0)
+        ft_unlink(ft, frame);
+    ft[frame].pid = ft[frame].page = -1;
+}
+
+void ft_touch(frame_entry_t *ft, int f, int frame) {
+    if (ft[f].prev != frame) {
+        ft_unlink(ft, frame);
+        ft_push_mru(ft, f, frame);
+    }
+}
+
+int lru_victim_local(void *sm1_base, int pid, int m) {
     if (!sm1_base || pid < 0 || m <= 0) return -1;
-    pte_t *pt = pt_base_for_pid(sm1_base, pid, m);
+    lru_link_t *lk = lru_links_for_pid(sm1_base, pid, m);
+    int head = lk[m].next;
+    return head == m ? -1 : head;
+}
+
+/* ---------- LRU victim scan ----------
+ * Oldest valid page over the SoA arrays. The vector kernels turn every
+ * invalid page's timestamp into UINT32_MAX (key = ts | (valid ? 0 : ~0)) and
+ * keep a per-lane running minimum and the index it came from, so the loop
+ * has no branches. Lanes are merged at the end, preferring the lower index
+ * on equal keys, which gives the same page as the scalar loop. A table
+ * with no valid page gives -1; a valid page with a saturated timestamp
+ * (UINT32_MAX, indistinguishable from invalid) is left to the scalar loop.
+ */
+
+typedef int (*lru_scan_fn)(const pte_t *pt, const uint32_t *ts, int m);
+
+static int lru_scan_scalar(const pte_t *pt, const uint32_t *ts, int m)
+{
     int victim = -1;
-    int oldest_ts = 0; /* will be set on first valid */
+    uint32_t oldest_ts = 0; /* will be set on first valid */
     for (int p = 0; p < m; ++p) {
-        if (pt[p].valid) {
-            if (victim == -1 || pt[p].last_used < oldest_ts) {
+        if (pte_valid(&pt[p])) {
+            if (victim == -1 || ts[p] < oldest_ts) {
                 victim = p;
-                oldest_ts = pt[p].last_used;
+                oldest_ts = ts[p];
             }
         }
     }
     return victim; /* -1 if no valid page found */
-}
\ No newline at end of file
+}
+
+#if LRU_SCAN_X86
+#include <immintrin.h>
+
+/* Merge 'lanes' (key, index) pairs and finish the tail [from, m) scalar.
+ * any_valid: some page in [0, from) is valid. */
+static int lru_scan_finish(const uint32_t *key, const int32_t *idx, int lanes, int any_valid,
+                           const pte_t *pt, const uint32_t *ts, int from, int m)
+{
+    uint32_t best = UINT32_MAX;
+    int victim = -1;
+    for (int l = 0; l < lanes; ++l)
+        if (key[l] < best || (key[l] == best && idx[l] < victim)) {
+            best = key[l];
+            victim = idx[l];
+        }
+    for (int p = from; p < m; ++p)
+        if (pte_valid(&pt[p])) {
+            any_valid = 1;
+            if (ts[p] < best) {
+                best = ts[p];
+                victim = p;
+            }
+        }
+    if (best == UINT32_MAX)
+        return any_valid ? lru_scan_scalar(pt, ts, m) : -1;
+    return victim;
+}
+
+__attribute__((target("sse4.1")))
+static int lru_scan_sse41(const pte_t *pt, const uint32_t *ts, int m)
+{
+    const uint32_t *word = &pt[0].word;
+    const __m128i valid = _mm_set1_epi32(PTE_VALID);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i step = _mm_set1_epi32(4);
+    __m128i vmin = _mm_set1_epi32(-1);
+    __m128i vidx = _mm_set1_epi32(-1);
+    __m128i vinv = _mm_set1_epi32(-1); /* lanes that saw only invalid pages */
+    __m128i cur = _mm_setr_epi32(0, 1, 2, 3);
+    int p = 0;
+    for (; p + 4 <= m; p += 4) {
+        __m128i w = _mm_loadu_si128((const __m128i *)(word + p));
+        __m128i t = _mm_loadu_si128((const __m128i *)(ts + p));
+        __m128i inv = _mm_cmpeq_epi32(_mm_and_si128(w, valid), zero);
+        __m128i key = _mm_or_si128(t, inv);
+        __m128i keep = _mm_cmpeq_epi32(_mm_max_epu32(key, vmin), key); /* key >= vmin */
+        vidx = _mm_blendv_epi8(cur, vidx, keep);
+        vmin = _mm_min_epu32(vmin, key);
+        vinv = _mm_and_si128(vinv, inv);
+        cur = _mm_add_epi32(cur, step);
+    }
+    uint32_t key[4];
+    int32_t idx[4];
+    _mm_storeu_si128((__m128i *)key, vmin);
+    _mm_storeu_si128((__m128i *)idx, vidx);
+    int any_valid = _mm_movemask_epi8(vinv) != 0xffff;
+    return lru_scan_finish(key, idx, 4, any_valid, pt, ts, p, m);
+}
+
+__attribute__((target("avx2")))
+static int lru_scan_avx2(const pte_t *pt, const uint32_t *ts, int m)
+{
+    const uint32_t *word = &pt[0].word;
+    const __m256i valid = _mm256_set1_epi32(PTE_VALID);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i step = _mm256_set1_epi32(8);
+    __m256i vmin = _mm256_set1_epi32(-1);
+    __m256i vidx = _mm256_set1_epi32(-1);
+    __m256i vinv = _mm256_set1_epi32(-1); /* lanes that saw only invalid pages */
+    __m256i cur = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    int p = 0;
+    for (; p + 8 <= m; p += 8) {
+        __m256i w = _mm256_loadu_si256((const __m256i *)(word + p));
+        __m256i t = _mm256_loadu_si256((const __m256i *)(ts + p));
+        __m256i inv = _mm256_cmpeq_epi32(_mm256_and_si256(w, valid), zero);
+        __m256i key = _mm256_or_si256(t, inv);
+        __m256i keep = _mm256_cmpeq_epi32(_mm256_max_epu32(key, vmin), key); /* key >= vmin */
+        vidx = _mm256_blendv_epi8(cur, vidx, keep);
+        vmin = _mm256_min_epu32(vmin, key);
+        vinv = _mm256_and_si256(vinv, inv);
+        cur = _mm256_add_epi32(cur, step);
+    }
+    uint32_t key[8];
+    int32_t idx[8];
+    _mm256_storeu_si256((__m256i *)key, vmin);
+    _mm256_storeu_si256((__m256i *)idx, vidx);
+    int any_valid = _mm256_movemask_epi8(vinv) != -1;
+    return lru_scan_finish(key, idx, 8, any_valid, pt, ts, p, m);
+}
+#endif /* LRU_SCAN_X86 */
+
+static const struct {
+    const char *name;
+    lru_scan_fn fn;
+} g_lru_scans[] = {
+    {"scalar", lru_scan_scalar},
+#if LRU_SCAN_X86
+    {"sse4.1", lru_scan_sse41},
+    {"avx2", lru_scan_avx2},
+#endif
+};
+#define N_LRU_SCANS ((int)(sizeof(g_lru_scans) / sizeof(g_lru_scans[0])))
+
+static int g_lru_scan = -1; /* index into g_lru_scans, -1 = not selected yet */
+
+static int lru_scan_supported(int i)
+{
+#if LRU_SCAN_X86
+    __builtin_cpu_init();
+    if (g_lru_scans[i].fn == lru_scan_sse41)
+        return __builtin_cpu_supports("sse4.1");
+    if (g_lru_scans[i].fn == lru_scan_avx2)
+        return __builtin_cpu_supports("avx2");
+#endif
+    return i == 0;
+}
+
+int lru_scan_select(const char *isa)
+{
+    for (int i = N_LRU_SCANS - 1; i >= 0; --i) {
+        if (isa && strcmp(isa, g_lru_scans[i].name) != 0)
+            continue;
+        if (!lru_scan_supported(i)) {
+            if (isa)
+                return -1;
+            continue; /* NULL: fall back to the next best */
+        }
+        g_lru_scan = i;
+        return 0;
+    }
+    return -1;
+}
+
+const char *lru_scan_name(void)
+{
+    if (g_lru_scan < 0)
+        lru_scan_select(NULL);
+    return g_lru_scans[g_lru_scan].name;
+}
+
+int choose_lru_victim_local(void *sm1_base, int pid, int m) {
+    if (!sm1_base || pid < 0 || m <= 0) return -1;
+    if (g_lru_scan < 0)
+        lru_scan_select(NULL);
+    return g_lru_scans[g_lru_scan].fn(pt_base_for_pid(sm1_base, pid, m),
+                                      pt_ts_for_pid(sm1_base, pid, m), m);
+}
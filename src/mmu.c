@@ -1,16 +1,19 @@
 /* mmu.c
- * Demand-paged MMU with local LRU replacement.
+ * Demand-paged MMU with local, pluggable page replacement (see policy.h).
  *
  * Responsibilities:
  *  - Attach to SM1 (page tables) and SM2 (free frame list)
- *  - Handle proc->MMU requests on MQ3:
+ *  - Handle proc->MMU requests on MQ3 (resolution itself lives in mmu_core.c):
  *      * Illegal page -> reply INVALID
  *      * Hit          -> touch (LRU), reply frame
- *      * Fault        -> allocate or evict (local LRU), map, reply frame
- *  - Notify scheduler on MQ2 when a page fault occurs (optional but useful)
+ *      * Fault        -> allocate or evict (policy victim of the same pid), map, reply frame
+ *  - Notify scheduler on MQ2 when a page fault occurs (optional but useful),
+ *    when a process ends, and when load control suspends or resumes one
+ *  - With -A, hold the reply to a faulting request until its page arrives
+ *    in simulated time, serving the other processes meanwhile
  *
  * Build:
- *   gcc -Wall -g -I./src/include src/mmu.c src/memory.c src/ipc.c -o mmu -lrt
+ *   gcc -Wall -g -I./src/include src/mmu.c src/mmu_core.c src/memory.c src/policy.c src/refs.c src/pace.c src/tlb.c src/loadctl.c src/prefetch.c src/swap.c src/disk.c src/ipc.c src/trace.c -o mmu -pthread
  */
 
 #include <stdio.h>
@@ -25,93 +28,223 @@
 #include "memory.h"
 #include "ipc.h"
 #include "mmu.h"
+#include "mmu_core.h"
+#include "refs.h"
 
-/* Global timestamp increases per *valid* access. */
-static int g_ts = 0;
+#define TRACE_TAG "MMU"
+#include "trace.h"
 
-/* Logging macro (stdout for now) */
-#define LOG(fmt, ...)                                      \
-    do                                                     \
-    {                                                      \
-        fprintf(stdout, "[MMU] " fmt "\n", ##__VA_ARGS__); \
-        fflush(stdout);                                    \
-    } while (0)
+/* Address resolution state (page tables, policy, counters) */
+static mmu_core_t g_core;
+
+/* Async faults (-A): a process whose request faulted waits here, without a
+ * reply, until its page arrives. A batch is resolved up to the fault and
+ * the rest of it when the page is there. */
+typedef struct {
+    int waiting;            /* reply deferred until g_core.ready_ns[pid] */
+    int ended;              /* the process made its last reference */
+    int result;             /* single protocol: the frame */
+    ipc_batch_msg_t req;    /* batched: the request ... */
+    ipc_batch_msg_t reply;  /* ... and its reply so far (count = resolved) */
+} pending_t;
+
+static pending_t *g_pending; /* k entries, async only */
 
 /* Helper: send reply to a process on MQ3 */
-static int send_proc_reply(ipc_mqid_t mq_proc, int pid, int result)
+static int send_proc_reply(ipc_chan_t *ch_proc, int pid, int result)
 {
     ipc_msg_t reply = {0};
     reply.mtype = MSGTYPE_MMU_REPLY;
     reply.ints[0] = pid;
     reply.ints[1] = result;
-    return ipc_send_msg(mq_proc, &reply);
+    return ipc_chan_send(ch_proc, pid, &reply, sizeof(reply));
 }
 
-/* Helper: notify scheduler (e.g., that a page fault was handled) on MQ2 */
-static int notify_scheduler(ipc_mqid_t mq_sched, int pid, int pfh_handled)
+/* Helper: notify scheduler (e.g., that a page fault was handled) on MQ2;
+ * 'what' is a SCHED_NOTE_* */
+static int notify_scheduler(ipc_chan_t *ch_sched, int pid, int what)
 {
     ipc_msg_t note = {0};
     note.mtype = MSGTYPE_SCHED_NOTIFY;
     note.ints[0] = pid;
-    note.ints[1] = pfh_handled ? 1 : 0;
-    return ipc_send_msg(mq_sched, &note);
+    note.ints[1] = what;
+    return ipc_chan_send(ch_sched, 0, &note, sizeof(note));
+}
+
+/* Forward load-control suspensions and resumptions to the scheduler */
+static void notify_load(ipc_chan_t *ch_sched)
+{
+    int pid, ev;
+    if (!g_core.lc)
+        return;
+    while ((ev = lc_poll(g_core.lc, &pid)) != LC_EV_NONE)
+    {
+        LOG("load control: %s p_ind=%d", ev == LC_EV_SUSPEND ? "suspend" : "resume", pid);
+        notify_scheduler(ch_sched, pid, ev == LC_EV_SUSPEND ? SCHED_NOTE_SUSPEND : SCHED_NOTE_RESUME);
+    }
+}
+
+/* pid is done: release its frames (load control), then tell the scheduler */
+static void retire(ipc_chan_t *ch_sched, int pid)
+{
+    if (g_pending)
+        g_pending[pid].ended = 1;
+    mmu_core_exit(&g_core, pid);
+    notify_load(ch_sched);
+    notify_scheduler(ch_sched, pid, SCHED_NOTE_DONE);
+}
+
+/* Resolve req from entry reply->count on, in order. Returns 1 once the
+ * batch is done (reply->count is final), 0 if an async fault stopped it:
+ * the rest waits for the page. */
+static int resolve_batch(const ipc_batch_msg_t *req, ipc_batch_msg_t *reply, int *faults, int *ended)
+{
+    int p_ind = req->pid;
+    int n = reply->count;
+    int done = 1;
+
+    while (n < req->count)
+    {
+        int page_no = req->vals[n];
+        if (page_no == MMU_END_OF_REF)
+        {
+            TRACE_EV(TRACE_EV_END, g_core.ts, p_ind, 0, 0, 0);
+            LOG("pid=%d end-of-ref", p_ind);
+            reply->vals[n] = MMU_END_OF_REF;
+            reply->status[n++] = BATCH_ST_END;
+            *ended = 1;
+            break;
+        }
+        int pfh = 0;
+        int result = mmu_resolve(&g_core, p_ind, page_no, req->m_req, &pfh);
+        reply->vals[n] = result;
+        if (result == MMU_INVALID_PAGE)
+        {
+            reply->status[n++] = BATCH_ST_INVALID;
+            break; /* the process stops at the first illegal reference */
+        }
+        if (result < 0)
+            reply->status[n] = BATCH_ST_FAILED;
+        else
+            reply->status[n] = pfh ? BATCH_ST_FAULT : BATCH_ST_HIT;
+        *faults += pfh;
+        n++;
+        if (mmu_core_blocked(&g_core, p_ind))
+        {
+            done = 0;
+            break;
+        }
+    }
+    reply->count = n;
+    return done;
 }
 
-static int resolve_access(void *sm1_base, free_frame_list_t *ffl, int p_ind,
-                          int page_no, int m, int m_req_for_pid, int *pfh_out)
+/* Send a resolved batch's reply and the notes that go with it.
+ * Returns 1 if the batch carried the end-of-reference marker, 0 otherwise. */
+static int finish_batch(ipc_chan_t *ch_proc, ipc_chan_t *ch_sched, ipc_batch_msg_t *reply, int faults,
+                        int ended)
 {
-    *pfh_out = 0;
-    if (!is_legal_page(page_no, m_req_for_pid))
-    {
-        LOG("p_ind=%d illegal page=%d (limit=%d)", p_ind, page_no, m_req_for_pid);
-        return MMU_INVALID_PAGE;
-    }
-    // LOG("calling pte_addr");
-    pte_t *pte = pte_addr(sm1_base, p_ind, m, page_no);
-    // LOG("checking validity");
-    if (pte->valid > 0)
-    {
-        // LOG("pte is valid");
-        /* HIT: update LRU timestamp and return frame */
-        pte->last_used = ++g_ts;
-        LOG("p_ind=%d hit page=%d -> frame=%d (ts=%d)", p_ind, page_no, pte->frame_no, g_ts);
-        return pte->frame_no;
-    }
-    // LOG("calling ffl_alloc()");
-    /* FAULT: try to allocate a free frame */
-    int frame = ffl_alloc(ffl);
-    // LOG("%d", frame);
-    if (frame >= 0)
-    {
-        pt_set_mapping(sm1_base, p_ind, m, page_no, frame, ++g_ts);
-        *pfh_out = 1;
-        LOG("p_ind=%d fault page=%d allocated frame=%d (ts=%d)", p_ind, page_no, frame, g_ts);
-        return frame;
-    }
-
-    /* No free frame: evict local LRU victim from THIS pid only */
-    int victim_page = choose_lru_victim_local(sm1_base, p_ind, m);
-    if (victim_page < 0)
-    {
-        /* If a process has no valid pages yet but FFL is empty, the system is overcommitted.
-           For this assignment, just report fault cannot be handled (rare) — or pick a global victim.
-           We'll print and fail the access. */
-        LOG("p_ind=%d cannot handle fault (no free frame, no local victim). Consider global policy.", p_ind);
-        return MMU_PAGE_FAULT; /* unreachable in our reply protocol; caller can handle if desired */
-    }
-
-    int victim_frame = pte_addr(sm1_base, p_ind, m, victim_page)->frame_no;
-    pt_invalidate(sm1_base, p_ind, m, victim_page);
-
-    pt_set_mapping(sm1_base, p_ind, m, page_no, victim_frame, ++g_ts);
-    *pfh_out = 1;
-    LOG("p_ind=%d fault page=%d evicted page=%d -> frame=%d (ts=%d)",
-        p_ind, page_no, victim_page, victim_frame, g_ts);
-    return victim_frame;
+    int p_ind = reply->pid;
+    ipc_chan_send(ch_proc, p_ind, reply, ipc_batch_bytes(reply));
+
+    if (faults)
+    {
+        notify_scheduler(ch_sched, p_ind, SCHED_NOTE_FAULT);
+    }
+    notify_load(ch_sched);
+    if (ended)
+    {
+        retire(ch_sched, p_ind);
+    }
+    return ended;
+}
+
+/* Resolve one batch in order and answer it with a single reply (with async
+ * faults, once the pages it faulted on have arrived).
+ * Returns 1 if the batch carried the end-of-reference marker, 0 otherwise.
+ */
+static int serve_batch(ipc_chan_t *ch_proc, ipc_chan_t *ch_sched, const ipc_batch_msg_t *req)
+{
+    static ipc_batch_msg_t reply_buf;
+    int p_ind = req->pid;
+    ipc_batch_msg_t *reply = g_pending ? &g_pending[p_ind].reply : &reply_buf;
+    int faults = 0;
+    int ended = 0;
+
+    reply->mtype = MSGTYPE_MMU_BATCH;
+    reply->pid = p_ind;
+    reply->m_req = req->m_req;
+    reply->count = 0;
+    if (!resolve_batch(req, reply, &faults, &ended))
+    {
+        pending_t *pd = &g_pending[p_ind];
+        memcpy(&pd->req, req, ipc_batch_bytes(req));
+        pd->waiting = 1;
+        /* the process is off the CPU: let the scheduler run another */
+        notify_scheduler(ch_sched, p_ind, SCHED_NOTE_FAULT);
+        notify_load(ch_sched);
+        return 0;
+    }
+    return finish_batch(ch_proc, ch_sched, reply, faults, ended);
+}
+
+/* The page pid waited for is there: answer its request, or resolve the
+ * rest of its batch. Returns 1 if that ended the process. */
+static int complete_fault(ipc_chan_t *ch_proc, ipc_chan_t *ch_sched, int pid, int batched)
+{
+    pending_t *pd = &g_pending[pid];
+    LOG_DEBUG("pid=%d page arrived at %llu ns", pid, (unsigned long long)g_core.ready_ns[pid]);
+    pd->waiting = 0;
+    if (!batched)
+    {
+        send_proc_reply(ch_proc, pid, pd->result);
+        return 0;
+    }
+    int faults = 0, ended = 0;
+    if (!resolve_batch(&pd->req, &pd->reply, &faults, &ended))
+    {
+        pd->waiting = 1;
+        notify_scheduler(ch_sched, pid, SCHED_NOTE_FAULT);
+        notify_load(ch_sched);
+        return 0;
+    }
+    /* the batch's first fault was already reported */
+    return finish_batch(ch_proc, ch_sched, &pd->reply, faults, ended);
+}
+
+/* Async faults: answer every request whose page has arrived. While each
+ * process that has not ended waits for a page or is suspended, no request
+ * can come: idle the clock to the earliest arrival. A process that was not
+ * started yet counts as able to run (the scheduler starts one at every
+ * fault). Returns the number of processes that ended. */
+static int complete_faults(ipc_chan_t *ch_proc, ipc_chan_t *ch_sched, int k, int batched)
+{
+    int ended = 0;
+    for (;;)
+    {
+        int runnable = 0, completed = 0;
+        for (int pid = 0; pid < k; ++pid)
+        {
+            pending_t *pd = &g_pending[pid];
+            if (pd->ended)
+                continue;
+            if (!pd->waiting)
+                runnable |= !(g_core.lc && lc_suspended(g_core.lc, pid));
+            else if (!mmu_core_blocked(&g_core, pid))
+            {
+                ended += complete_fault(ch_proc, ch_sched, pid, batched);
+                completed = 1;
+            }
+        }
+        if (completed)
+            continue; /* a resumed batch may wait again */
+        if (runnable || !mmu_core_idle(&g_core))
+            return ended;
+    }
 }
 
 int mmu_run(int sm1_key, int sm2_key, int mq_sched_key, int mq_proc_key,
-            int k, int m, int f)
+            int k, int m, int f, const mmu_opts_t *opts)
 {
     // Attach shared memory segment(No creation)
     ipc_shmid_t shmid_sm1 = shmget((key_t)sm1_key, sm1_bytes_for_k_m(k, m), 0666);
@@ -142,29 +275,100 @@ int mmu_run(int sm1_key, int sm2_key, int mq_sched_key, int mq_proc_key,
     }
 
     /* Open message queues (not create)*/
-    ipc_mqid_t mq_sched = ipc_create_mq((key_t)mq_sched_key, 0666);
-    if (mq_sched == -1)
+    /* MMU is peer 0 of the scheduler's channel and the hub of the processes' */
+    ipc_chan_t ch_sched, ch_proc;
+    if (ipc_chan_open(&ch_sched, opts->transport, (key_t)mq_sched_key, 0) == -1)
     {
         ipc_detach_shm(sm1_base);
         ipc_detach_shm(ffl);
         return 1;
     }
 
-    ipc_mqid_t mq_proc = ipc_create_mq((key_t)mq_proc_key, 0666);
-    if (mq_proc == -1)
+    if (ipc_chan_open(&ch_proc, opts->transport, (key_t)mq_proc_key, IPC_HUB) == -1)
     {
+        ipc_chan_close(&ch_sched);
         ipc_detach_shm(sm1_base);
         ipc_detach_shm(ffl);
         return 1;
     }
 
-    LOG("MMU started: k=%d m=%d f=%d", k, m, f);
+    static refs_t refs;
+    int rc = 1;
+    if (opts->refs_path && refs_load(opts->refs_path, &refs) != 0)
+        goto out;
+    if (mmu_core_init(&g_core, sm1_base, ffl, k, m, f, opts->policy, opts->global,
+                      opts->refs_path ? &refs : NULL) != 0)
+    {
+        fprintf(stderr, "mmu: cannot set up policy '%s' (have: %s)\n", opts->policy, policy_names());
+        goto out;
+    }
+
+    g_core.pace = opts->pace;
+    g_core.async = opts->async;
+    g_core.around = opts->around;
+    if (opts->async && !(g_pending = calloc((size_t)k, sizeof(*g_pending))))
+    {
+        fprintf(stderr, "mmu: out of memory\n");
+        goto out_core;
+    }
+    if (opts->tlb.entries > 0 && !(g_core.tlb = tlb_create(&opts->tlb, k)))
+    {
+        fprintf(stderr, "mmu: cannot create the TLB\n");
+        goto out_core;
+    }
+    if (opts->lc.mode != LC_NONE && !(g_core.lc = lc_create(&opts->lc, k, m)))
+    {
+        fprintf(stderr, "mmu: cannot set up load control\n");
+        goto out_core;
+    }
+    if (opts->prefetch.depth > 0 && !(g_core.pf = pf_create(&opts->prefetch, k)))
+    {
+        fprintf(stderr, "mmu: cannot set up prefetching\n");
+        goto out_core;
+    }
+    if (opts->swap.enabled && !(g_core.swap = swap_create(&opts->swap, &opts->disk, k, m)))
+    {
+        fprintf(stderr, "mmu: cannot create the swap device\n");
+        goto out_core;
+    }
+    trace_open("mmu", 0);
+    LOG("MMU started: k=%d m=%d f=%d batch=%d policy=%s scope=%s pace=%s loadctl=%s", k, m, f, opts->batch,
+        g_core.pol->name, opts->global ? "global" : "local", pace_mode_name(opts->pace.mode),
+        lc_mode_name(opts->lc.mode));
+
+    while (opts->batch > 0)
+    {
+        static ipc_batch_msg_t breq;
+        if (g_pending && (procs_cmpltd += complete_faults(&ch_proc, &ch_sched, k, 1)) >= k)
+            break;
+        ssize_t r = ipc_chan_recv(&ch_proc, &breq, sizeof(breq), MSGTYPE_PROC_BATCH);
+        pace_wait(&opts->pace);
+        if (r < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            perror("msgrcv(proc->mmu batch)");
+            break;
+        }
+        if (serve_batch(&ch_proc, &ch_sched, &breq))
+        {
+            procs_cmpltd++;
+            if (procs_cmpltd >= k)
+            {
+                break;
+            }
+        }
+    }
 
-    while (1)
+    while (opts->batch <= 0)
     {
         ipc_msg_t req = {0};
-        ssize_t r = ipc_recv_msg(mq_proc, &req, MSGTYPE_PROC_REQ);
-        sleep(3);
+        if (g_pending)
+            complete_faults(&ch_proc, &ch_sched, k, 0);
+        ssize_t r = ipc_chan_recv(&ch_proc, &req, sizeof(req), MSGTYPE_PROC_REQ);
+        pace_wait(&opts->pace);
         // LOG("Received msg");
         if (r < 0)
         {
@@ -183,11 +387,12 @@ int mmu_run(int sm1_key, int sm2_key, int mq_sched_key, int mq_proc_key,
         /* Optional end-of-stream convention: pid sends page_no = -9 to indicate done */
         if (page_no == MMU_END_OF_REF)
         {
+            TRACE_EV(TRACE_EV_END, g_core.ts, p_ind, 0, 0, 0);
             LOG("pid=%d end-of-ref", p_ind);
-            send_proc_reply(mq_proc, p_ind, MMU_END_OF_REF);
+            send_proc_reply(&ch_proc, p_ind, MMU_END_OF_REF);
 
-            /* Notify scheduler */
-            notify_scheduler(mq_sched, p_ind, 0);
+            /* Release its frames, notify scheduler */
+            retire(&ch_sched, p_ind);
             procs_cmpltd++;
             if(procs_cmpltd >= k){
                 break;
@@ -196,39 +401,121 @@ int mmu_run(int sm1_key, int sm2_key, int mq_sched_key, int mq_proc_key,
         }
         int pfh = 0;
         // LOG("Resolvong access");
-        int result = resolve_access(sm1_base, ffl, p_ind, page_no, m, m_req_for_pid, &pfh);
+        int result = mmu_resolve(&g_core, p_ind, page_no, m_req_for_pid, &pfh);
         // LOG("result acquired");
-        send_proc_reply(mq_proc, p_ind, result);
+        if (mmu_core_blocked(&g_core, p_ind))
+        {
+            /* async fault: reply when the page arrives */
+            g_pending[p_ind].result = result;
+            g_pending[p_ind].waiting = 1;
+        }
+        else
+            send_proc_reply(&ch_proc, p_ind, result);
         // LOG("reply sent");
         if (pfh)
         {
-            notify_scheduler(mq_sched, p_ind, 1);
+            notify_scheduler(&ch_sched, p_ind, SCHED_NOTE_FAULT);
         }
+        notify_load(&ch_sched);
     }
 
     LOG("Shutting down MMU...");
+    mmu_core_print_stats(&g_core);
+    rc = 0;
 
+    /* setup failures join here, undoing only what was set up */
+out_core:
+    mmu_core_destroy(&g_core);
+    free(g_pending);
+    g_pending = NULL;
+out:
+    refs_free(&refs);
+    ipc_chan_close(&ch_proc);
+    ipc_chan_close(&ch_sched);
     ipc_detach_shm(sm1_base);
     ipc_detach_shm(ffl);
-    return 0;
+    return rc;
+}
+
+static int usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [-b batch] [-p policy] [-g] [-r refs_file] [-x mq|shm] [-P pace] [-T tlb] [-L loadctl] [-F prefetch] [-R around] [-D swap] [-I iosched] [-A] <sm1_key> <sm2_key> <mq_sched_key> <mq_proc_key> <k> <m> <f>\n", prog);
+    return 1;
 }
 
 /* Standalone binary entrypoint (optional but handy). */
 int main(int argc, char **argv)
 {
-    if (argc != 8)
+    mmu_opts_t opts = {0};
+    int opt;
+    /* '+' stops at the first positional: ftok keys may print as negative ints */
+    while ((opt = getopt(argc, argv, "+Ab:D:F:gI:L:p:P:r:R:T:x:")) != -1)
     {
-        fprintf(stderr,
-                "Usage: %s <sm1_key> <sm2_key> <mq_sched_key> <mq_proc_key> <k> <m> <f>\n", argv[0]);
-        return 1;
+        switch (opt)
+        {
+        case 'b':
+            opts.batch = atoi(optarg);
+            break;
+        case 'p':
+            opts.policy = optarg;
+            break;
+        case 'g':
+            opts.global = 1;
+            break;
+        case 'A':
+            opts.async = 1;
+            break;
+        case 'L':
+            if (lc_parse(optarg, &opts.lc) != 0)
+                return usage(argv[0]);
+            break;
+        case 'F':
+            if (pf_parse(optarg, &opts.prefetch) != 0)
+                return usage(argv[0]);
+            break;
+        case 'R':
+            if (fa_parse(optarg, &opts.around) != 0)
+                return usage(argv[0]);
+            break;
+        case 'D':
+            if (swap_parse(optarg, &opts.swap) != 0)
+                return usage(argv[0]);
+            break;
+        case 'I':
+            if (disk_parse(optarg, &opts.disk) != 0)
+                return usage(argv[0]);
+            break;
+        case 'P':
+            if (pace_parse(optarg, &opts.pace) != 0)
+                return usage(argv[0]);
+            break;
+        case 'r':
+            opts.refs_path = optarg;
+            break;
+        case 'T':
+            if (tlb_parse(optarg, &opts.tlb) != 0)
+                return usage(argv[0]);
+            break;
+        case 'x':
+            if (ipc_transport_parse(optarg, &opts.transport) != 0)
+                return usage(argv[0]);
+            break;
+        default:
+            return usage(argv[0]);
+        }
     }
-    int sm1_key = atoi(argv[1]);
-    int sm2_key = atoi(argv[2]);
-    int mq_sched_key = atoi(argv[3]);
-    int mq_proc_key = atoi(argv[4]);
-    int k = atoi(argv[5]);
-    int m = atoi(argv[6]);
-    int f = atoi(argv[7]);
+    if (argc - optind != 7 || (opts.async && opts.pace.mode != PACE_VIRTUAL) ||
+        (opts.disk.enabled && !opts.swap.enabled))
+        return usage(argv[0]);
+    char **pos = argv + optind;
+    int sm1_key = atoi(pos[0]);
+    int sm2_key = atoi(pos[1]);
+    int mq_sched_key = atoi(pos[2]);
+    int mq_proc_key = atoi(pos[3]);
+    int k = atoi(pos[4]);
+    int m = atoi(pos[5]);
+    int f = atoi(pos[6]);
 
-    return mmu_run(sm1_key, sm2_key, mq_sched_key, mq_proc_key, k, m, f);
+    return mmu_run(sm1_key, sm2_key, mq_sched_key, mq_proc_key, k, m, f, &opts);
 }
@@ -0,0 +1,769 @@
+/* mmu_core.c
+ * Address resolution shared by the mmu binary and vms-replay (see mmu_core.h).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "types.h"
+#include "memory.h"
+#include "mmu_core.h"
+
+#define TRACE_TAG "MMU"
+#include "trace.h"
+
+/* Advance the virtual clock by 'ns' on behalf of one process */
+static inline void charge(mmu_core_t *core, proc_stats_t *st, uint64_t ns)
+{
+    if (core->pace.mode != PACE_VIRTUAL)
+        return;
+    core->now_ns += ns;
+    st->sim_ns += ns;
+}
+
+/* The running process changed: pay for the switch, flush an untagged TLB */
+static void context_switch(mmu_core_t *core, proc_stats_t *st, int p_ind)
+{
+    core->last_pid = p_ind;
+    charge(core, st, core->pace.ctx_ns);
+    if (core->tlb && core->tlb->cfg.flush_on_switch)
+        tlb_flush(core->tlb);
+}
+
+/* Unmap a resident page: the policy, TLB and load control forget it.
+ * Returns its frame, which the caller reuses or frees. */
+static int unmap_page(mmu_core_t *core, int pid, int page_no)
+{
+    pte_t *pte = pte_addr(core->sm1_base, pid, core->m, page_no);
+    int frame = pte_frame(pte);
+    if (pte->word & PTE_PREFETCHED)
+        core->stats[pid].prefetch_wasted++;
+    if (pte->word & PTE_READAHEAD)
+        core->stats[pid].readahead_wasted++;
+    if (pte->word & PTE_AROUND)
+        core->stats[pid].around_wasted++;
+    if (core->pol->on_evict)
+        core->pol->on_evict(core->pol, pid, page_no);
+    if (core->tlb)
+        tlb_invalidate(core->tlb, pid, page_no); /* shootdown before unmapping */
+    pt_invalidate(core->sm1_base, pid, core->m, page_no);
+    ft_unmap(core->frames, core->f, frame);
+    if (core->lc)
+        lc_unmap(core->lc, pid, page_no);
+    return frame;
+}
+
+/* Before a resident page is unmapped: write it to swap at time 'at' if it is
+ * dirty, for 'waiter' (-1 = nobody waits). Returns 1 if a write was queued. */
+static int write_back(mmu_core_t *core, int pid, int page_no, uint64_t at, int waiter)
+{
+    pte_t *pte = pte_addr(core->sm1_base, pid, core->m, page_no);
+    if (!core->swap || !(pte->word & PTE_DIRTY))
+        return 0;
+    if (!swap_write(core->swap, pid, page_no, at, waiter))
+        return 0;
+    core->stats[pid].write_backs++;
+    TRACE_EV(TRACE_EV_SWAP_OUT, core->ts, pid, page_no, pte_frame(pte), swap_slot(core->swap, pid, page_no));
+    return 1;
+}
+
+/* page_no of p_ind is about to be mapped to frame: read it from swap at time
+ * 'at' if it was written there, for 'waiter'. Returns 1 if a read was queued. */
+static int swap_in(mmu_core_t *core, int p_ind, int page_no, int frame, uint64_t at, int waiter)
+{
+    int slot;
+    if (!core->swap || (slot = swap_slot(core->swap, p_ind, page_no)) < 0)
+        return 0;
+    core->stats[p_ind].swap_ins++;
+    TRACE_EV(TRACE_EV_SWAP_IN, core->ts, p_ind, page_no, frame, slot);
+    swap_read(core->swap, slot, 1, at, waiter);
+    return 1;
+}
+
+/* A fault of p_ind maps page_no to frame: read it from swap at time 'at'
+ * if it was written there, for p_ind. With readahead (swap.h) the same
+ * request reads p_ind's other non-resident pages in the slot's window, as
+ * long as frames are free and p_ind may grow (load control did not tell the
+ * fault to replace); they go to pages[] / frames[] (*n of them) for the
+ * caller to map after page_no. Returns 1 if a read was queued. */
+static int fault_in(mmu_core_t *core, int p_ind, int page_no, int frame, uint64_t at, int grow,
+                    int *pages, int *frames, int *n)
+{
+    swap_t *sw = core->swap;
+    int slot;
+    *n = 0;
+    if (!sw || sw->cfg.readahead <= 1 || !grow || (slot = swap_slot(sw, p_ind, page_no)) < 0)
+        return swap_in(core, p_ind, page_no, frame, at, p_ind);
+    core->stats[p_ind].swap_ins++;
+    TRACE_EV(TRACE_EV_SWAP_IN, core->ts, p_ind, page_no, frame, slot);
+    int win = sw->cfg.readahead, first = slot - slot % win;
+    int lo = slot, hi = slot;
+    for (int s = first; s < first + win && s < sw->nslots && core->ffl->count > 0; ++s)
+    {
+        int page = s == slot ? -1 : swap_page(sw, s, p_ind);
+        if (page < 0 || pte_valid(pte_addr(core->sm1_base, p_ind, core->m, page)))
+            continue;
+        frames[*n] = ffl_alloc(core->ffl);
+        pages[(*n)++] = page;
+        if (s < lo)
+            lo = s;
+        if (s > hi)
+            hi = s;
+    }
+    swap_read(sw, lo, hi - lo + 1, at, p_ind);
+    return 1;
+}
+
+/* Async: once the disk has picked every request p_ind waits for, its page's
+ * arrival is known; add the rest of the wait to its sim_ns. Returns 0 while
+ * it is not known. */
+static int io_settle(mmu_core_t *core, int p_ind)
+{
+    const disk_t *d = core->swap->disk;
+    if (disk_waiting(d, p_ind))
+        return 0;
+    uint64_t done = disk_ready(d, p_ind);
+    if (done > core->ready_ns[p_ind])
+    {
+        core->stats[p_ind].sim_ns += done - core->ready_ns[p_ind];
+        core->ready_ns[p_ind] = done;
+    }
+    core->io_wait[p_ind] = 0;
+    return 1;
+}
+
+/* Map page_no of p_ind to a free or just unmapped frame, tell the policy:
+ * on_fault for the page a reference faulted on (demand), on_map for a page
+ * mapped ahead of its reference */
+static void map_page(mmu_core_t *core, int p_ind, int page_no, int frame, uint64_t ts, int demand)
+{
+    pt_set_mapping(core->sm1_base, p_ind, core->m, page_no, frame, (uint32_t)ts);
+    ft_map(core->frames, core->f, frame, p_ind, page_no);
+    if (core->lc)
+        lc_map(core->lc, p_ind, page_no);
+    void (*hook)(repl_policy_t *, int, int) = demand ? core->pol->on_fault : core->pol->on_map;
+    if (hook)
+        hook(core->pol, p_ind, page_no);
+}
+
+/* The policy's victim for a fault of p_ind, from THIS pid only or from any
+ * pid with global replacement: page, owner in *pid_out; -1 if none */
+static int choose_victim(mmu_core_t *core, int p_ind, int *pid_out)
+{
+    *pid_out = p_ind;
+    return core->global ? core->pol->choose_global(core->pol, pid_out)
+                        : core->pol->choose_victim(core->pol, p_ind);
+}
+
+/* Load control said replace: a page of p_ind itself, whatever the scope.
+ * With global replacement the policy only ranks pages system-wide, so the
+ * process's least recently referenced page (load control's list) goes. */
+static int own_victim(mmu_core_t *core, int p_ind)
+{
+    return core->global ? lc_lru(core->lc, p_ind) : core->pol->choose_victim(core->pol, p_ind);
+}
+
+/* Unmap a resident page and return its frame to the FFL (load control);
+ * 'why' is the RELEASE event's aux */
+static void release_page(mmu_core_t *core, int pid, int page_no, int why)
+{
+    if (why != 2) /* the pages of a process that ended are discarded */
+        write_back(core, pid, page_no, core->now_ns, -1);
+    int frame = unmap_page(core, pid, page_no);
+    ffl_free(core->ffl, frame);
+    TRACE_EV(TRACE_EV_RELEASE, core->ts, pid, page_no, frame, why);
+}
+
+/* Release pid's pages outside its working set */
+static void trim(mmu_core_t *core, int pid)
+{
+    int page;
+    while ((page = lc_stale(core->lc, pid)) >= 0)
+        release_page(core, pid, page, 0);
+}
+
+/* Release every page of pid */
+static void release_all(mmu_core_t *core, int pid, int why)
+{
+    int page;
+    while ((page = lc_lru(core->lc, pid)) >= 0)
+        release_page(core, pid, page, why);
+}
+
+/* Resume suspended processes while they fit in the free frames, keeping
+ * 'reserve' of them for the fault in progress */
+static void resume_fitting(mmu_core_t *core, int reserve)
+{
+    int pid;
+    while ((pid = lc_pick_resume(core->lc, core->ffl->count - reserve)) >= 0)
+    {
+        TRACE_EV(TRACE_EV_RESUME, core->ts, pid, 0, 0, 0);
+        LOG_DEBUG("p_ind=%d resumed (free=%d)", pid, core->ffl->count);
+    }
+}
+
+/* page is page_no + j*stride for some 0 <= j < n */
+static inline int on_run(int page, int page_no, int stride, int n)
+{
+    int d = page - page_no;
+    return d % stride == 0 && d / stride >= 0 && d / stride < n;
+}
+
+/* Map up to depth pages ahead of page_no along p_ind's stride (prefetch.h) */
+static void prefetch(mmu_core_t *core, int p_ind, int page_no, int m_req_for_pid)
+{
+    pf_t *pf = core->pf;
+    int stride = pf_stride(pf, p_ind);
+    if (!stride)
+        return;
+    proc_stats_t *st = &core->stats[p_ind];
+    int limit = m_req_for_pid < core->m ? m_req_for_pid : core->m;
+    for (int i = 1; i <= pf->cfg.depth; ++i)
+    {
+        int page = page_no + i * stride;
+        if (page < 0 || page >= limit)
+            break;
+        pte_t *pte = pte_addr(core->sm1_base, p_ind, core->m, page);
+        if (pte_valid(pte))
+            continue;
+        int victim_pid = p_ind, victim_page = -1;
+        int frame = ffl_alloc(core->ffl);
+        if (frame < 0)
+        {
+            if (!pf->cfg.evict)
+                break;
+            victim_page = choose_victim(core, p_ind, &victim_pid);
+            if (victim_page < 0 || (victim_pid == p_ind && on_run(victim_page, page_no, stride, i)))
+                break;
+            write_back(core, victim_pid, victim_page, core->now_ns, -1);
+            frame = unmap_page(core, victim_pid, victim_page);
+            st->evictions++;
+            if (victim_pid != p_ind)
+                core->stats[victim_pid].stolen++;
+        }
+        swap_in(core, p_ind, page, frame, core->now_ns, -1);
+        map_page(core, p_ind, page, frame, core->ts, 0);
+        pte->word |= PTE_PREFETCHED;
+        st->prefetched++;
+        TRACE_EV(TRACE_EV_PREFETCH, core->ts, p_ind, page, frame, victim_page);
+        LOG_DEBUG("p_ind=%d prefetch page=%d -> frame=%d (stride=%d)", p_ind, page, frame, stride);
+    }
+}
+
+/* Map the other pages of page_no's window that need no I/O into free
+ * frames above the watermark (fault-around, prefetch.h); only for a fault
+ * that load control lets grow */
+static void fault_around(mmu_core_t *core, int p_ind, int page_no, int m_req_for_pid)
+{
+    proc_stats_t *st = &core->stats[p_ind];
+    int n = core->around.pages, first = page_no - page_no % n;
+    int limit = m_req_for_pid < core->m ? m_req_for_pid : core->m;
+    for (int page = first; page < first + n && page < limit && core->ffl->count > core->around.watermark; ++page)
+    {
+        pte_t *pte = pte_addr(core->sm1_base, p_ind, core->m, page);
+        if (page == page_no || pte_valid(pte) || (core->swap && swap_slot(core->swap, p_ind, page) >= 0))
+            continue;
+        int frame = ffl_alloc(core->ffl);
+        map_page(core, p_ind, page, frame, core->ts, 0);
+        pte->word |= PTE_AROUND;
+        st->around++;
+        TRACE_EV(TRACE_EV_AROUND, core->ts, p_ind, page, frame, page_no);
+        LOG_DEBUG("p_ind=%d fault-around page=%d -> frame=%d (fault on page=%d)", p_ind, page, frame, page_no);
+    }
+}
+
+/* Load control at a fault of p_ind (see mmu_core.h). Returns 1 if the fault
+ * should take a free frame, 0 if it should replace one of p_ind's pages. */
+static int load_control(mmu_core_t *core, int p_ind)
+{
+    lc_t *lc = core->lc;
+    int grow = lc_fault(lc, p_ind);
+    trim(core, p_ind);
+    if (grow && core->ffl->count == 0)
+    {
+        for (int pid = 0; pid < core->k; ++pid)
+            trim(core, pid);
+        int victim;
+        if (core->ffl->count == 0 && (victim = lc_pick_suspend(lc, p_ind)) >= 0)
+        {
+            int held = lc->resident[victim];
+            release_all(core, victim, 1);
+            TRACE_EV(TRACE_EV_SUSPEND, core->ts, victim, 0, 0, held);
+            LOG_DEBUG("p_ind=%d suspended for p_ind=%d, %d frames released", victim, p_ind, held);
+        }
+    }
+    resume_fitting(core, grow);
+    return grow;
+}
+
+int mmu_core_init(mmu_core_t *core, void *sm1_base, free_frame_list_t *ffl,
+                  int k, int m, int f, const char *policy, int global, const refs_t *refs)
+{
+    memset(core, 0, sizeof(*core));
+    core->sm1_base = sm1_base;
+    core->ffl = ffl;
+    core->frames = frame_table(ffl);
+    core->global = global;
+    core->k = k;
+    core->m = m;
+    core->f = f;
+    core->last_pid = -1;
+    core->pol = policy_create(policy ? policy : "lru", sm1_base, global ? core->frames : NULL,
+                              k, m, f, refs);
+    core->stats = calloc((size_t)k, sizeof(proc_stats_t));
+    core->ready_ns = calloc((size_t)k, sizeof(uint64_t));
+    core->io_wait = calloc((size_t)k, sizeof(signed char));
+    core->ended = calloc((size_t)k, sizeof(signed char));
+    if (!core->pol || !core->stats || !core->ready_ns || !core->io_wait || !core->ended)
+    {
+        mmu_core_destroy(core);
+        return -1;
+    }
+    return 0;
+}
+
+void mmu_core_destroy(mmu_core_t *core)
+{
+    policy_destroy(core->pol);
+    tlb_destroy(core->tlb);
+    lc_destroy(core->lc);
+    pf_destroy(core->pf);
+    swap_destroy(core->swap);
+    free(core->stats);
+    free(core->ready_ns);
+    free(core->io_wait);
+    free(core->ended);
+    core->pol = NULL;
+    core->tlb = NULL;
+    core->lc = NULL;
+    core->pf = NULL;
+    core->swap = NULL;
+    core->stats = NULL;
+    core->ready_ns = NULL;
+    core->io_wait = NULL;
+    core->ended = NULL;
+}
+
+int mmu_resolve(mmu_core_t *core, int p_ind, int page_no, int m_req_for_pid, int *pfh_out)
+{
+    void *sm1_base = core->sm1_base;
+    repl_policy_t *pol = core->pol;
+    proc_stats_t *st = &core->stats[p_ind];
+    int m = core->m;
+    int write = ref_is_write(page_no);
+    page_no = ref_page(page_no);
+
+    *pfh_out = 0;
+    if (p_ind != core->last_pid)
+        context_switch(core, st, p_ind);
+    if (!is_legal_page(page_no, m_req_for_pid))
+    {
+        st->invalid_refs++;
+        charge(core, st, core->pace.hit_ns);
+        TRACE_EV(TRACE_EV_INVALID, core->ts, p_ind, page_no, 0, m_req_for_pid);
+        LOG_DEBUG("p_ind=%d illegal page=%d (limit=%d)", p_ind, page_no, m_req_for_pid);
+        return MMU_INVALID_PAGE;
+    }
+    tlb_t *tlb = core->tlb;
+    if (tlb)
+    {
+        int frame = tlb_lookup(tlb, p_ind, page_no);
+        if (frame >= 0)
+        {
+            /* TLB HIT: the frame needs no page-table read; the PTE timestamp
+             * (for policies that read it) and the policy are still updated
+             * (the accessed-bit write) */
+#ifdef MMU_CHECK_TLB
+            /* debug builds (-DMMU_CHECK_TLB): a stale entry means a missed shootdown */
+            pte_t *pte = pte_addr(sm1_base, p_ind, m, page_no);
+            if (!pte_valid(pte) || pte_frame(pte) != frame)
+                fprintf(stderr, "[MMU] p_ind=%d page=%d stale TLB frame=%d (pte valid=%d frame=%d)\n",
+                        p_ind, page_no, frame, pte_valid(pte), pte_frame(pte));
+#endif
+            if (pol->uses_ts)
+                *pte_ts_addr(sm1_base, p_ind, m, page_no) = (uint32_t)++core->ts;
+            else
+                ++core->ts;
+            if (pol->on_hit)
+                pol->on_hit(pol, p_ind, page_no);
+            if (core->lc)
+                lc_touch(core->lc, p_ind, page_no);
+            if (core->pf)
+                pf_observe(core->pf, p_ind, page_no);
+            if (write)
+            {
+                /* the dirty bit lives in the PTE, the TLB does not cache it */
+                pte_addr(sm1_base, p_ind, m, page_no)->word |= PTE_DIRTY;
+                st->writes++;
+            }
+            st->hits++;
+            charge(core, st, tlb->cfg.lookup_ns + core->pace.hit_ns);
+            TRACE_EV(TRACE_EV_HIT, core->ts, p_ind, page_no, frame, 1);
+            LOG_DEBUG("p_ind=%d tlb hit page=%d -> frame=%d (ts=%llu)", p_ind, page_no, frame,
+                      (unsigned long long)core->ts);
+            return frame;
+        }
+        /* TLB miss: one more memory access to walk the page table */
+        charge(core, st, tlb->cfg.lookup_ns + core->pace.hit_ns);
+    }
+    pte_t *pte = pte_addr(sm1_base, p_ind, m, page_no);
+    if (pte_valid(pte))
+    {
+        /* HIT: update timestamp (if the policy reads it), let the policy
+         * note the access, return frame */
+        int frame = pte_frame(pte);
+        if (pol->uses_ts)
+            *pte_ts_addr(sm1_base, p_ind, m, page_no) = (uint32_t)++core->ts;
+        else
+            ++core->ts;
+        if (pol->on_hit)
+            pol->on_hit(pol, p_ind, page_no);
+        if (core->lc)
+            lc_touch(core->lc, p_ind, page_no);
+        if (write)
+        {
+            pte->word |= PTE_DIRTY;
+            st->writes++;
+        }
+        st->hits++;
+        if (tlb)
+            tlb_fill(tlb, p_ind, page_no, frame);
+        charge(core, st, core->pace.hit_ns);
+        TRACE_EV(TRACE_EV_HIT, core->ts, p_ind, page_no, frame, 0);
+        LOG_DEBUG("p_ind=%d hit page=%d -> frame=%d (ts=%llu)", p_ind, page_no, frame,
+                  (unsigned long long)core->ts);
+        if (pte->word & PTE_READAHEAD)
+        {
+            pte->word &= ~PTE_READAHEAD;
+            st->readahead_used++;
+        }
+        if (pte->word & PTE_AROUND)
+        {
+            pte->word &= ~PTE_AROUND;
+            st->around_used++;
+        }
+        if (core->pf)
+        {
+            pf_observe(core->pf, p_ind, page_no);
+            if (pte->word & PTE_PREFETCHED)
+            {
+                /* first use of a prefetched page: keep the stream ahead */
+                pte->word &= ~PTE_PREFETCHED;
+                st->prefetch_used++;
+                prefetch(core, p_ind, page_no, m_req_for_pid);
+            }
+        }
+        return frame;
+    }
+    /* FAULT: try to allocate a free frame (unless load control says the
+     * process should replace one of its own pages) */
+    st->page_faults++;
+    if (!core->async)
+        charge(core, st, core->pace.fault_ns);
+    /* the page's I/O starts once the fault is serviced; an async fault is
+     * serviced in the background while other processes use the CPU */
+    uint64_t at = core->now_ns + (core->async ? core->pace.fault_ns : 0);
+    int ra_pages[SWAP_MAX_READAHEAD], ra_frames[SWAP_MAX_READAHEAD], ra;
+    int grow = !core->lc || load_control(core, p_ind);
+    int frame = grow ? ffl_alloc(core->ffl) : -1;
+    int victim_pid = p_ind, victim_page = -1;
+    int io = 0;
+    if (frame < 0)
+    {
+        /* No free frame: let the policy pick a victim; one of p_ind's own
+           pages when load control said replace */
+        victim_page = grow ? choose_victim(core, p_ind, &victim_pid) : own_victim(core, p_ind);
+        if (victim_page < 0)
+        {
+            /* Local replacement: the process has no valid pages yet but the FFL
+               is empty, the system is overcommitted. Fail the access (global
+               replacement, -g, avoids this). */
+            TRACE_EV(TRACE_EV_FAIL, core->ts, p_ind, page_no, 0, 0);
+            LOG_DEBUG("p_ind=%d cannot handle fault (no free frame, no local victim). Consider global policy.", p_ind);
+            return MMU_PAGE_FAULT; /* unreachable in our reply protocol; caller can handle if desired */
+        }
+        io |= write_back(core, victim_pid, victim_page, at, p_ind);
+        frame = unmap_page(core, victim_pid, victim_page);
+        st->evictions++;
+    }
+
+    /* the process waits for the write-back of its victim and its own read;
+     * a synchronous fault stops the clock, so nothing can arrive before
+     * they are served */
+    io |= fault_in(core, p_ind, page_no, frame, at, grow, ra_pages, ra_frames, &ra);
+    uint64_t ready = at;
+    if (io && !core->async)
+    {
+        uint64_t done = disk_wait(core->swap->disk, p_ind);
+        if (done > ready)
+            ready = done;
+    }
+    if (core->async)
+    {
+        st->sim_ns += ready - core->now_ns;
+        core->ready_ns[p_ind] = ready;
+        core->io_wait[p_ind] = (signed char)io;
+    }
+    else if (ready > core->now_ns)
+        charge(core, st, ready - core->now_ns);
+    map_page(core, p_ind, page_no, frame, ++core->ts, 1);
+    if (write)
+    {
+        pte_addr(sm1_base, p_ind, m, page_no)->word |= PTE_DIRTY;
+        st->writes++;
+    }
+    for (int i = 0; i < ra; ++i)
+    {
+        map_page(core, p_ind, ra_pages[i], ra_frames[i], core->ts, 0);
+        pte_addr(sm1_base, p_ind, m, ra_pages[i])->word |= PTE_READAHEAD;
+        st->readahead++;
+        TRACE_EV(TRACE_EV_READAHEAD, core->ts, p_ind, ra_pages[i], ra_frames[i],
+                 swap_slot(core->swap, p_ind, ra_pages[i]));
+    }
+    if (tlb)
+        tlb_fill(tlb, p_ind, page_no, frame);
+    *pfh_out = 1;
+    if (victim_page < 0)
+    {
+        TRACE_EV(TRACE_EV_FAULT, core->ts, p_ind, page_no, frame, 0);
+        LOG_DEBUG("p_ind=%d fault page=%d allocated frame=%d (ts=%llu)", p_ind, page_no, frame,
+                  (unsigned long long)core->ts);
+    }
+    else
+    {
+        TRACE_EV(TRACE_EV_EVICT, core->ts, p_ind, page_no, frame, victim_page);
+        LOG_DEBUG("p_ind=%d fault page=%d evicted page=%d of p_ind=%d -> frame=%d (ts=%llu)",
+                  p_ind, page_no, victim_page, victim_pid, frame, (unsigned long long)core->ts);
+        if (victim_pid != p_ind)
+        {
+            core->stats[victim_pid].stolen++;
+            TRACE_EV(TRACE_EV_STEAL, core->ts, victim_pid, victim_page, frame, p_ind);
+        }
+    }
+    if (core->around.pages > 1 && grow)
+        fault_around(core, p_ind, page_no, m_req_for_pid);
+    if (core->pf)
+    {
+        pf_observe(core->pf, p_ind, page_no);
+        prefetch(core, p_ind, page_no, m_req_for_pid);
+    }
+    return frame;
+}
+
+void mmu_core_exit(mmu_core_t *core, int p_ind)
+{
+    if (core->lc)
+    {
+        lc_exit(core->lc, p_ind);
+        release_all(core, p_ind, 2);
+        resume_fitting(core, 0);
+    }
+    if (core->swap)
+    {
+        /* pages left mapped are discarded too when evicted: nothing to write back */
+        for (int page = 0; page < core->m; ++page)
+            pte_addr(core->sm1_base, p_ind, core->m, page)->word &= ~PTE_DIRTY;
+        swap_release(core->swap, p_ind);
+    }
+    core->ended[p_ind] = 1;
+    if (++core->exited == core->k && core->swap)
+    {
+        /* no request can come any more */
+        disk_run(core->swap->disk, UINT64_MAX);
+        for (int pid = 0; pid < core->k; ++pid)
+            if (core->io_wait[pid])
+                io_settle(core, pid);
+    }
+}
+
+int mmu_core_blocked(mmu_core_t *core, int p_ind)
+{
+    if (!core->async)
+        return 0;
+    if (core->io_wait[p_ind])
+    {
+        disk_run(core->swap->disk, core->now_ns);
+        if (!io_settle(core, p_ind))
+            return 1;
+    }
+    return core->ready_ns[p_ind] > core->now_ns;
+}
+
+int mmu_core_idle(mmu_core_t *core)
+{
+    uint64_t wake;
+    for (;;)
+    {
+        int unknown = 0;
+        wake = UINT64_MAX;
+        for (int pid = 0; pid < core->k; ++pid)
+        {
+            if (core->ended[pid])
+                continue;
+            if (core->io_wait[pid] && !io_settle(core, pid))
+                unknown = 1;
+            else if (core->ready_ns[pid] > core->now_ns && core->ready_ns[pid] < wake)
+                wake = core->ready_ns[pid];
+        }
+        /* nothing arrives before wake: the disk's picks until then are final */
+        if (!unknown || disk_next(core->swap->disk) >= wake)
+            break;
+        disk_step(core->swap->disk);
+    }
+    if (wake == UINT64_MAX)
+        return 0;
+    core->idle_ns += wake - core->now_ns;
+    core->now_ns = wake;
+    return 1;
+}
+
+/* " sim_ms=... eat_ns=..." for 'accesses' accesses that took 'ns', or "" */
+static void format_latency(const mmu_core_t *core, uint64_t ns, long long accesses, char *buf, size_t len)
+{
+    buf[0] = '\0';
+    if (core->pace.mode == PACE_VIRTUAL)
+        snprintf(buf, len, " sim_ms=%.3f eat_ns=%.1f", ns / 1e6,
+                 accesses ? (double)ns / accesses : 0.0);
+}
+
+void mmu_core_print_stats(const mmu_core_t *core)
+{
+    long long hits = 0, faults = 0, evictions = 0, invalid = 0;
+    long long prefetched = 0, used = 0, wasted = 0;
+    long long writes = 0, write_backs = 0, swap_ins = 0;
+    long long readahead = 0, ra_used = 0, ra_wasted = 0;
+    long long around = 0, ar_used = 0, ar_wasted = 0;
+    int ra = core->swap && core->swap->cfg.readahead > 1;
+    int fa = core->around.pages > 1;
+    char lat[64];
+    for (int i = 0; i < core->k; ++i)
+    {
+        const proc_stats_t *st = &core->stats[i];
+        format_latency(core, st->sim_ns, (long long)st->hits + st->page_faults + st->invalid_refs,
+                       lat, sizeof(lat));
+        char stolen[32] = "";
+        if (core->global)
+            snprintf(stolen, sizeof(stolen), " stolen=%d", st->stolen);
+        char pf[80] = "";
+        if (core->pf)
+            snprintf(pf, sizeof(pf), " prefetched=%d used=%d wasted=%d", st->prefetched, st->prefetch_used,
+                     st->prefetch_wasted);
+        char sw[128] = "";
+        if (core->swap)
+            snprintf(sw, sizeof(sw), " writes=%d writebacks=%d swapins=%d", st->writes, st->write_backs,
+                     st->swap_ins);
+        if (ra)
+            snprintf(sw + strlen(sw), sizeof(sw) - strlen(sw), " readahead=%d ra_used=%d ra_wasted=%d",
+                     st->readahead, st->readahead_used, st->readahead_wasted);
+        char ar[80] = "";
+        if (fa)
+            snprintf(ar, sizeof(ar), " around=%d ar_used=%d ar_wasted=%d", st->around, st->around_used,
+                     st->around_wasted);
+        LOG("stats p_ind=%d hits=%d faults=%d evictions=%d invalid=%d%s%s%s%s%s",
+            i, st->hits, st->page_faults, st->evictions, st->invalid_refs, stolen, pf, ar, sw, lat);
+        hits += st->hits;
+        faults += st->page_faults;
+        evictions += st->evictions;
+        invalid += st->invalid_refs;
+        prefetched += st->prefetched;
+        used += st->prefetch_used;
+        wasted += st->prefetch_wasted;
+        writes += st->writes;
+        write_backs += st->write_backs;
+        swap_ins += st->swap_ins;
+        readahead += st->readahead;
+        ra_used += st->readahead_used;
+        ra_wasted += st->readahead_wasted;
+        around += st->around;
+        ar_used += st->around_used;
+        ar_wasted += st->around_wasted;
+    }
+    long long refs = hits + faults;
+    format_latency(core, core->now_ns, refs + invalid, lat, sizeof(lat));
+    char io[64] = "";
+    if (core->async)
+        snprintf(io, sizeof(io), " idle_ms=%.3f cpu_util=%.4f", core->idle_ns / 1e6,
+                 core->now_ns ? 1.0 - (double)core->idle_ns / core->now_ns : 0.0);
+    char pf[96] = "";
+    if (core->pf)
+        snprintf(pf, sizeof(pf), " prefetched=%lld used=%lld wasted=%lld", prefetched, used, wasted);
+    char ar[128] = "";
+    if (fa)
+        snprintf(ar, sizeof(ar), " around=%lld ar_used=%lld ar_wasted=%lld ar_useful=%.4f", around, ar_used,
+                 ar_wasted, around ? (double)ar_used / around : 0.0);
+    char sw[192] = "";
+    if (core->swap)
+        snprintf(sw, sizeof(sw), " writes=%lld writebacks=%lld swapins=%lld", writes, write_backs, swap_ins);
+    if (ra)
+        snprintf(sw + strlen(sw), sizeof(sw) - strlen(sw),
+                 " readahead=%lld ra_used=%lld ra_wasted=%lld ra_useful=%.4f", readahead, ra_used, ra_wasted, readahead ? (double)ra_used / readahead : 0.0);
+    LOG("stats total policy=%s%s refs=%lld hits=%lld faults=%lld evictions=%lld invalid=%lld fault_rate=%.4f%s%s%s%s%s",
+        core->pol->name, core->global ? " scope=global" : "", refs, hits, faults, evictions, invalid,
+        refs ? (double)faults / refs : 0.0, pf, ar, sw, lat, io);
+
+    const swap_t *swp = core->swap;
+    if (swp)
+    {
+        char cl[96] = "";
+        if (swp->cfg.cluster > 1 || ra)
+            snprintf(cl, sizeof(cl), " cluster=%d clusters=%llu readahead=%d",
+                     swp->cfg.cluster > 1 ? swp->cfg.cluster : 0, (unsigned long long)swp->clusters,
+                     ra ? swp->cfg.readahead : 0);
+        LOG("swap read_ns=%u write_ns=%u slots=%d used=%d reads=%llu writes=%llu full=%llu busy_ms=%.3f%s",
+            swp->cfg.read_ns, swp->cfg.write_ns, swp->nslots, swp->used, (unsigned long long)swp->reads,
+            (unsigned long long)swp->writes, (unsigned long long)swp->full, swp->disk->busy_ns / 1e6, cl);
+    }
+    const disk_t *d = swp ? swp->disk : NULL;
+    if (d && d->cfg.enabled)
+    {
+        double span = d->last_done > d->first_at ? (double)(d->last_done - d->first_at) : 0.0;
+        LOG("disk sched=%s seek_min_ns=%u seek_max_ns=%u served=%llu queued=%d queue_max=%d queue_avg=%.2f "
+            "lat_avg_us=%.1f p50_us=%.1f p90_us=%.1f p99_us=%.1f max_us=%.1f iops=%.1f util=%.4f seek_ms=%.3f",
+            disk_sched_name(d->cfg.sched), d->cfg.seek_min_ns, d->cfg.seek_max_ns,
+            (unsigned long long)d->served, d->len, d->len_max, span > 0 ? d->lat_sum / span : 0.0,
+            d->served ? d->lat_sum / 1e3 / d->served : 0.0, disk_percentile(d, 0.5) / 1e3,
+            disk_percentile(d, 0.9) / 1e3, disk_percentile(d, 0.99) / 1e3, d->lat_max / 1e3,
+            span > 0 ? d->served / (span / 1e9) : 0.0, span > 0 ? d->busy_ns / span : 0.0, d->seek_ns / 1e6);
+    }
+
+    const lc_t *lc = core->lc;
+    if (lc)
+    {
+        char cfg[64];
+        if (lc->cfg.mode == LC_WS)
+            snprintf(cfg, sizeof(cfg), "tau=%u", lc->cfg.tau);
+        else
+            snprintf(cfg, sizeof(cfg), "lo=%g hi=%g", lc->cfg.lo, lc->cfg.hi);
+        LOG("loadctl mode=%s %s trimmed=%llu suspends=%llu swapped_out=%llu resumes=%llu",
+            lc_mode_name(lc->cfg.mode), cfg, (unsigned long long)lc->trimmed,
+            (unsigned long long)lc->suspends, (unsigned long long)lc->swapped,
+            (unsigned long long)lc->resumes);
+    }
+
+    const tlb_t *tlb = core->tlb;
+    if (!tlb)
+        return;
+    /* translation EAT = lookup + memory access + miss rate * page-table walk,
+     * one memory access per walk */
+    double mem = core->pace.mode == PACE_VIRTUAL ? (double)core->pace.hit_ns : (double)PACE_HIT_NS;
+    uint64_t th = 0, tm = 0;
+    for (int i = 0; i < core->k; ++i)
+    {
+        uint64_t n = tlb->hits[i] + tlb->misses[i];
+        double miss = n ? (double)tlb->misses[i] / n : 0.0;
+        LOG("tlb p_ind=%d hits=%llu misses=%llu hit_rate=%.4f eat_ns=%.1f", i,
+            (unsigned long long)tlb->hits[i], (unsigned long long)tlb->misses[i],
+            n ? 1.0 - miss : 0.0, tlb->cfg.lookup_ns + mem + miss * mem);
+        th += tlb->hits[i];
+        tm += tlb->misses[i];
+    }
+    double miss = th + tm ? (double)tm / (th + tm) : 0.0;
+    LOG("tlb total entries=%d ways=%d repl=%s tag=%s hits=%llu misses=%llu hit_rate=%.4f "
+        "flushes=%llu shootdowns=%llu eat_ns=%.1f",
+        tlb->cfg.entries, tlb->cfg.ways, tlb_repl_name(tlb->cfg.repl),
+        tlb->cfg.flush_on_switch ? "flush" : "asid",
+        (unsigned long long)th, (unsigned long long)tm, th + tm ? 1.0 - miss : 0.0,
+        (unsigned long long)tlb->flushes, (unsigned long long)tlb->shootdowns,
+        tlb->cfg.lookup_ns + mem + miss * mem);
+}
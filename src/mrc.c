@@ -0,0 +1,524 @@
+/* mrc.c
+ * One-pass LRU miss-ratio curves (see mrc.h).
+ */
+
+#define _GNU_SOURCE /* qsort_r */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mrc.h"
+
+/* ---------- Fenwick tree over access times 1..n ---------- */
+
+static void bit_add(uint32_t *bit, size_t n, size_t i, int32_t v)
+{
+    for (; i <= n; i += i & -i)
+        bit[i] += (uint32_t)v;
+}
+
+static uint32_t bit_prefix(const uint32_t *bit, size_t i)
+{
+    uint32_t s = 0;
+    for (; i > 0; i -= i & -i)
+        s += bit[i];
+    return s;
+}
+
+/* Stack distances of processes [lo, hi) run back to back, pages keyed by
+ * (pid - lo) * m + page. hist has one slot per possible distance plus one
+ * (index = distance). 'bit' must hold n + 1 entries and 'last' (hi - lo) * m,
+ * all zero. Returns the references seen.
+ */
+static uint64_t stack_distances(const refs_t *r, int lo, int hi, uint32_t *bit, size_t n,
+                                size_t *last, uint64_t *hist, uint64_t *cold)
+{
+    size_t t = 0;
+    uint32_t distinct = 0; /* pages seen so far = 1s in the tree */
+    for (int pid = lo; pid < hi; ++pid)
+    {
+        const int32_t *refs = refs_of(r, pid);
+        for (uint32_t i = 0; i < r->len[pid]; ++i)
+        {
+            int32_t page = ref_page(refs[i]);
+            if (page < 0 || page >= r->m)
+                break; /* the process stops at an illegal page */
+            size_t key = (size_t)(pid - lo) * r->m + page;
+            size_t prev = last[key];
+            ++t;
+            if (prev)
+            {
+                /* 1s after prev: pages used since, plus the page itself */
+                hist[distinct - bit_prefix(bit, prev) + 1]++;
+                bit_add(bit, n, prev, -1);
+            }
+            else
+            {
+                (*cold)++;
+                distinct++;
+            }
+            bit_add(bit, n, t, 1);
+            last[key] = t;
+        }
+    }
+    return t;
+}
+
+/* Largest distance with a nonzero count, 0 if none */
+static size_t max_distance(const uint64_t *hist, size_t pages)
+{
+    for (size_t d = pages; d > 0; --d)
+        if (hist[d])
+            return d;
+    return 0;
+}
+
+int mrc_build(const refs_t *r, mrc_t *out)
+{
+    int k = r->k, m = r->m;
+    size_t pages = (size_t)k * m;
+    size_t total = 0;
+    for (int pid = 0; pid < k; ++pid)
+        total += r->len[pid];
+    memset(out, 0, sizeof(*out));
+    out->k = k;
+    uint32_t *bit = malloc((total + 1) * sizeof(uint32_t));
+    size_t *last = malloc(pages * sizeof(size_t));
+    /* process c's histogram at c * (m + 1), the global one after them */
+    uint64_t *hist = calloc((size_t)k * (m + 1) + pages + 1, sizeof(uint64_t));
+    uint64_t *cold = calloc((size_t)k + 1, sizeof(uint64_t));
+    out->refs = calloc((size_t)k + 1, sizeof(uint64_t));
+    int rc = (bit && last && hist && cold && out->refs) ? 0 : -1;
+
+    size_t rows = 1;
+    for (int c = 0; rc == 0 && c <= k; ++c)
+    {
+        int lo = c < k ? c : 0, hi = c < k ? c + 1 : k;
+        size_t n = c < k ? r->len[c] : total;
+        uint64_t *h = hist + (size_t)c * (m + 1);
+        memset(bit, 0, (n + 1) * sizeof(uint32_t));
+        memset(last, 0, (size_t)(hi - lo) * m * sizeof(size_t));
+        out->refs[c] = stack_distances(r, lo, hi, bit, n, last, h, &cold[c]);
+        size_t d = max_distance(h, c < k ? (size_t)m : pages);
+        if (d > rows)
+            rows = d;
+    }
+
+    out->rows = (int)rows;
+    if (rc == 0)
+        out->faults = malloc((size_t)(k + 1) * rows * sizeof(uint64_t));
+    if (!out->faults)
+        rc = -1;
+    for (int c = 0; rc == 0 && c <= k; ++c)
+    {
+        /* faults(f) = cold + references with distance > f, summed from the top */
+        const uint64_t *h = hist + (size_t)c * (m + 1);
+        size_t top = c < k ? (size_t)m : pages;
+        uint64_t above = 0;
+        for (size_t d = top; d > rows; --d)
+            above += h[d];
+        for (size_t f = rows; f >= 1; --f)
+        {
+            out->faults[(size_t)c * rows + f - 1] = cold[c] + above;
+            if (f <= top)
+                above += h[f];
+        }
+    }
+    free(bit);
+    free(last);
+    free(hist);
+    free(cold);
+    if (rc != 0)
+        mrc_free(out);
+    return rc;
+}
+
+/* ---------- SHARDS: sampled distances in fixed memory ---------- */
+/* A page is tracked while hash(page) < threshold, out of SHARDS_P; the
+ * sampling rate is R = threshold / SHARDS_P. Distances among tracked pages
+ * scale by 1/R and every sampled reference counts 1/R times. When more than
+ * 'cap' pages are tracked, the threshold drops to the largest tracked hash
+ * and the pages at or above it go, so memory stays O(cap) however long the
+ * trace. The access-time tree is renumbered 1..live whenever its window of
+ * SHARDS_WINDOW * (cap + 1) times fills up.
+ */
+
+#define SHARDS_BITS   24
+#define SHARDS_P      (1u << SHARDS_BITS)
+#define SHARDS_WINDOW 4
+
+typedef struct {
+    int cap;
+    uint32_t threshold;
+    int live;
+    uint64_t *key;       /* cap + 1 slots (one past the cap until the drop) */
+    uint32_t *hash;
+    uint32_t *time;
+    int *hpos;           /* slot -> heap index */
+    int *heap;           /* max-heap of live slots by hash */
+    int *free_slots;
+    int nfree;
+    int *table;          /* open addressing, slot or -1 */
+    size_t tmask;
+    uint32_t *bit;       /* window + 1 */
+    uint32_t window;
+    uint32_t now;
+} shards_t;
+
+static uint64_t shards_mix(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+static void shards_reset(shards_t *sh)
+{
+    sh->threshold = SHARDS_P;
+    sh->live = 0;
+    sh->nfree = sh->cap + 1;
+    for (int i = 0; i <= sh->cap; ++i)
+        sh->free_slots[i] = sh->cap - i;
+    for (size_t i = 0; i <= sh->tmask; ++i)
+        sh->table[i] = -1;
+    memset(sh->bit, 0, ((size_t)sh->window + 1) * sizeof(uint32_t));
+    sh->now = 0;
+}
+
+static void shards_free(shards_t *sh)
+{
+    free(sh->key);
+    free(sh->hash);
+    free(sh->time);
+    free(sh->hpos);
+    free(sh->heap);
+    free(sh->free_slots);
+    free(sh->table);
+    free(sh->bit);
+}
+
+static int shards_init(shards_t *sh, int cap)
+{
+    memset(sh, 0, sizeof(*sh));
+    size_t slots = (size_t)cap + 1, tsize = 2;
+    while (tsize < 2 * slots)
+        tsize <<= 1;
+    sh->cap = cap;
+    sh->tmask = tsize - 1;
+    sh->window = SHARDS_WINDOW * (uint32_t)slots;
+    sh->key = malloc(slots * sizeof(uint64_t));
+    sh->hash = malloc(slots * sizeof(uint32_t));
+    sh->time = malloc(slots * sizeof(uint32_t));
+    sh->hpos = malloc(slots * sizeof(int));
+    sh->heap = malloc(slots * sizeof(int));
+    sh->free_slots = malloc(slots * sizeof(int));
+    sh->table = malloc(tsize * sizeof(int));
+    sh->bit = malloc(((size_t)sh->window + 1) * sizeof(uint32_t));
+    if (!sh->key || !sh->hash || !sh->time || !sh->hpos || !sh->heap || !sh->free_slots ||
+        !sh->table || !sh->bit)
+    {
+        shards_free(sh);
+        return -1;
+    }
+    shards_reset(sh);
+    return 0;
+}
+
+/* table position of key, or of the empty cell that ends its probe */
+static size_t shards_find(const shards_t *sh, uint64_t key, uint64_t mixed)
+{
+    size_t i = mixed & sh->tmask;
+    while (sh->table[i] >= 0 && sh->key[sh->table[i]] != key)
+        i = (i + 1) & sh->tmask;
+    return i;
+}
+
+/* linear-probing delete with backward shift, no tombstones */
+static void shards_table_del(shards_t *sh, size_t i)
+{
+    sh->table[i] = -1;
+    for (size_t j = (i + 1) & sh->tmask; sh->table[j] >= 0; j = (j + 1) & sh->tmask)
+    {
+        size_t home = shards_mix(sh->key[sh->table[j]]) & sh->tmask;
+        if (((j - home) & sh->tmask) >= ((j - i) & sh->tmask))
+        {
+            sh->table[i] = sh->table[j];
+            sh->table[j] = -1;
+            i = j;
+        }
+    }
+}
+
+static void shards_heap_swap(shards_t *sh, int a, int b)
+{
+    int sa = sh->heap[a], sb = sh->heap[b];
+    sh->heap[a] = sb;
+    sh->heap[b] = sa;
+    sh->hpos[sb] = a;
+    sh->hpos[sa] = b;
+}
+
+static void shards_heap_up(shards_t *sh, int i)
+{
+    while (i > 0 && sh->hash[sh->heap[(i - 1) / 2]] < sh->hash[sh->heap[i]])
+    {
+        shards_heap_swap(sh, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+static void shards_heap_down(shards_t *sh, int i)
+{
+    for (;;)
+    {
+        int l = 2 * i + 1, r = l + 1, big = i;
+        if (l < sh->live && sh->hash[sh->heap[l]] > sh->hash[sh->heap[big]])
+            big = l;
+        if (r < sh->live && sh->hash[sh->heap[r]] > sh->hash[sh->heap[big]])
+            big = r;
+        if (big == i)
+            return;
+        shards_heap_swap(sh, i, big);
+        i = big;
+    }
+}
+
+static int shards_cmp_time(const void *a, const void *b, void *arg)
+{
+    const uint32_t *time = arg;
+    uint32_t ta = time[*(const int *)a], tb = time[*(const int *)b];
+    return ta < tb ? -1 : ta > tb;
+}
+
+/* renumber live access times 1..live, keeping their order */
+static void shards_compact(shards_t *sh)
+{
+    int *order = sh->free_slots + sh->nfree; /* unused tail: room for live slots */
+    memcpy(order, sh->heap, (size_t)sh->live * sizeof(int));
+    qsort_r(order, (size_t)sh->live, sizeof(int), shards_cmp_time, sh->time);
+    memset(sh->bit, 0, ((size_t)sh->window + 1) * sizeof(uint32_t));
+    for (int i = 0; i < sh->live; ++i)
+    {
+        sh->time[order[i]] = (uint32_t)i + 1;
+        bit_add(sh->bit, sh->window, (size_t)i + 1, 1);
+    }
+    sh->now = (uint32_t)sh->live;
+}
+
+static uint32_t shards_tick(shards_t *sh)
+{
+    if (sh->now == sh->window)
+        shards_compact(sh);
+    return ++sh->now;
+}
+
+/* drop the pages with the largest hash until at most cap are tracked */
+static void shards_shrink(shards_t *sh)
+{
+    while (sh->live > sh->cap)
+    {
+        uint32_t top = sh->hash[sh->heap[0]];
+        sh->threshold = top;
+        while (sh->live > 0 && sh->hash[sh->heap[0]] >= top)
+        {
+            int s = sh->heap[0];
+            shards_heap_swap(sh, 0, --sh->live);
+            shards_heap_down(sh, 0);
+            bit_add(sh->bit, sh->window, sh->time[s], -1);
+            shards_table_del(sh, shards_find(sh, sh->key[s], shards_mix(sh->key[s])));
+            sh->free_slots[sh->nfree++] = s;
+        }
+    }
+}
+
+/* Access a sampled page. Returns its distance among tracked pages, or 0
+ * on its first access (it is tracked from now on). */
+static uint32_t shards_access(shards_t *sh, uint64_t key, uint64_t mixed, uint32_t h)
+{
+    size_t i = shards_find(sh, key, mixed);
+    int s = sh->table[i];
+    if (s >= 0)
+    {
+        uint32_t d = (uint32_t)sh->live - bit_prefix(sh->bit, sh->time[s]) + 1;
+        uint32_t t = shards_tick(sh); /* may renumber time[s] */
+        bit_add(sh->bit, sh->window, sh->time[s], -1);
+        sh->time[s] = t;
+        bit_add(sh->bit, sh->window, t, 1);
+        return d;
+    }
+    uint32_t t = shards_tick(sh); /* before the slot leaves the free list */
+    s = sh->free_slots[--sh->nfree];
+    sh->table[i] = s;
+    sh->key[s] = key;
+    sh->hash[s] = h;
+    sh->time[s] = t;
+    bit_add(sh->bit, sh->window, t, 1);
+    sh->heap[sh->live] = s;
+    sh->hpos[s] = sh->live++;
+    shards_heap_up(sh, sh->live - 1);
+    shards_shrink(sh);
+    return 0;
+}
+
+int mrc_build_sampled(const refs_t *r, int cap, mrc_t *out)
+{
+    int k = r->k, m = r->m;
+    size_t pages = (size_t)k * m;
+    shards_t sh;
+    memset(out, 0, sizeof(*out));
+    out->k = k;
+    if (cap <= 0 || shards_init(&sh, cap) != 0)
+        return -1;
+    /* estimated count and variance per distance; process c at c * (m + 1) */
+    size_t hn = (size_t)k * (m + 1) + pages + 1;
+    double *hist = calloc(hn, sizeof(double));
+    double *hvar = calloc(hn, sizeof(double));
+    double *cold = calloc((size_t)k + 1, sizeof(double));
+    double *cvar = calloc((size_t)k + 1, sizeof(double));
+    double *deff = calloc((size_t)k + 1, sizeof(double));
+    out->refs = calloc((size_t)k + 1, sizeof(uint64_t));
+    out->rate = calloc((size_t)k + 1, sizeof(double));
+    int rc = (hist && hvar && cold && cvar && deff && out->refs && out->rate) ? 0 : -1;
+
+    size_t rows = 1;
+    for (int c = 0; rc == 0 && c <= k; ++c)
+    {
+        int lo = c < k ? c : 0, hi = c < k ? c + 1 : k;
+        size_t top = c < k ? (size_t)m : pages, dmax = 0;
+        double *h = hist + (size_t)c * (m + 1), *v = hvar + (size_t)c * (m + 1);
+        uint64_t sampled = 0, first = 0;
+        shards_reset(&sh);
+        for (int pid = lo; pid < hi; ++pid)
+        {
+            const int32_t *refs = refs_of(r, pid);
+            for (uint32_t i = 0; i < r->len[pid]; ++i)
+            {
+                int32_t page = ref_page(refs[i]);
+                if (page < 0 || page >= m)
+                    break;
+                out->refs[c]++;
+                uint64_t key = (uint64_t)pid * m + page;
+                uint64_t mixed = shards_mix(key);
+                uint32_t hv = (uint32_t)(mixed >> (64 - SHARDS_BITS));
+                if (hv >= sh.threshold)
+                    continue;
+                double w = (double)SHARDS_P / sh.threshold;
+                uint32_t d = shards_access(&sh, key, mixed, hv);
+                sampled++;
+                if (d == 0)
+                {
+                    first++;
+                    cold[c] += w;
+                    cvar[c] += w * (w - 1);
+                    continue;
+                }
+                size_t sd = (size_t)(d * w + 0.5);
+                if (sd > top)
+                    sd = top;
+                if (sd > dmax)
+                    dmax = sd;
+                h[sd] += w;
+                v[sd] += w * (w - 1);
+            }
+        }
+        out->rate[c] = (double)sh.threshold / SHARDS_P;
+        deff[c] = first ? (double)sampled / first : 1.0;
+        if (dmax > rows)
+            rows = dmax;
+    }
+    shards_free(&sh);
+
+    out->rows = (int)rows;
+    if (rc == 0)
+    {
+        out->faults = malloc((size_t)(k + 1) * rows * sizeof(uint64_t));
+        out->err = malloc((size_t)(k + 1) * rows * sizeof(double));
+        if (!out->faults || !out->err)
+            rc = -1;
+    }
+    for (int c = 0; rc == 0 && c <= k; ++c)
+    {
+        const double *h = hist + (size_t)c * (m + 1), *v = hvar + (size_t)c * (m + 1);
+        size_t top = c < k ? (size_t)m : pages;
+        /* the weights only estimate the reference count: rescale to the
+         * known one, so the curve keeps the sampled miss ratio */
+        double est = cold[c];
+        for (size_t d = 1; d <= top; ++d)
+            est += h[d];
+        double scale = est > 0 ? out->refs[c] / est : 0.0;
+        double above = 0, var = 0;
+        for (size_t d = top; d > rows; --d)
+        {
+            above += h[d];
+            var += v[d];
+        }
+        for (size_t f = rows; f >= 1; --f)
+        {
+            size_t at = (size_t)c * rows + f - 1;
+            out->faults[at] = (uint64_t)((cold[c] + above) * scale + 0.5);
+            out->err[at] = 2 * sqrt((cvar[c] + var) * deff[c]) * scale;
+            if (f <= top)
+            {
+                above += h[f];
+                var += v[f];
+            }
+        }
+        /* a distance D is seen as about Binomial(D, R) tracked pages
+         * scaled by 1/R, 2 sigma = 2 * sqrt(D * (1 - R) / R): add how far
+         * the curve moves within that band around f */
+        const uint64_t *fc = out->faults + (size_t)c * rows;
+        double q = (1 - out->rate[c]) / out->rate[c];
+        for (size_t f = 1; f <= rows; ++f)
+        {
+            double band = 2 * sqrt((double)f * q);
+            size_t lo = f > band + 1 ? f - (size_t)ceil(band) : 1;
+            size_t hi = f + (size_t)ceil(band) < rows ? f + (size_t)ceil(band) : rows;
+            uint64_t up = fc[lo - 1] - fc[f - 1], down = fc[f - 1] - fc[hi - 1];
+            out->err[(size_t)c * rows + f - 1] += up > down ? up : down;
+        }
+    }
+    free(hist);
+    free(hvar);
+    free(cold);
+    free(cvar);
+    free(deff);
+    if (rc != 0)
+        mrc_free(out);
+    return rc;
+}
+
+int mrc_write_csv(const mrc_t *mrc, FILE *fp)
+{
+    fprintf(fp, "frames");
+    for (int c = 0; c < mrc->k; ++c)
+        fprintf(fp, mrc->err ? ",p%d,p%d_err" : ",p%d", c, c);
+    fprintf(fp, mrc->err ? ",global,global_err\n" : ",global\n");
+    for (int f = 1; f <= mrc->rows; ++f)
+    {
+        fprintf(fp, "%d", f);
+        for (int c = 0; c <= mrc->k; ++c)
+        {
+            size_t at = (size_t)c * mrc->rows + f - 1;
+            fprintf(fp, ",%llu", (unsigned long long)mrc->faults[at]);
+            if (mrc->err)
+                fprintf(fp, ",%.0f", mrc->err[at]);
+        }
+        fputc('\n', fp);
+    }
+    return ferror(fp) ? -1 : 0;
+}
+
+void mrc_free(mrc_t *mrc)
+{
+    free(mrc->faults);
+    free(mrc->refs);
+    free(mrc->err);
+    free(mrc->rate);
+    mrc->faults = NULL;
+    mrc->refs = NULL;
+    mrc->err = NULL;
+    mrc->rate = NULL;
+}
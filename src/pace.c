@@ -0,0 +1,84 @@
+/* pace.c
+ * Pacing modes and the virtual-time cost model (see pace.h).
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "pace.h"
+
+static const char *mode_names[] = {"none", "real", "virtual"};
+
+const char *pace_mode_name(pace_mode_t mode)
+{
+    return mode <= PACE_VIRTUAL ? mode_names[mode] : "?";
+}
+
+/* Parse an unsigned decimal at *s (advancing it). Returns 0 on success. */
+static int parse_u64(const char **s, uint64_t *out)
+{
+    char *end;
+    if (**s < '0' || **s > '9')
+        return -1;
+    errno = 0;
+    unsigned long long v = strtoull(*s, &end, 10);
+    if (errno == ERANGE)
+        return -1;
+    *out = v;
+    *s = end;
+    return 0;
+}
+
+int pace_parse(const char *spec, pace_t *out)
+{
+    pace_t p = {PACE_NONE, PACE_REAL_DELAY_US, PACE_HIT_NS, PACE_FAULT_NS, PACE_CTX_NS};
+    size_t name_len = strcspn(spec, ":");
+    const char *args = spec[name_len] == ':' ? spec + name_len + 1 : NULL;
+
+    if (name_len == 4 && strncmp(spec, "none", 4) == 0)
+    {
+        if (args)
+            return -1;
+        p.mode = PACE_NONE;
+    }
+    else if (name_len == 4 && strncmp(spec, "real", 4) == 0)
+    {
+        p.mode = PACE_REAL;
+        uint64_t us;
+        if (args && (parse_u64(&args, &us) != 0 || *args != '\0'))
+            return -1;
+        if (args)
+            p.delay_us = (unsigned long)us;
+    }
+    else if (name_len == 7 && strncmp(spec, "virtual", 7) == 0)
+    {
+        p.mode = PACE_VIRTUAL;
+        uint64_t *fields[] = {&p.hit_ns, &p.fault_ns, &p.ctx_ns};
+        for (int i = 0; args && i < 3; i++)
+        {
+            if (*args != ',' && parse_u64(&args, fields[i]) != 0)
+                return -1;
+            if (*args == '\0')
+                args = NULL;
+            else if (*args++ != ',' || i == 2)
+                return -1;
+        }
+    }
+    else
+    {
+        return -1;
+    }
+    *out = p;
+    return 0;
+}
+
+void pace_wait(const pace_t *p)
+{
+    if (p->mode != PACE_REAL || p->delay_us == 0)
+        return;
+    struct timespec ts = {(time_t)(p->delay_us / 1000000ul), (long)(p->delay_us % 1000000ul) * 1000};
+    while (nanosleep(&ts, &ts) == -1 && errno == EINTR)
+        ;
+}
@@ -0,0 +1,1564 @@
+/* policy.c
+ * Built-in page-replacement policies (see policy.h).
+ *
+ * All state beyond the SM1 page tables is private to the MMU and sized
+ * once at creation, so no policy allocates on the access path.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "types.h"
+#include "memory.h"
+#include "policy.h"
+#include "refs.h"
+
+/* Owner of the head of the global frame list (mapping order, plus
+ * ft_touch() by policies that track recency) */
+static int frame_list_victim(repl_policy_t *pol, int *pid_out)
+{
+    int frame = ft_lru(pol->frames, pol->f);
+    if (frame < 0)
+        return -1;
+    *pid_out = pol->frames[frame].pid;
+    return pol->frames[frame].page;
+}
+
+/* ---------- FIFO ---------- */
+/* SM1 recency lists are in mapping order as long as hits do not relink. */
+
+static int fifo_choose_victim(repl_policy_t *pol, int pid)
+{
+    return lru_victim_local(pol->sm1_base, pid, pol->m);
+}
+
+/* ---------- LRU ---------- */
+
+static void lru_on_hit(repl_policy_t *pol, int pid, int page_no)
+{
+    lru_touch(pol->sm1_base, pid, pol->m, page_no);
+    if (pol->frames)
+        ft_touch(pol->frames, pol->f, pte_frame(pte_addr(pol->sm1_base, pid, pol->m, page_no)));
+}
+
+static int lru_choose_victim(repl_policy_t *pol, int pid)
+{
+    int victim = lru_victim_local(pol->sm1_base, pid, pol->m);
+#ifdef MMU_CHECK_LRU
+    /* debug builds (-DMMU_CHECK_LRU): cross-check the O(1) list against the O(m) scan */
+    int scan = choose_lru_victim_local(pol->sm1_base, pid, pol->m);
+    if (victim != scan)
+        fprintf(stderr, "[POLICY] pid=%d LRU list victim=%d disagrees with scan victim=%d\n",
+                pid, victim, scan);
+#endif
+    return victim;
+}
+
+/* ---------- LRU by timestamp scan ---------- */
+/* Same victims as lru (timestamps are unique), but hits do not relink. */
+
+static int lru_scan_choose_victim(repl_policy_t *pol, int pid)
+{
+    return choose_lru_victim_local(pol->sm1_base, pid, pol->m);
+}
+
+/* oldest of the k local victims: O(k*m) */
+static int lru_scan_choose_global(repl_policy_t *pol, int *pid_out)
+{
+    int victim = -1;
+    uint32_t oldest = 0;
+    for (int pid = 0; pid < pol->k; ++pid)
+    {
+        int page = choose_lru_victim_local(pol->sm1_base, pid, pol->m);
+        if (page < 0)
+            continue;
+        uint32_t ts = *pte_ts_addr(pol->sm1_base, pid, pol->m, page);
+        if (victim < 0 || ts < oldest)
+        {
+            victim = page;
+            oldest = ts;
+            *pid_out = pid;
+        }
+    }
+    return victim;
+}
+
+/* ---------- CLOCK family ---------- */
+/* Reference bits live in packed 64-bit words, so a hit is one bit set and a
+ * hand sweeps 64 pages per step: pages it can take are res & ~ref, found
+ * with count-trailing-zeros, and the referenced pages it passes lose their
+ * bit in one mask operation. Local replacement keeps one bitmap region and
+ * hand per process (slot = page); global replacement one region over frames
+ * (slot = frame, found from the PTE on each access) and a single hand.
+ *
+ *   clock  : second chance
+ *   esc    : enhanced second chance; one read-only pass for an unreferenced
+ *            clean page (PTE_DIRTY clear), then one clock pass that takes
+ *            the first unreferenced page, repeated once
+ *   gclock : generalized clock; a referenced page passed by the hand gains
+ *            one count (up to GCLOCK_MAX) instead of a single bit, and an
+ *            unreferenced one with a count loses one, so frequently used
+ *            pages survive several sweeps. Hits still only set the bit.
+ */
+
+#define GCLOCK_MAX 3
+
+enum { CLOCK_PLAIN, CLOCK_ESC, CLOCK_GEN };
+
+typedef struct {
+    int kind;            /* CLOCK_* */
+    int words;           /* words per region */
+    uint64_t *ref;       /* reference bits */
+    uint64_t *res;       /* slots holding a resident page */
+    uint64_t *hot;       /* gclock: slots with count > 0 */
+    uint8_t *count;      /* gclock: one counter per slot */
+    int *hand;           /* per-process hand (page index) */
+    int ghand;           /* global hand (frame number) */
+} clock_state_t;
+
+static inline size_t clock_slot(repl_policy_t *pol, int pid, int page_no)
+{
+    clock_state_t *st = pol->priv;
+    if (pol->frames)
+        return (size_t)pte_frame(pte_addr(pol->sm1_base, pid, pol->m, page_no));
+    return (size_t)pid * st->words * 64 + page_no;
+}
+
+static void clock_on_hit(repl_policy_t *pol, int pid, int page_no)
+{
+    clock_state_t *st = pol->priv;
+    size_t s = clock_slot(pol, pid, page_no);
+    st->ref[s >> 6] |= 1ull << (s & 63);
+}
+
+static void clock_on_fault(repl_policy_t *pol, int pid, int page_no)
+{
+    clock_state_t *st = pol->priv;
+    size_t s = clock_slot(pol, pid, page_no);
+    st->res[s >> 6] |= 1ull << (s & 63);
+    st->ref[s >> 6] |= 1ull << (s & 63);
+}
+
+static void clock_on_evict(repl_policy_t *pol, int pid, int page_no)
+{
+    clock_state_t *st = pol->priv;
+    size_t s = clock_slot(pol, pid, page_no);
+    uint64_t keep = ~(1ull << (s & 63));
+    st->res[s >> 6] &= keep;
+    st->ref[s >> 6] &= keep;
+    if (st->count)
+    {
+        st->hot[s >> 6] &= keep;
+        st->count[s] = 0;
+    }
+}
+
+/* Next hand position after bit 'b' of a region of n bits */
+static inline int clock_next(int b, int n)
+{
+    return b + 1 == n ? 0 : b + 1;
+}
+
+/* Word after word w, wrapping at the end of the region */
+static inline int clock_next_word(int w, int n)
+{
+    return (w + 1) * 64 >= n ? 0 : (w + 1) * 64;
+}
+
+/* Second-chance sweep over 'cycles' revolutions of a region (base word,
+ * n bits) from *hand. Returns the victim's bit and moves the hand past it,
+ * or -1 (hand unchanged) if the region holds no resident page.
+ */
+static int clock_sweep(clock_state_t *st, size_t base, int n, int *hand, int cycles)
+{
+    int words = (n + 63) / 64;
+    int pos = *hand;
+    for (int i = 0; i <= cycles * words; ++i)
+    {
+        int w = pos >> 6;
+        uint64_t span = ~0ull << (pos & 63);
+        uint64_t *ref = &st->ref[base + w];
+        uint64_t cand = st->res[base + w] & ~*ref & span;
+        if (cand)
+        {
+            int b = __builtin_ctzll(cand);
+            *ref &= ~(span & ((1ull << b) - 1)); /* the passed pages used their chance */
+            *hand = clock_next(w * 64 + b, n);
+            return w * 64 + b;
+        }
+        *ref &= ~span;
+        pos = clock_next_word(w, n);
+    }
+    return -1;
+}
+
+static int clock_dirty(repl_policy_t *pol, int pid, int b)
+{
+    if (pid < 0)
+    {
+        pid = pol->frames[b].pid;
+        b = pol->frames[b].page;
+    }
+    return (pte_addr(pol->sm1_base, pid, pol->m, b)->word & PTE_DIRTY) != 0;
+}
+
+/* One read-only revolution looking for an unreferenced clean page.
+ * Only the dirty bits of unreferenced pages are read. */
+static int esc_find_clean(repl_policy_t *pol, int pid, size_t base, int n, int *hand)
+{
+    clock_state_t *st = pol->priv;
+    int words = (n + 63) / 64;
+    int pos = *hand;
+    for (int i = 0; i <= words; ++i)
+    {
+        int w = pos >> 6;
+        uint64_t cand = st->res[base + w] & ~st->ref[base + w] & (~0ull << (pos & 63));
+        for (; cand; cand &= cand - 1)
+        {
+            int b = w * 64 + __builtin_ctzll(cand);
+            if (!clock_dirty(pol, pid, b))
+            {
+                *hand = clock_next(b, n);
+                return b;
+            }
+        }
+        pos = clock_next_word(w, n);
+    }
+    return -1;
+}
+
+static int esc_sweep(repl_policy_t *pol, int pid, size_t base, int n, int *hand)
+{
+    /* after the first clock pass every reference bit is clear */
+    for (int round = 0; round < 2; ++round)
+    {
+        int b = esc_find_clean(pol, pid, base, n, hand);
+        if (b < 0)
+            b = clock_sweep(pol->priv, base, n, hand, 1);
+        if (b >= 0)
+            return b;
+    }
+    return -1;
+}
+
+/* The hand passes the resident slots 'pass' of word w: referenced ones
+ * trade their bit for a count, the others spend one. */
+static void gclock_pass(clock_state_t *st, size_t base, int w, uint64_t pass)
+{
+    uint64_t *ref = &st->ref[base + w];
+    uint64_t *hot = &st->hot[base + w];
+    for (uint64_t todo = pass & (*ref | *hot); todo; todo &= todo - 1)
+    {
+        int b = __builtin_ctzll(todo);
+        uint8_t *cnt = &st->count[(base + w) * 64 + b];
+        if (*ref & (1ull << b))
+        {
+            if (*cnt < GCLOCK_MAX)
+                ++*cnt;
+            *hot |= 1ull << b;
+        }
+        else if (--*cnt == 0)
+            *hot &= ~(1ull << b);
+    }
+    *ref &= ~pass;
+}
+
+/* A count of GCLOCK_MAX plus a reference bit lasts GCLOCK_MAX + 1
+ * revolutions, so the next one finds a victim. */
+static int gclock_sweep(clock_state_t *st, size_t base, int n, int *hand)
+{
+    int words = (n + 63) / 64;
+    int pos = *hand;
+    for (int i = 0; i <= (GCLOCK_MAX + 2) * words; ++i)
+    {
+        int w = pos >> 6;
+        uint64_t res = st->res[base + w] & (~0ull << (pos & 63));
+        uint64_t cand = res & ~st->ref[base + w] & ~st->hot[base + w];
+        if (cand)
+        {
+            int b = __builtin_ctzll(cand);
+            gclock_pass(st, base, w, res & ((1ull << b) - 1));
+            *hand = clock_next(w * 64 + b, n);
+            return w * 64 + b;
+        }
+        gclock_pass(st, base, w, res);
+        pos = clock_next_word(w, n);
+    }
+    return -1;
+}
+
+/* Victim of process pid's region, or of the frame region if pid < 0 */
+static int clock_pick(repl_policy_t *pol, int pid)
+{
+    clock_state_t *st = pol->priv;
+    size_t base = pid < 0 ? 0 : (size_t)pid * st->words;
+    int n = pid < 0 ? pol->f : pol->m;
+    int *hand = pid < 0 ? &st->ghand : &st->hand[pid];
+    switch (st->kind)
+    {
+    case CLOCK_ESC:
+        return esc_sweep(pol, pid, base, n, hand);
+    case CLOCK_GEN:
+        return gclock_sweep(st, base, n, hand);
+    default:
+        return clock_sweep(st, base, n, hand, 2);
+    }
+}
+
+static int clock_choose_victim(repl_policy_t *pol, int pid)
+{
+    return clock_pick(pol, pid);
+}
+
+static int clock_choose_global(repl_policy_t *pol, int *pid_out)
+{
+    int fr = clock_pick(pol, -1);
+    if (fr < 0)
+        return -1;
+    *pid_out = pol->frames[fr].pid;
+    return pol->frames[fr].page;
+}
+
+static void clock_destroy(repl_policy_t *pol)
+{
+    clock_state_t *st = pol->priv;
+    if (st)
+    {
+        free(st->ref);
+        free(st->res);
+        free(st->hot);
+        free(st->count);
+        free(st->hand);
+        free(st);
+    }
+}
+
+static int clock_init_kind(repl_policy_t *pol, int kind)
+{
+    clock_state_t *st = calloc(1, sizeof(*st));
+    if (!st)
+        return -1;
+    pol->priv = st;
+    st->kind = kind;
+    st->words = ((pol->frames ? pol->f : pol->m) + 63) / 64;
+    size_t n = pol->frames ? (size_t)st->words : (size_t)pol->k * st->words;
+    st->ref = calloc(n, sizeof(uint64_t));
+    st->res = calloc(n, sizeof(uint64_t));
+    st->hand = calloc((size_t)pol->k, sizeof(int));
+    if (!st->ref || !st->res || !st->hand)
+        return -1;
+    if (kind == CLOCK_GEN)
+    {
+        st->hot = calloc(n, sizeof(uint64_t));
+        st->count = calloc(n * 64, 1);
+        if (!st->hot || !st->count)
+            return -1;
+    }
+    return 0;
+}
+
+static int clock_init(repl_policy_t *pol)
+{
+    return clock_init_kind(pol, CLOCK_PLAIN);
+}
+
+static int esc_init(repl_policy_t *pol)
+{
+    return clock_init_kind(pol, CLOCK_ESC);
+}
+
+static int gclock_init(repl_policy_t *pol)
+{
+    return clock_init_kind(pol, CLOCK_GEN);
+}
+
+/* ---------- ARC / CAR ---------- */
+/* Adaptive replacement: resident pages sit in T1 (seen once recently) or T2
+ * (seen at least twice), and recently evicted pages stay as ghosts in B1
+ * or B2. A fault on a B1 ghost grows the T1 target p, a fault on a B2 ghost
+ * shrinks it, and the victim comes from T1 while it is above p. A scan
+ * therefore only churns T1 and leaves the hot pages in T2 alone.
+ *
+ * Every (pid, page) owns one node of a fixed pool (k*m links plus four
+ * sentinels per domain), as a page is in at most one of the lists; a
+ * domain is a process with local replacement, the whole system with
+ * global replacement. All operations are O(1) list splices.
+ *
+ * arc : a hit moves the page to the MRU end of T2. The victim is T1's LRU
+ *       page when |T1| > p (or T2 is empty), else T2's. (ARC's tie case,
+ *       |T1| == p with the faulting page in B2, is left out: the policy
+ *       learns the faulting page only after the eviction, in on_fault.)
+ * car : CLOCK for ARC; a hit only sets the page's reference bit. The hand
+ *       moves referenced pages from the head of T1 or T2 to the tail of T2
+ *       and takes the first unreferenced one.
+ *
+ * Ghosts are trimmed on each fault that evicted, as in CAR: B1 while
+ * |T1| + |B1| reaches the cache size c, else B2 while all four lists reach
+ * 2c. c is f with global replacement and the process's resident set with
+ * local replacement.
+ */
+
+enum { ARC_NONE, ARC_T1, ARC_T2, ARC_B1, ARC_B2 };
+
+typedef struct {
+    int p;               /* target size of T1 */
+    int size[5];         /* per list, index ARC_* (ARC_NONE unused) */
+    int full;            /* the last fault evicted: trim ghosts */
+} arc_dom_t;
+
+typedef struct {
+    int car;             /* CLOCK variant */
+    int nodes;           /* k*m; sentinel of (dom, list) at nodes + dom*4 + list-1 */
+    lru_link_t *link;
+    uint8_t *where;      /* k*m: ARC_* list of each node */
+    uint64_t *ref;       /* car: reference bit per node */
+    arc_dom_t *dom;
+} arc_state_t;
+
+static inline int arc_head(const arc_state_t *st, int d, int list)
+{
+    return st->nodes + d * 4 + list - 1;
+}
+
+static void arc_unlink(arc_state_t *st, arc_dom_t *dom, int n)
+{
+    lru_link_t *lk = st->link;
+    lk[lk[n].prev].next = lk[n].next;
+    lk[lk[n].next].prev = lk[n].prev;
+    dom->size[st->where[n]]--;
+    st->where[n] = ARC_NONE;
+}
+
+static void arc_push_mru(arc_state_t *st, arc_dom_t *dom, int d, int list, int n)
+{
+    lru_link_t *lk = st->link;
+    int h = arc_head(st, d, list);
+    int mru = lk[h].prev;
+    lk[n].prev = mru;
+    lk[n].next = h;
+    lk[mru].next = n;
+    lk[h].prev = n;
+    st->where[n] = (uint8_t)list;
+    dom->size[list]++;
+}
+
+static inline int arc_lru(const arc_state_t *st, int d, int list)
+{
+    return st->link[arc_head(st, d, list)].next;
+}
+
+static inline int arc_dom_of(repl_policy_t *pol, int pid)
+{
+    return pol->frames ? 0 : pid;
+}
+
+static void arc_on_hit(repl_policy_t *pol, int pid, int page_no)
+{
+    arc_state_t *st = pol->priv;
+    int d = arc_dom_of(pol, pid);
+    int n = pid * pol->m + page_no;
+    arc_unlink(st, &st->dom[d], n);
+    arc_push_mru(st, &st->dom[d], d, ARC_T2, n);
+}
+
+static void car_on_hit(repl_policy_t *pol, int pid, int page_no)
+{
+    arc_state_t *st = pol->priv;
+    size_t n = (size_t)pid * pol->m + page_no;
+    st->ref[n >> 6] |= 1ull << (n & 63);
+}
+
+static inline int car_test_clear(arc_state_t *st, int n)
+{
+    uint64_t bit = 1ull << (n & 63);
+    int was = (st->ref[n >> 6] & bit) != 0;
+    st->ref[n >> 6] &= ~bit;
+    return was;
+}
+
+static void arc_on_fault(repl_policy_t *pol, int pid, int page_no)
+{
+    arc_state_t *st = pol->priv;
+    int d = arc_dom_of(pol, pid);
+    arc_dom_t *dom = &st->dom[d];
+    int n = pid * pol->m + page_no;
+    int *sz = dom->size;
+    int c = pol->frames ? pol->f : sz[ARC_T1] + sz[ARC_T2] + 1;
+
+    if (st->where[n] == ARC_B1)
+    {
+        int delta = sz[ARC_B2] > sz[ARC_B1] ? sz[ARC_B2] / sz[ARC_B1] : 1;
+        dom->p = dom->p + delta < c ? dom->p + delta : c;
+        arc_unlink(st, dom, n);
+        arc_push_mru(st, dom, d, ARC_T2, n);
+    }
+    else if (st->where[n] == ARC_B2)
+    {
+        int delta = sz[ARC_B1] > sz[ARC_B2] ? sz[ARC_B1] / sz[ARC_B2] : 1;
+        dom->p = dom->p > delta ? dom->p - delta : 0;
+        arc_unlink(st, dom, n);
+        arc_push_mru(st, dom, d, ARC_T2, n);
+    }
+    else
+    {
+        if (dom->full)
+        {
+            if (sz[ARC_T1] + sz[ARC_B1] >= c && sz[ARC_B1])
+                arc_unlink(st, dom, arc_lru(st, d, ARC_B1));
+            else if (sz[ARC_T1] + sz[ARC_T2] + sz[ARC_B1] + sz[ARC_B2] >= 2 * c && sz[ARC_B2])
+                arc_unlink(st, dom, arc_lru(st, d, ARC_B2));
+        }
+        arc_push_mru(st, dom, d, ARC_T1, n);
+    }
+    dom->full = 0;
+}
+
+static int arc_pick(repl_policy_t *pol, int d)
+{
+    arc_state_t *st = pol->priv;
+    arc_dom_t *dom = &st->dom[d];
+    int t1 = dom->size[ARC_T1], t2 = dom->size[ARC_T2];
+    if (!st->car)
+    {
+        if (t1 + t2 == 0)
+            return -1;
+        return arc_lru(st, d, (t1 > dom->p || t2 == 0) ? ARC_T1 : ARC_T2);
+    }
+    /* every referenced page passed loses its bit, so two rounds suffice */
+    for (int step = 0; step <= 2 * (t1 + t2); ++step)
+    {
+        int from_t1 = dom->size[ARC_T1] >= (dom->p > 1 ? dom->p : 1) || dom->size[ARC_T2] == 0;
+        if (from_t1 && dom->size[ARC_T1] == 0)
+            return -1;
+        int n = arc_lru(st, d, from_t1 ? ARC_T1 : ARC_T2);
+        if (!car_test_clear(st, n))
+            return n;
+        arc_unlink(st, dom, n);
+        arc_push_mru(st, dom, d, ARC_T2, n);
+    }
+    return -1;
+}
+
+static int arc_choose_victim(repl_policy_t *pol, int pid)
+{
+    int n = arc_pick(pol, pid);
+    return n < 0 ? -1 : n - pid * pol->m;
+}
+
+static int arc_choose_global(repl_policy_t *pol, int *pid_out)
+{
+    int n = arc_pick(pol, 0);
+    if (n < 0)
+        return -1;
+    *pid_out = n / pol->m;
+    return n % pol->m;
+}
+
+/* the victim becomes the MRU ghost of its list */
+static void arc_on_evict(repl_policy_t *pol, int pid, int page_no)
+{
+    arc_state_t *st = pol->priv;
+    int d = arc_dom_of(pol, pid);
+    arc_dom_t *dom = &st->dom[d];
+    int n = pid * pol->m + page_no;
+    int list = st->where[n];
+    if (list != ARC_T1 && list != ARC_T2)
+        return;
+    if (st->car)
+        car_test_clear(st, n);
+    arc_unlink(st, dom, n);
+    arc_push_mru(st, dom, d, list == ARC_T1 ? ARC_B1 : ARC_B2, n);
+    dom->full = 1;
+}
+
+static void arc_destroy(repl_policy_t *pol)
+{
+    arc_state_t *st = pol->priv;
+    if (st)
+    {
+        free(st->link);
+        free(st->where);
+        free(st->ref);
+        free(st->dom);
+        free(st);
+    }
+}
+
+static int arc_init_kind(repl_policy_t *pol, int car)
+{
+    arc_state_t *st = calloc(1, sizeof(*st));
+    if (!st)
+        return -1;
+    pol->priv = st;
+    st->car = car;
+    st->nodes = pol->k * pol->m;
+    int ndom = pol->frames ? 1 : pol->k;
+    st->link = malloc(((size_t)st->nodes + 4 * (size_t)ndom) * sizeof(lru_link_t));
+    st->where = calloc((size_t)st->nodes, 1);
+    st->dom = calloc((size_t)ndom, sizeof(arc_dom_t));
+    if (car)
+        st->ref = calloc(((size_t)st->nodes + 63) / 64, sizeof(uint64_t));
+    if (!st->link || !st->where || !st->dom || (car && !st->ref))
+        return -1;
+    for (int h = st->nodes; h < st->nodes + 4 * ndom; ++h)
+        st->link[h].prev = st->link[h].next = h;
+    return 0;
+}
+
+static int arc_init(repl_policy_t *pol)
+{
+    return arc_init_kind(pol, 0);
+}
+
+static int car_init(repl_policy_t *pol)
+{
+    return arc_init_kind(pol, 1);
+}
+
+/* ---------- MGLRU ---------- */
+/* Multi-generational LRU after the Linux design. Resident pages belong to
+ * one of up to MGLRU_GENS generations, numbered by a sequence min_seq ..
+ * max_seq per domain (a process with local replacement, the system with
+ * global replacement). A hit only sets the page's accessed bit and counts
+ * the access. Every 'interval' accesses of a domain (mglru:<interval>,
+ * default MGLRU_INTERVAL) an aging pass opens a new youngest generation
+ * and moves every accessed page into it, a bitmap word at a time.
+ *
+ * Faults enter the youngest generation. The victim is the LRU end of the
+ * oldest generation; an accessed page found there is promoted to the
+ * youngest instead (its second chance). An empty oldest generation is
+ * retired while more than MGLRU_MIN_GENS remain, else the domain ages.
+ * When all MGLRU_GENS are in use, aging folds the oldest generation into
+ * the next one first (one list splice).
+ */
+
+#define MGLRU_GENS      4
+#define MGLRU_MIN_GENS  2
+#define MGLRU_INTERVAL  1024
+
+typedef struct {
+    int min_seq;
+    int max_seq;
+    unsigned accesses;   /* since the last aging pass */
+} mglru_dom_t;
+
+typedef struct {
+    unsigned interval;
+    int nodes;           /* k*m; sentinel of (dom, seq) at nodes + dom*MGLRU_GENS + seq%MGLRU_GENS */
+    lru_link_t *link;    /* prev = -1: not resident */
+    uint64_t *accessed;  /* one bit per node */
+    mglru_dom_t *dom;
+} mglru_state_t;
+
+static inline int mglru_head(const mglru_state_t *st, int d, int seq)
+{
+    return st->nodes + d * MGLRU_GENS + seq % MGLRU_GENS;
+}
+
+static inline int mglru_empty(const mglru_state_t *st, int d, int seq)
+{
+    int h = mglru_head(st, d, seq);
+    return st->link[h].next == h;
+}
+
+static void mglru_unlink(mglru_state_t *st, int n)
+{
+    lru_link_t *lk = st->link;
+    lk[lk[n].prev].next = lk[n].next;
+    lk[lk[n].next].prev = lk[n].prev;
+    lk[n].prev = lk[n].next = -1;
+}
+
+static void mglru_push_young(mglru_state_t *st, int d, int n)
+{
+    lru_link_t *lk = st->link;
+    int h = mglru_head(st, d, st->dom[d].max_seq);
+    int mru = lk[h].prev;
+    lk[n].prev = mru;
+    lk[n].next = h;
+    lk[mru].next = n;
+    lk[h].prev = n;
+}
+
+static inline int mglru_test_clear(mglru_state_t *st, int n)
+{
+    uint64_t bit = 1ull << (n & 63);
+    int was = (st->accessed[n >> 6] & bit) != 0;
+    st->accessed[n >> 6] &= ~bit;
+    return was;
+}
+
+/* Open a new youngest generation and move the accessed pages of nodes
+ * [lo, hi) into it */
+static void mglru_age(mglru_state_t *st, int d, int lo, int hi)
+{
+    mglru_dom_t *dom = &st->dom[d];
+    lru_link_t *lk = st->link;
+    if (dom->max_seq - dom->min_seq + 1 == MGLRU_GENS)
+    {
+        /* fold the oldest generation into the LRU end of the next one */
+        int a = mglru_head(st, d, dom->min_seq), b = mglru_head(st, d, dom->min_seq + 1);
+        if (lk[a].next != a)
+        {
+            int first = lk[a].next, last = lk[a].prev, old = lk[b].next;
+            lk[b].next = first;
+            lk[first].prev = b;
+            lk[last].next = old;
+            lk[old].prev = last;
+            lk[a].next = lk[a].prev = a;
+        }
+        dom->min_seq++;
+    }
+    dom->max_seq++;
+    dom->accesses = 0;
+    for (int w = lo >> 6; w <= (hi - 1) >> 6; ++w)
+    {
+        uint64_t bits = st->accessed[w];
+        if (w == lo >> 6)
+            bits &= ~0ull << (lo & 63);
+        if (w == (hi - 1) >> 6 && (hi & 63))
+            bits &= ~(~0ull << (hi & 63));
+        st->accessed[w] &= ~bits;
+        for (; bits; bits &= bits - 1)
+        {
+            int n = w * 64 + __builtin_ctzll(bits);
+            mglru_unlink(st, n);
+            mglru_push_young(st, d, n);
+        }
+    }
+}
+
+/* Domain of pid and its node range */
+static inline int mglru_dom_of(repl_policy_t *pol, int pid, int *lo, int *hi)
+{
+    if (pol->frames)
+    {
+        *lo = 0;
+        *hi = pol->k * pol->m;
+        return 0;
+    }
+    *lo = pid * pol->m;
+    *hi = *lo + pol->m;
+    return pid;
+}
+
+static void mglru_count(repl_policy_t *pol, int pid)
+{
+    mglru_state_t *st = pol->priv;
+    int lo, hi;
+    int d = mglru_dom_of(pol, pid, &lo, &hi);
+    if (++st->dom[d].accesses >= st->interval)
+        mglru_age(st, d, lo, hi);
+}
+
+static void mglru_on_hit(repl_policy_t *pol, int pid, int page_no)
+{
+    mglru_state_t *st = pol->priv;
+    size_t n = (size_t)pid * pol->m + page_no;
+    st->accessed[n >> 6] |= 1ull << (n & 63);
+    mglru_count(pol, pid);
+}
+
+static void mglru_on_fault(repl_policy_t *pol, int pid, int page_no)
+{
+    mglru_state_t *st = pol->priv;
+    int n = pid * pol->m + page_no;
+    if (st->link[n].prev < 0)
+        mglru_push_young(st, pol->frames ? 0 : pid, n);
+    mglru_count(pol, pid);
+}
+
+static int mglru_pick(repl_policy_t *pol, int pid)
+{
+    mglru_state_t *st = pol->priv;
+    int lo, hi;
+    int d = mglru_dom_of(pol, pid, &lo, &hi);
+    mglru_dom_t *dom = &st->dom[d];
+    int empty_seen = 0;
+    for (;;)
+    {
+        if (mglru_empty(st, d, dom->min_seq))
+        {
+            if (dom->max_seq - dom->min_seq + 1 > MGLRU_MIN_GENS)
+            {
+                dom->min_seq++;
+                continue;
+            }
+            if (mglru_empty(st, d, dom->max_seq) || empty_seen++ > MGLRU_GENS)
+                return -1; /* no resident page */
+            mglru_age(st, d, lo, hi);
+            continue;
+        }
+        int n = st->link[mglru_head(st, d, dom->min_seq)].next;
+        if (!mglru_test_clear(st, n))
+            return n;
+        mglru_unlink(st, n);
+        mglru_push_young(st, d, n);
+    }
+}
+
+static int mglru_choose_victim(repl_policy_t *pol, int pid)
+{
+    int n = mglru_pick(pol, pid);
+    return n < 0 ? -1 : n - pid * pol->m;
+}
+
+static int mglru_choose_global(repl_policy_t *pol, int *pid_out)
+{
+    int n = mglru_pick(pol, 0);
+    if (n < 0)
+        return -1;
+    *pid_out = n / pol->m;
+    return n % pol->m;
+}
+
+static void mglru_on_evict(repl_policy_t *pol, int pid, int page_no)
+{
+    mglru_state_t *st = pol->priv;
+    int n = pid * pol->m + page_no;
+    if (st->link[n].prev < 0)
+        return;
+    mglru_unlink(st, n);
+    mglru_test_clear(st, n);
+}
+
+static void mglru_destroy(repl_policy_t *pol)
+{
+    mglru_state_t *st = pol->priv;
+    if (st)
+    {
+        free(st->link);
+        free(st->accessed);
+        free(st->dom);
+        free(st);
+    }
+}
+
+static int mglru_init(repl_policy_t *pol)
+{
+    mglru_state_t *st = calloc(1, sizeof(*st));
+    if (!st)
+        return -1;
+    pol->priv = st;
+    st->interval = MGLRU_INTERVAL;
+    if (pol->args)
+    {
+        char *end;
+        unsigned long v = strtoul(pol->args, &end, 10);
+        if (*pol->args < '0' || *pol->args > '9' || *end != '\0' || v == 0 || v > UINT32_MAX)
+            return -1;
+        st->interval = (unsigned)v;
+        pol->args = NULL;
+    }
+    st->nodes = pol->k * pol->m;
+    int ndom = pol->frames ? 1 : pol->k;
+    st->link = malloc(((size_t)st->nodes + (size_t)ndom * MGLRU_GENS) * sizeof(lru_link_t));
+    st->accessed = calloc(((size_t)st->nodes + 63) / 64, sizeof(uint64_t));
+    st->dom = calloc((size_t)ndom, sizeof(mglru_dom_t));
+    if (!st->link || !st->accessed || !st->dom)
+        return -1;
+    for (int n = 0; n < st->nodes; ++n)
+        st->link[n].prev = st->link[n].next = -1;
+    for (int h = st->nodes; h < st->nodes + ndom * MGLRU_GENS; ++h)
+        st->link[h].prev = st->link[h].next = h;
+    for (int d = 0; d < ndom; ++d)
+        st->dom[d].max_seq = MGLRU_MIN_GENS - 1;
+    return 0;
+}
+
+/* ---------- LIRS ---------- */
+/* Low inter-reference recency set. Pages with a short reuse distance are
+ * LIR and always resident; the rest are HIR, and only a few of them, in
+ * queue Q, hold frames. The recency stack S orders pages by last access;
+ * its bottom is always a LIR page ("pruning" drops HIR entries below the
+ * lowest LIR). An HIR page accessed again while still in S has a reuse
+ * distance shorter than the oldest LIR page, so it becomes LIR and the
+ * bottom LIR page drops to the tail of Q. Victims come from the front of
+ * Q; an evicted page still in S stays there as a ghost so its next fault
+ * can be recognized. A loop larger than memory therefore keeps a fixed
+ * LIR set resident instead of evicting every page before its reuse.
+ *
+ * Domains as for ARC. Until a domain first evicts, faulted pages become
+ * LIR; at the first eviction the bottom LIR pages are demoted until Q
+ * holds LIRS_HIR_PCT percent of the resident set (at least one page), the
+ * cache size c. Ghosts are capped at LIRS_GHOSTS * c: past that the one
+ * evicted longest ago leaves S, which bounds the stack at (1 + LIRS_GHOSTS)
+ * * c. Links for S, and for Q or the ghost list G, come from pools sized
+ * k*m at creation.
+ */
+
+#define LIRS_HIR_PCT 1
+#define LIRS_GHOSTS  2
+
+enum { LIRS_NONE, LIRS_LIR, LIRS_HIR, LIRS_GHOST };
+
+typedef struct {
+    int lir;             /* LIR pages */
+    int q;               /* resident HIR pages (in Q) */
+    int g;               /* ghosts (in G) */
+    int full;            /* has evicted: new pages start as HIR */
+} lirs_dom_t;
+
+typedef struct {
+    int nodes;           /* k*m; sentinels of domain d at nodes + 3d + {0: S, 1: Q, 2: G} */
+    lru_link_t *s;       /* S links (prev = -1: not in S); next of the sentinel is the bottom */
+    lru_link_t *q;       /* Q links for HIR pages, G links for ghosts */
+    uint8_t *state;      /* LIRS_* per node */
+    lirs_dom_t *dom;
+} lirs_state_t;
+
+static void lirs_unlink(lru_link_t *lk, int n)
+{
+    lk[lk[n].prev].next = lk[n].next;
+    lk[lk[n].next].prev = lk[n].prev;
+    lk[n].prev = lk[n].next = -1;
+}
+
+static void lirs_push(lru_link_t *lk, int h, int n)
+{
+    int top = lk[h].prev;
+    lk[n].prev = top;
+    lk[n].next = h;
+    lk[top].next = n;
+    lk[h].prev = n;
+}
+
+static inline int lirs_sentinel(const lirs_state_t *st, int d, int which)
+{
+    return st->nodes + 3 * d + which;
+}
+
+/* move n to the top of S */
+static void lirs_s_top(lirs_state_t *st, int d, int n)
+{
+    if (st->s[n].prev >= 0)
+        lirs_unlink(st->s, n);
+    lirs_push(st->s, lirs_sentinel(st, d, 0), n);
+}
+
+/* drop HIR entries from the bottom of S; ghosts leave G as well */
+static void lirs_prune(lirs_state_t *st, int d)
+{
+    int h = lirs_sentinel(st, d, 0);
+    for (int n = st->s[h].next; n != h && st->state[n] != LIRS_LIR; n = st->s[h].next)
+    {
+        lirs_unlink(st->s, n);
+        if (st->state[n] == LIRS_GHOST)
+        {
+            lirs_unlink(st->q, n);
+            st->state[n] = LIRS_NONE;
+            st->dom[d].g--;
+        }
+    }
+}
+
+/* the bottom LIR page of S becomes the newest resident HIR page (pruning
+ * first: while a domain has no LIR page, ghosts can sit below a new one) */
+static void lirs_demote(lirs_state_t *st, int d)
+{
+    lirs_prune(st, d);
+    int n = st->s[lirs_sentinel(st, d, 0)].next;
+    if (n >= st->nodes || st->state[n] != LIRS_LIR)
+        return;
+    lirs_unlink(st->s, n);
+    st->state[n] = LIRS_HIR;
+    lirs_push(st->q, lirs_sentinel(st, d, 1), n);
+    st->dom[d].lir--;
+    st->dom[d].q++;
+    lirs_prune(st, d);
+}
+
+/* a page in S was accessed again: it becomes LIR, the bottom LIR drops */
+static void lirs_promote(lirs_state_t *st, int d, int n)
+{
+    lirs_s_top(st, d, n);
+    st->state[n] = LIRS_LIR;
+    st->dom[d].lir++;
+    lirs_demote(st, d);
+}
+
+static inline int lirs_dom_of(repl_policy_t *pol, int pid)
+{
+    return pol->frames ? 0 : pid;
+}
+
+static void lirs_on_hit(repl_policy_t *pol, int pid, int page_no)
+{
+    lirs_state_t *st = pol->priv;
+    int d = lirs_dom_of(pol, pid);
+    int n = pid * pol->m + page_no;
+    if (st->state[n] == LIRS_LIR)
+    {
+        int bottom = st->s[lirs_sentinel(st, d, 0)].next == n;
+        lirs_s_top(st, d, n);
+        if (bottom)
+            lirs_prune(st, d);
+    }
+    else if (st->s[n].prev >= 0)
+    {
+        lirs_unlink(st->q, n);
+        st->dom[d].q--;
+        lirs_promote(st, d, n);
+    }
+    else
+    {
+        lirs_s_top(st, d, n);
+        lirs_unlink(st->q, n);
+        lirs_push(st->q, lirs_sentinel(st, d, 1), n);
+    }
+}
+
+static void lirs_on_fault(repl_policy_t *pol, int pid, int page_no)
+{
+    lirs_state_t *st = pol->priv;
+    int d = lirs_dom_of(pol, pid);
+    lirs_dom_t *dom = &st->dom[d];
+    int n = pid * pol->m + page_no;
+    if (st->state[n] == LIRS_GHOST)
+    {
+        lirs_unlink(st->q, n);
+        dom->g--;
+        lirs_promote(st, d, n);
+    }
+    else if (!dom->full)
+    {
+        lirs_s_top(st, d, n);
+        st->state[n] = LIRS_LIR;
+        dom->lir++;
+    }
+    else
+    {
+        lirs_s_top(st, d, n);
+        st->state[n] = LIRS_HIR;
+        lirs_push(st->q, lirs_sentinel(st, d, 1), n);
+        dom->q++;
+    }
+}
+
+static int lirs_pick(repl_policy_t *pol, int d)
+{
+    lirs_state_t *st = pol->priv;
+    lirs_dom_t *dom = &st->dom[d];
+    int c = dom->lir + dom->q;
+    int hir = c * LIRS_HIR_PCT / 100 > 1 ? c * LIRS_HIR_PCT / 100 : 1;
+    while (dom->q < hir && dom->lir > 0)
+        lirs_demote(st, d);
+    int h = lirs_sentinel(st, d, 1);
+    return st->q[h].next == h ? -1 : st->q[h].next;
+}
+
+static int lirs_choose_victim(repl_policy_t *pol, int pid)
+{
+    int n = lirs_pick(pol, pid);
+    return n < 0 ? -1 : n - pid * pol->m;
+}
+
+static int lirs_choose_global(repl_policy_t *pol, int *pid_out)
+{
+    int n = lirs_pick(pol, 0);
+    if (n < 0)
+        return -1;
+    *pid_out = n / pol->m;
+    return n % pol->m;
+}
+
+static void lirs_on_evict(repl_policy_t *pol, int pid, int page_no)
+{
+    lirs_state_t *st = pol->priv;
+    int d = lirs_dom_of(pol, pid);
+    lirs_dom_t *dom = &st->dom[d];
+    int n = pid * pol->m + page_no;
+    dom->full = 1;
+    if (st->state[n] == LIRS_LIR)
+    {
+        /* not a victim lirs_pick() gives, but keep the invariants */
+        lirs_unlink(st->s, n);
+        st->state[n] = LIRS_NONE;
+        dom->lir--;
+        lirs_prune(st, d);
+        return;
+    }
+    if (st->state[n] != LIRS_HIR)
+        return;
+    lirs_unlink(st->q, n);
+    dom->q--;
+    if (st->s[n].prev < 0)
+    {
+        st->state[n] = LIRS_NONE;
+        return;
+    }
+    st->state[n] = LIRS_GHOST;
+    int g = lirs_sentinel(st, d, 2);
+    lirs_push(st->q, g, n);
+    if (++dom->g > LIRS_GHOSTS * (dom->lir + dom->q + 1))
+    {
+        int old = st->q[g].next;
+        lirs_unlink(st->q, old);
+        lirs_unlink(st->s, old);
+        st->state[old] = LIRS_NONE;
+        dom->g--;
+    }
+}
+
+static void lirs_destroy(repl_policy_t *pol)
+{
+    lirs_state_t *st = pol->priv;
+    if (st)
+    {
+        free(st->s);
+        free(st->q);
+        free(st->state);
+        free(st->dom);
+        free(st);
+    }
+}
+
+static int lirs_init(repl_policy_t *pol)
+{
+    lirs_state_t *st = calloc(1, sizeof(*st));
+    if (!st)
+        return -1;
+    pol->priv = st;
+    st->nodes = pol->k * pol->m;
+    int ndom = pol->frames ? 1 : pol->k;
+    size_t links = (size_t)st->nodes + 3 * (size_t)ndom;
+    st->s = malloc(links * sizeof(lru_link_t));
+    st->q = malloc(links * sizeof(lru_link_t));
+    st->state = calloc((size_t)st->nodes, 1);
+    st->dom = calloc((size_t)ndom, sizeof(lirs_dom_t));
+    if (!st->s || !st->q || !st->state || !st->dom)
+        return -1;
+    for (int n = 0; n < st->nodes; ++n)
+        st->s[n].prev = st->s[n].next = st->q[n].prev = st->q[n].next = -1;
+    for (size_t h = st->nodes; h < links; ++h)
+    {
+        st->s[h].prev = st->s[h].next = (int)h;
+        st->q[h].prev = st->q[h].next = (int)h;
+    }
+    return 0;
+}
+
+/* ---------- Random ---------- */
+/* Resident pages of each process are kept in a dense array (swap-remove on
+ * eviction) so a uniform pick is O(1).
+ */
+
+typedef struct {
+    int *res;       /* k*m: resident page numbers, first cnt[pid] valid */
+    int *pos;       /* k*m: index of page in res, -1 if not resident */
+    int *cnt;       /* k */
+    unsigned rng;   /* xorshift32 state */
+} random_state_t;
+
+static unsigned xorshift32(unsigned *s)
+{
+    unsigned x = *s;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *s = x;
+}
+
+static void random_on_fault(repl_policy_t *pol, int pid, int page_no)
+{
+    random_state_t *st = pol->priv;
+    size_t base = (size_t)pid * pol->m;
+    if (st->pos[base + page_no] >= 0)
+        return;
+    st->pos[base + page_no] = st->cnt[pid];
+    st->res[base + st->cnt[pid]++] = page_no;
+}
+
+static int random_choose_victim(repl_policy_t *pol, int pid)
+{
+    random_state_t *st = pol->priv;
+    if (st->cnt[pid] == 0)
+        return -1;
+    return st->res[(size_t)pid * pol->m + xorshift32(&st->rng) % (unsigned)st->cnt[pid]];
+}
+
+/* all frames are in use when this is called: a uniform frame is a uniform page */
+static int random_choose_global(repl_policy_t *pol, int *pid_out)
+{
+    random_state_t *st = pol->priv;
+    const frame_entry_t *e = &pol->frames[xorshift32(&st->rng) % (unsigned)pol->f];
+    if (e->pid < 0)
+        return -1;
+    *pid_out = e->pid;
+    return e->page;
+}
+
+static void random_on_evict(repl_policy_t *pol, int pid, int page_no)
+{
+    random_state_t *st = pol->priv;
+    size_t base = (size_t)pid * pol->m;
+    int i = st->pos[base + page_no];
+    if (i < 0)
+        return;
+    int last = st->res[base + --st->cnt[pid]];
+    st->res[base + i] = last;
+    st->pos[base + last] = i;
+    st->pos[base + page_no] = -1;
+}
+
+static void random_destroy(repl_policy_t *pol)
+{
+    random_state_t *st = pol->priv;
+    if (st)
+    {
+        free(st->res);
+        free(st->pos);
+        free(st->cnt);
+        free(st);
+    }
+}
+
+static int random_init(repl_policy_t *pol)
+{
+    random_state_t *st = calloc(1, sizeof(*st));
+    if (!st)
+        return -1;
+    pol->priv = st;
+    size_t n = (size_t)pol->k * pol->m;
+    st->res = malloc(n * sizeof(int));
+    st->pos = malloc(n * sizeof(int));
+    st->cnt = calloc((size_t)pol->k, sizeof(int));
+    st->rng = 2463534242u;
+    if (!st->res || !st->pos || !st->cnt)
+        return -1;
+    for (size_t i = 0; i < n; ++i)
+        st->pos[i] = -1;
+    return 0;
+}
+
+/* ---------- OPT (Belady) ---------- */
+/* Offline optimum over the reference file: evict the resident page whose
+ * next use lies furthest in the future. Each process's next-use index is
+ * built once (refs_next_use, O(n)); resident pages sit in an indexed
+ * max-heap keyed by next use, so a hit is a key update and an eviction
+ * a heap pop, both O(log f). A page mapped ahead of its reference (on_map)
+ * is keyed by its next reference after the cursor, which is tracked per
+ * page as the cursor moves.
+ */
+
+typedef struct {
+    const refs_t *refs;
+    uint32_t **next;    /* k next-use indices */
+    uint32_t *cursor;   /* k: position of the next expected reference */
+    uint32_t *upcoming; /* k*m: first reference of a page at or after the cursor */
+    int *heap;          /* k*m: per-process heap of page numbers */
+    int *hpos;          /* k*m: heap slot of a page, -1 if not resident */
+    uint32_t *key;      /* k*m: next use of a resident page */
+    int *hsize;         /* k */
+    int warned;         /* a reference out of step was reported */
+} opt_state_t;
+
+static void opt_swap(int *heap, int *hpos, int a, int b)
+{
+    int pa = heap[a], pb = heap[b];
+    heap[a] = pb;
+    heap[b] = pa;
+    hpos[pb] = a;
+    hpos[pa] = b;
+}
+
+static void opt_sift(opt_state_t *st, int pid, int m, int i)
+{
+    int *heap = st->heap + (size_t)pid * m;
+    int *hpos = st->hpos + (size_t)pid * m;
+    const uint32_t *key = st->key + (size_t)pid * m;
+    int n = st->hsize[pid];
+    while (i > 0 && key[heap[(i - 1) / 2]] < key[heap[i]])
+    {
+        opt_swap(heap, hpos, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+    for (;;)
+    {
+        int l = 2 * i + 1, r = l + 1, big = i;
+        if (l < n && key[heap[l]] > key[heap[big]])
+            big = l;
+        if (r < n && key[heap[r]] > key[heap[big]])
+            big = r;
+        if (big == i)
+            break;
+        opt_swap(heap, hpos, i, big);
+        i = big;
+    }
+}
+
+/* Move pid's cursor past reference i */
+static void opt_pass(opt_state_t *st, int pid, int m, uint32_t i)
+{
+    int32_t page = ref_page(refs_of(st->refs, pid)[i]);
+    if (page >= 0 && page < m)
+        st->upcoming[(size_t)pid * m + page] = st->next[pid][i];
+    st->cursor[pid] = i + 1;
+}
+
+/* Consume pid's next reference, which must be to page_no, and return its
+ * next use. A fault that finds neither a free frame nor a page of pid to
+ * evict fails and is never reported; that only happens while pid holds no
+ * page, so only then are the references before page_no's skipped. Any
+ * other mismatch is a caller bug (a page reported that the process did not
+ * reference next): it is reported once, the cursor stays, and the page's
+ * next use is taken from there.
+ */
+static uint32_t opt_advance(opt_state_t *st, int pid, int m, int page_no)
+{
+    const int32_t *refs = refs_of(st->refs, pid);
+    uint32_t n = st->refs->len[pid];
+    while (st->hsize[pid] == 0 && st->cursor[pid] < n && ref_page(refs[st->cursor[pid]]) != page_no)
+        opt_pass(st, pid, m, st->cursor[pid]);
+    uint32_t i = st->cursor[pid];
+    if (i < n && ref_page(refs[i]) == page_no)
+    {
+        opt_pass(st, pid, m, i);
+        return st->next[pid][i];
+    }
+    if (!st->warned)
+    {
+        fprintf(stderr, "[POLICY] opt: p_ind=%d page=%d is not its next reference, victims may be wrong\n",
+                pid, page_no);
+        st->warned = 1;
+    }
+    return st->upcoming[(size_t)pid * m + page_no];
+}
+
+/* Key page_no by its next use and (re)place it in pid's heap */
+static void opt_place(repl_policy_t *pol, int pid, int page_no, uint32_t key)
+{
+    opt_state_t *st = pol->priv;
+    size_t base = (size_t)pid * pol->m;
+    st->key[base + page_no] = key;
+    int slot = st->hpos[base + page_no];
+    if (slot < 0)
+    {
+        slot = st->hsize[pid]++;
+        st->heap[base + slot] = page_no;
+        st->hpos[base + page_no] = slot;
+    }
+    opt_sift(st, pid, pol->m, slot);
+}
+
+static void opt_on_access(repl_policy_t *pol, int pid, int page_no)
+{
+    opt_place(pol, pid, page_no, opt_advance(pol->priv, pid, pol->m, page_no));
+}
+
+/* Mapped ahead: the cursor stays where the process is */
+static void opt_on_map(repl_policy_t *pol, int pid, int page_no)
+{
+    opt_state_t *st = pol->priv;
+    opt_place(pol, pid, page_no, st->upcoming[(size_t)pid * pol->m + page_no]);
+}
+
+static int opt_choose_victim(repl_policy_t *pol, int pid)
+{
+    opt_state_t *st = pol->priv;
+    return st->hsize[pid] ? st->heap[(size_t)pid * pol->m] : -1;
+}
+
+/* Furthest next use over all processes. Processes run one after another in
+ * p_ind order, the order of the reference file, so a process-local index i
+ * happens at global time off[pid] + i. Heap tops are the per-process maxima.
+ */
+static int opt_choose_global(repl_policy_t *pol, int *pid_out)
+{
+    opt_state_t *st = pol->priv;
+    int victim = -1;
+    uint64_t furthest = 0;
+    for (int pid = 0; pid < pol->k; ++pid)
+    {
+        if (!st->hsize[pid])
+            continue;
+        int page = st->heap[(size_t)pid * pol->m];
+        uint32_t key = st->key[(size_t)pid * pol->m + page];
+        uint64_t when = key == REFS_NEVER ? UINT64_MAX : st->refs->off[pid] + key;
+        if (victim < 0 || when > furthest)
+        {
+            victim = page;
+            furthest = when;
+            *pid_out = pid;
+        }
+    }
+    return victim;
+}
+
+static void opt_on_evict(repl_policy_t *pol, int pid, int page_no)
+{
+    opt_state_t *st = pol->priv;
+    size_t base = (size_t)pid * pol->m;
+    int slot = st->hpos[base + page_no];
+    if (slot < 0)
+        return;
+    int last = --st->hsize[pid];
+    if (slot != last)
+    {
+        opt_swap(st->heap + base, st->hpos + base, slot, last);
+        st->hpos[base + page_no] = -1;
+        opt_sift(st, pid, pol->m, slot);
+    }
+    st->hpos[base + page_no] = -1;
+}
+
+static void opt_destroy(repl_policy_t *pol)
+{
+    opt_state_t *st = pol->priv;
+    if (!st)
+        return;
+    for (int i = 0; st->next && i < pol->k; ++i)
+        free(st->next[i]);
+    free(st->next);
+    free(st->cursor);
+    free(st->upcoming);
+    free(st->heap);
+    free(st->hpos);
+    free(st->key);
+    free(st->hsize);
+    free(st);
+}
+
+static int opt_init(repl_policy_t *pol)
+{
+    const refs_t *refs = pol->refs;
+    if (!refs || refs->k != pol->k)
+    {
+        fprintf(stderr, "[POLICY] opt needs the reference file of all %d processes\n", pol->k);
+        return -1;
+    }
+    opt_state_t *st = calloc(1, sizeof(*st));
+    if (!st)
+        return -1;
+    pol->priv = st;
+    st->refs = refs;
+    size_t n = (size_t)pol->k * pol->m;
+    st->next = calloc((size_t)pol->k, sizeof(uint32_t *));
+    st->cursor = calloc((size_t)pol->k, sizeof(uint32_t));
+    st->upcoming = malloc(n * sizeof(uint32_t));
+    st->heap = malloc(n * sizeof(int));
+    st->hpos = malloc(n * sizeof(int));
+    st->key = malloc(n * sizeof(uint32_t));
+    st->hsize = calloc((size_t)pol->k, sizeof(int));
+    uint32_t *scratch = malloc((size_t)(refs->m > pol->m ? refs->m : pol->m) * sizeof(uint32_t));
+    int rc = (st->next && st->cursor && st->upcoming && st->heap && st->hpos && st->key && st->hsize && scratch) ? 0 : -1;
+    for (size_t i = 0; rc == 0 && i < n; ++i)
+    {
+        st->hpos[i] = -1;
+        st->upcoming[i] = REFS_NEVER;
+    }
+    for (int pid = 0; rc == 0 && pid < pol->k; ++pid)
+    {
+        st->next[pid] = malloc(((size_t)refs->len[pid] + 1) * sizeof(uint32_t));
+        if (!st->next[pid] || refs_next_use(refs, pid, st->next[pid], scratch) != 0)
+            rc = -1;
+        const int32_t *r = refs_of(refs, pid);
+        for (uint32_t i = refs->len[pid]; rc == 0 && i-- > 0;)
+            if (ref_page(r[i]) >= 0 && ref_page(r[i]) < pol->m)
+                st->upcoming[(size_t)pid * pol->m + ref_page(r[i])] = i;
+    }
+    free(scratch);
+    return rc;
+}
+
+/* ---------- Registry ---------- */
+
+typedef struct {
+    const char *name;
+    void (*on_hit)(repl_policy_t *, int, int);
+    void (*on_fault)(repl_policy_t *, int, int);
+    int  (*choose_victim)(repl_policy_t *, int);
+    int  (*choose_global)(repl_policy_t *, int *);
+    void (*on_evict)(repl_policy_t *, int, int);
+    void (*on_map)(repl_policy_t *, int, int);
+    void (*destroy)(repl_policy_t *);
+    int  (*init)(repl_policy_t *);
+    int uses_ts;
+} policy_desc_t;
+
+static const policy_desc_t g_policies[] = {
+    {"fifo",     NULL,            NULL,            fifo_choose_victim,     frame_list_victim,
+     NULL,            NULL,            NULL,           NULL,        0},
+    {"lru",      lru_on_hit,      NULL,            lru_choose_victim,      frame_list_victim,
+     NULL,            NULL,            NULL,           NULL,        1},
+    {"lru-scan", NULL,            NULL,            lru_scan_choose_victim, lru_scan_choose_global,
+     NULL,            NULL,            NULL,           NULL,        1},
+    {"clock",    clock_on_hit,    clock_on_fault,  clock_choose_victim,    clock_choose_global,
+     clock_on_evict,  NULL,            clock_destroy,  clock_init,  0},
+    {"esc",      clock_on_hit,    clock_on_fault,  clock_choose_victim,    clock_choose_global,
+     clock_on_evict,  NULL,            clock_destroy,  esc_init,    0},
+    {"gclock",   clock_on_hit,    clock_on_fault,  clock_choose_victim,    clock_choose_global,
+     clock_on_evict,  NULL,            clock_destroy,  gclock_init, 0},
+    {"arc",      arc_on_hit,      arc_on_fault,    arc_choose_victim,      arc_choose_global,
+     arc_on_evict,    NULL,            arc_destroy,    arc_init,    0},
+    {"car",      car_on_hit,      arc_on_fault,    arc_choose_victim,      arc_choose_global,
+     arc_on_evict,    NULL,            arc_destroy,    car_init,    0},
+    {"mglru",    mglru_on_hit,    mglru_on_fault,  mglru_choose_victim,    mglru_choose_global,
+     mglru_on_evict,  NULL,            mglru_destroy,  mglru_init,  0},
+    {"lirs",     lirs_on_hit,     lirs_on_fault,   lirs_choose_victim,     lirs_choose_global,
+     lirs_on_evict,   NULL,            lirs_destroy,   lirs_init,   0},
+    {"random",   NULL,            random_on_fault, random_choose_victim,   random_choose_global,
+     random_on_evict, NULL,            random_destroy, random_init, 0},
+    {"opt",      opt_on_access,   opt_on_access,   opt_choose_victim,      opt_choose_global,
+     opt_on_evict,    opt_on_map,      opt_destroy,    opt_init,    0},
+};
+
+repl_policy_t *policy_create(const char *name, void *sm1_base, frame_entry_t *frames,
+                             int k, int m, int f, const refs_t *refs)
+{
+    if (!name || !sm1_base || k <= 0 || m <= 0 || f <= 0)
+        return NULL;
+    size_t name_len = strcspn(name, ":");
+    const char *args = name[name_len] == ':' ? name + name_len + 1 : NULL;
+    for (size_t i = 0; i < sizeof(g_policies) / sizeof(g_policies[0]); ++i)
+    {
+        const policy_desc_t *d = &g_policies[i];
+        if (strlen(d->name) != name_len || strncmp(d->name, name, name_len) != 0)
+            continue;
+        if (frames && !d->choose_global)
+            return NULL;
+        repl_policy_t *pol = calloc(1, sizeof(*pol));
+        if (!pol)
+            return NULL;
+        pol->name = d->name;
+        pol->on_hit = d->on_hit;
+        pol->on_fault = d->on_fault;
+        pol->choose_victim = d->choose_victim;
+        pol->choose_global = d->choose_global;
+        pol->on_evict = d->on_evict;
+        pol->on_map = d->on_map ? d->on_map : d->on_fault;
+        pol->destroy = d->destroy;
+        pol->uses_ts = d->uses_ts;
+        pol->sm1_base = sm1_base;
+        pol->frames = frames;
+        pol->k = k;
+        pol->m = m;
+        pol->f = f;
+        pol->refs = refs;
+        pol->args = args;
+        /* init clears args once it has parsed them: a suffix left over
+         * (or given to a policy without init) is an error */
+        if ((d->init && d->init(pol) != 0) || pol->args)
+        {
+            policy_destroy(pol);
+            return NULL;
+        }
+        return pol;
+    }
+    return NULL;
+}
+
+void policy_destroy(repl_policy_t *pol)
+{
+    if (!pol)
+        return;
+    if (pol->destroy)
+        pol->destroy(pol);
+    free(pol);
+}
+
+const char *policy_names(void)
+{
+    return "fifo lru lru-scan clock esc gclock arc car mglru[:interval] lirs random opt";
+}
@@ -0,0 +1,93 @@
+/* prefetch.c
+ * Stride detector and -F parsing (see prefetch.h).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "prefetch.h"
+
+int pf_parse(const char *spec, pf_cfg_t *out)
+{
+    pf_cfg_t c = {0, 0};
+    if (strcmp(spec, "none") == 0)
+    {
+        *out = c;
+        return 0;
+    }
+    char *end;
+    long v = strtol(spec, &end, 10);
+    if (end == spec || v < 1 || v > PF_MAX_DEPTH)
+        return -1;
+    c.depth = (int)v;
+    if (*end == ',')
+    {
+        if (strcmp(end + 1, "evict") == 0)
+            c.evict = 1;
+        else if (strcmp(end + 1, "free") != 0)
+            return -1;
+    }
+    else if (*end != '\0')
+        return -1;
+    *out = c;
+    return 0;
+}
+
+int fa_parse(const char *spec, fa_cfg_t *out)
+{
+    fa_cfg_t c = {0, 0};
+    if (strcmp(spec, "none") == 0)
+    {
+        *out = c;
+        return 0;
+    }
+    char *end;
+    long v = strtol(spec, &end, 10);
+    if (end == spec || v < 2 || v > FA_MAX_PAGES)
+        return -1;
+    c.pages = (int)v;
+    if (*end == ',')
+    {
+        const char *w = end + 1;
+        v = strtol(w, &end, 10);
+        if (end == w || *end != '\0' || v < 0 || v > INT32_MAX)
+            return -1;
+        c.watermark = (int)v;
+    }
+    else if (*end != '\0')
+        return -1;
+    *out = c;
+    return 0;
+}
+
+pf_t *pf_create(const pf_cfg_t *cfg, int k)
+{
+    if (cfg->depth <= 0 || cfg->depth > PF_MAX_DEPTH || k <= 0)
+        return NULL;
+    pf_t *pf = calloc(1, sizeof(*pf));
+    if (!pf)
+        return NULL;
+    pf->cfg = *cfg;
+    pf->k = k;
+    pf->last = malloc((size_t)k * sizeof(*pf->last));
+    pf->stride = calloc((size_t)k, sizeof(*pf->stride));
+    pf->run = calloc((size_t)k, sizeof(*pf->run));
+    if (!pf->last || !pf->stride || !pf->run)
+    {
+        pf_destroy(pf);
+        return NULL;
+    }
+    for (int pid = 0; pid < k; ++pid)
+        pf->last[pid] = -1;
+    return pf;
+}
+
+void pf_destroy(pf_t *pf)
+{
+    if (!pf)
+        return;
+    free(pf->last);
+    free(pf->stride);
+    free(pf->run);
+    free(pf);
+}
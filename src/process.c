@@ -5,7 +5,7 @@
  *  1. Enqueue itself into ready queue (MQ1).
  *  2. Wait until scheduler wakes it up.
  *  3. Iterate over its reference string:
- *      - send request to MMU (MQ3)
+ *      - send request to MMU (MQ3), one reference or a batch of up to 'batch'
  *      - wait for MMU reply
  *      - if hit/fault resolved: continue
  *      - if invalid (-2): terminate
@@ -18,16 +18,13 @@
 #include <unistd.h>
 #include <sys/ipc.h>
 #include <signal.h>
+#include <errno.h>
 #include "ipc.h"
 #include "types.h"
 #include "process.h"
 
-#define LOG(fmt, ...)                                         \
-    do                                                        \
-    {                                                         \
-        fprintf(stdout, "[PROCESS] " fmt "\n", ##__VA_ARGS__); \
-        fflush(stdout);                                       \
-    } while (0)
+#define TRACE_TAG "PROCESS"
+#include "trace.h"
 
 // sig_atomic_t is a special integer type defined in <signal.h>.
 // It is guaranteed to be read/written atomically
@@ -45,11 +42,82 @@ static void sched_handler(int signo)
     scheduled = 1;
 }
 
-int process_run(int mq_ready_key, int mq_proc_key, int ref_len, int *ref_str, int p_ind)
-{   
+/* Wait for the MMU's reply. The SIGCONT of a resume (the MMU's load control,
+ * via the scheduler) interrupts the wait; keep waiting. */
+static ssize_t recv_reply(ipc_chan_t *ch_proc, void *reply, size_t bytes, long mtype)
+{
+    ssize_t r;
+    while ((r = ipc_chan_recv(ch_proc, reply, bytes, mtype)) == -1 && errno == EINTR)
+        ;
+    return r;
+}
+
+/* Batched variant of step 3 + 4: ship up to 'batch' references per message,
+ * with the end marker riding in the last batch.
+ */
+static int run_batched(ipc_chan_t *ch_proc, int ref_len, const int *ref_str, int p_ind, int m_req,
+                       int batch)
+{
+    static ipc_batch_msg_t req, reply;
     int pid = getpid();
+    int i = 0;
+    int ended = 0;
 
-    LOG("[process_run()] pid: %d, mq_ready_key: %d, mq_proc_key: %d, ref_len: %d", pid, mq_ready_key, mq_proc_key, ref_len);
+    if (batch > IPC_BATCH_MAX)
+        batch = IPC_BATCH_MAX;
+
+    while (!ended)
+    {
+        int n = 0;
+        while (n < batch && i < ref_len)
+            req.vals[n++] = ref_str[i++];
+        if (n < batch)
+        {
+            req.vals[n++] = MMU_END_OF_REF;
+            ended = 1;
+        }
+        req.mtype = MSGTYPE_PROC_BATCH;
+        req.pid = p_ind;
+        req.count = n;
+        req.m_req = m_req;
+        if (ipc_chan_send(ch_proc, 0, &req, ipc_batch_bytes(&req)) == -1)
+            return 1;
+
+        if (recv_reply(ch_proc, &reply, sizeof(reply), MSGTYPE_MMU_BATCH) == -1)
+        {
+            perror("recv mmu batch reply");
+            return 1;
+        }
+
+        for (int j = 0; j < reply.count; j++)
+        {
+            if (reply.status[j] == BATCH_ST_INVALID)
+            {
+                printf("[Process %d] INVALID page=%d -> terminating\n", pid, req.vals[j]);
+                /* the MMU stopped here; still send it an end marker */
+                i = ref_len;
+                ended = 0;
+                break;
+            }
+            if (reply.vals[j] >= 0)
+            {
+                TRACE_EV(TRACE_EV_PROC_REF, 0, pid, req.vals[j], reply.vals[j], 0);
+                LOG_DEBUG("pid %d page=%d -> frame=%d", pid, req.vals[j], reply.vals[j]);
+            }
+        }
+    }
+
+    printf("[Process %d] finished reference string\n", pid);
+    return 0;
+}
+
+int process_run(int mq_ready_key, int mq_proc_key, int ref_len, int *ref_str, int p_ind, int m_req,
+                int batch, ipc_transport_t transport)
+{
+    int pid = getpid();
+    trace_open("process", p_ind);
+
+    LOG("[process_run()] pid: %d, mq_ready_key: %d, mq_proc_key: %d, ref_len: %d, m_req: %d", pid, mq_ready_key, mq_proc_key, ref_len, m_req);
 
     /* Connect to ready queue and proc<->MMU queue */
     ipc_mqid_t mq_ready = ipc_create_mq((key_t)mq_ready_key, 0666);
@@ -58,10 +126,10 @@ int process_run(int mq_ready_key, int mq_proc_key, int ref_len, int *ref_str, in
         perror("msgget(mq_ready)");
         return 1;
     }
-    ipc_mqid_t mq_proc = ipc_create_mq((key_t)mq_proc_key, 0666);
-    if (mq_proc == -1)
+    ipc_chan_t ch_proc; /* peer p_ind of the MMU's channel */
+    if (ipc_chan_open(&ch_proc, transport, (key_t)mq_proc_key, p_ind) == -1)
     {
-        perror("msgget(mq_proc)");
+        perror("open(mq_proc)");
         return 1;
     }
 
@@ -74,6 +142,7 @@ int process_run(int mq_ready_key, int mq_proc_key, int ref_len, int *ref_str, in
     ipc_msg_t reg = {0};
     reg.mtype = MSGTYPE_PROC_REQ; /* use proc id as type if you want FCFS fairness */
     reg.ints[0] = pid;
+    reg.ints[1] = p_ind; /* lets the scheduler act on the MMU's load-control notes */
     if (ipc_send_msg(mq_ready, &reg) == -1)
     {
         fprintf(stderr, "Process %d failed to enqueue ready\n", pid);
@@ -86,6 +155,13 @@ int process_run(int mq_ready_key, int mq_proc_key, int ref_len, int *ref_str, in
     scheduled = 0;
     LOG("Starting process %d", pid);
 
+    if (batch > 0)
+    {
+        int rc = run_batched(&ch_proc, ref_len, ref_str, p_ind, m_req, batch);
+        ipc_chan_close(&ch_proc);
+        return rc;
+    }
+
     /* Step 3: process reference string */
     for (int i = 0; i < ref_len; i++)
     {
@@ -96,28 +172,29 @@ int process_run(int mq_ready_key, int mq_proc_key, int ref_len, int *ref_str, in
         req.mtype = MSGTYPE_PROC_REQ;
         req.ints[0] = p_ind;
         req.ints[1] = page_no;
-        req.ints[2] = ref_len; /* simplification; ideally pass m_req_for_pid */
-        LOG("Sending request");
-        ipc_send_msg(mq_proc, &req);
+        req.ints[2] = m_req;
+        LOG_DEBUG("Sending request");
+        ipc_chan_send(&ch_proc, 0, &req, sizeof(req));
 
         // wait for reply
         ipc_msg_t reply = {0};
-        if (ipc_recv_msg(mq_proc, &reply, MSGTYPE_MMU_REPLY) == -1)
+        if (recv_reply(&ch_proc, &reply, sizeof(reply), MSGTYPE_MMU_REPLY) == -1)
         {
             perror("recv mmu reply");
             break;
         }
-        LOG("Received reply");
+        LOG_DEBUG("Received reply");
 
         int result = reply.ints[1];
         if (result >= 0)
         {
-            printf("[Process %d] page=%d -> frame=%d\n", pid, page_no, result);
+            TRACE_EV(TRACE_EV_PROC_REF, 0, pid, page_no, result, 0);
+            LOG_DEBUG("pid %d page=%d -> frame=%d", pid, page_no, result);
         }
         else if (result == MMU_INVALID_PAGE)
         {
             printf("[Process %d] INVALID page=%d -> terminating\n", pid, page_no);
-            return 0;
+            break; /* still send the end marker so the MMU can retire us */
         }
     }
 
@@ -125,10 +202,15 @@ int process_run(int mq_ready_key, int mq_proc_key, int ref_len, int *ref_str, in
     
     ipc_msg_t end = {0};
     end.mtype = MSGTYPE_PROC_REQ;
-    end.ints[0] = pid;
+    end.ints[0] = p_ind;
     end.ints[1] = MMU_END_OF_REF;
     end.ints[2] = -1;   //dummy value
-    ipc_send_msg(mq_proc, &end);
+    ipc_chan_send(&ch_proc, 0, &end, sizeof(end));
+
+    /* consume the MMU's end-of-ref ack so it is not mistaken for the next process's reply */
+    ipc_msg_t ack = {0};
+    recv_reply(&ch_proc, &ack, sizeof(ack), MSGTYPE_MMU_REPLY);
+    ipc_chan_close(&ch_proc);
 
     printf("[Process %d] finished reference string\n", pid);
     return 0;
@@ -136,15 +218,29 @@ int process_run(int mq_ready_key, int mq_proc_key, int ref_len, int *ref_str, in
 
 /* Standalone binary entry */
 int main(int argc, char **argv) {
-    if (argc < 5) {
+    int batch = 0;
+    ipc_transport_t transport = IPC_TRANSPORT_MQ;
+    int bad_opt = 0;
+    int opt;
+    /* '+' stops at the first positional so negative refs are not taken as options */
+    while ((opt = getopt(argc, argv, "+b:x:")) != -1) {
+        if (opt == 'b')
+            batch = atoi(optarg);
+        else if (opt != 'x' || ipc_transport_parse(optarg, &transport) != 0)
+            bad_opt = 1;
+    }
+    argc -= optind;
+    argv += optind;
+    if (bad_opt || argc < 5) {
         fprintf(stderr,
-            "Usage: %s <mq_ready_key> <mq_proc_key> <ref_len> <p_ind> <refs...>\n", argv[0]);
+            "Usage: process [-b batch] [-x mq|shm] <mq_ready_key> <mq_proc_key> <ref_len> <p_ind> <m_req> <refs...>\n");
         return 1;
     }
-    int mq_ready_key = atoi(argv[1]);
-    int mq_proc_key  = atoi(argv[2]);
-    int ref_len      = atoi(argv[3]);
-    int p_ind        = atoi(argv[4]);
+    int mq_ready_key = atoi(argv[0]);
+    int mq_proc_key  = atoi(argv[1]);
+    int ref_len      = atoi(argv[2]);
+    int p_ind        = atoi(argv[3]);
+    int m_req        = atoi(argv[4]);
 
     if (argc < 5 + ref_len) {
         fprintf(stderr, "Not enough references given\n");
@@ -155,7 +251,7 @@ int main(int argc, char **argv) {
         refs[i] = atoi(argv[5 + i]);
     }
 
-    int rc = process_run(mq_ready_key, mq_proc_key, ref_len, refs, p_ind);
+    int rc = process_run(mq_ready_key, mq_proc_key, ref_len, refs, p_ind, m_req, batch, transport);
     free(refs);
     return rc;
 }
\ No newline at end of file
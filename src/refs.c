@@ -0,0 +1,137 @@
+/* refs.c
+ * Reading/writing reference-string files and building next-use indices.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "refs.h"
+
+int refs_write(const char *path, int k, int m, int *const refs[], const uint32_t lens[])
+{
+    if (!path || k <= 0 || m <= 0 || !refs || !lens)
+        return -1;
+    FILE *fp = fopen(path, "wb");
+    if (!fp)
+    {
+        perror("fopen(refs)");
+        return -1;
+    }
+    uint32_t magic = REFS_MAGIC;
+    int32_t hdr[2] = {k, m};
+    int ok = fwrite(&magic, sizeof(magic), 1, fp) == 1 &&
+             fwrite(hdr, sizeof(hdr), 1, fp) == 1 &&
+             fwrite(lens, sizeof(uint32_t), (size_t)k, fp) == (size_t)k;
+    for (int i = 0; ok && i < k; ++i)
+    {
+        /* int and int32_t agree on every platform this simulator targets */
+        ok = fwrite(refs[i], sizeof(int32_t), lens[i], fp) == lens[i];
+    }
+    if (fclose(fp) != 0)
+        ok = 0;
+    if (!ok)
+    {
+        perror("write(refs)");
+        return -1;
+    }
+    return 0;
+}
+
+int refs_load(const char *path, refs_t *out)
+{
+    if (!path || !out)
+        return -1;
+    memset(out, 0, sizeof(*out));
+    int fd = open(path, O_RDONLY);
+    if (fd == -1)
+    {
+        perror("open(refs)");
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size < (off_t)(3 * sizeof(int32_t)))
+    {
+        fprintf(stderr, "refs_load: %s too short\n", path);
+        close(fd);
+        return -1;
+    }
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        perror("mmap(refs)");
+        return -1;
+    }
+    out->map = map;
+    out->map_bytes = (size_t)st.st_size;
+
+    const uint32_t *hdr = map;
+    out->k = (int)hdr[1];
+    out->m = (int)hdr[2];
+    size_t hdr_bytes = 3 * sizeof(uint32_t) + (size_t)(out->k > 0 ? out->k : 0) * sizeof(uint32_t);
+    if (hdr[0] != REFS_MAGIC || out->k <= 0 || out->m <= 0 || hdr_bytes > out->map_bytes)
+    {
+        fprintf(stderr, "refs_load: %s is not a reference file\n", path);
+        refs_free(out);
+        return -1;
+    }
+    out->len = hdr + 3;
+    out->refs = (const int32_t *)((const char *)map + hdr_bytes);
+    out->off = malloc((size_t)out->k * sizeof(uint64_t));
+    if (!out->off)
+    {
+        refs_free(out);
+        return -1;
+    }
+    uint64_t total = 0;
+    for (int i = 0; i < out->k; ++i)
+    {
+        out->off[i] = total;
+        total += out->len[i];
+    }
+    if (hdr_bytes + total * sizeof(int32_t) > out->map_bytes)
+    {
+        fprintf(stderr, "refs_load: %s is truncated\n", path);
+        refs_free(out);
+        return -1;
+    }
+    return 0;
+}
+
+void refs_free(refs_t *r)
+{
+    if (!r)
+        return;
+    if (r->map)
+        munmap(r->map, r->map_bytes);
+    free(r->off);
+    memset(r, 0, sizeof(*r));
+}
+
+int refs_next_use(const refs_t *r, int pid, uint32_t *next, uint32_t *scratch)
+{
+    if (!r || pid < 0 || pid >= r->k || !next || !scratch)
+        return -1;
+    const int32_t *refs = refs_of(r, pid);
+    uint32_t n = r->len[pid];
+    for (int p = 0; p < r->m; ++p)
+        scratch[p] = REFS_NEVER;
+    /* walking backwards, scratch[p] is the closest later use of page p */
+    for (uint32_t i = n; i-- > 0;)
+    {
+        int32_t p = ref_page(refs[i]);
+        if (p < 0 || p >= r->m)
+        {
+            next[i] = REFS_NEVER;
+            continue;
+        }
+        next[i] = scratch[p];
+        scratch[p] = i;
+    }
+    return 0;
+}
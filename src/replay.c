@@ -0,0 +1,323 @@
+/* replay.c
+ * vms-replay: apply the MMU's resolution logic to a reference file in one
+ * process, with no fork/exec, message queues or signals.
+ *
+ * Processes are replayed one after another in p_ind order, which is the
+ * order the FCFS scheduler runs them in the full simulation; a process stops
+ * at its first illegal reference, as it does there. A reference is legal
+ * below the file's m, the m_req master hands every process (process.h), so
+ * a replay and the full simulation of the same file give the same counts.
+ * Statistics use the same "[MMU] stats" lines as the mmu binary.
+ *
+ * With -q the processes take turns instead, round robin in p_ind order,
+ * 'quantum' references at a time, so their working sets compete for the
+ * frames. Processes that load control (-L) suspends lose their turns until
+ * it resumes them. (opt with -g still assumes FCFS order.)
+ *
+ * With -A (virtual pacing only) a fault ends the process's turn: it waits
+ * for its page while the next process runs, and the clock idles only when
+ * every process is waiting. Without -q a process runs until it faults.
+ *
+ * Usage:
+ *   vms-replay [-p policy[,policy...]] [-g] [-q quantum] [-A] [-L loadctl] [-F prefetch] [-R around] [-D swap] [-I iosched] [-t trace_dir] [-P pace] [-T tlb] <refs_file> <f>
+ *   vms-replay -m <csv|-> [-S cap] <refs_file>
+ *
+ *   -p : one or more policies (comma-separated) replayed back to back,
+ *        e.g. -p lru,opt to see how far LRU is from the optimum
+ *   -g : global replacement for every policy (default local)
+ *   -q : round-robin time slice in references (default 0: FCFS)
+ *   -A : asynchronous faults, other processes run during a fault's I/O
+ *   -L : load control, none | ws[:tau] | pff[:lo,hi] (see loadctl.h)
+ *   -F : stride prefetching on faults, none | depth[,free|evict] (see prefetch.h)
+ *   -R : fault-around, none | pages[,watermark] (see prefetch.h)
+ *   -D : swap device for dirty pages,
+ *        none | swap[:read_ns,write_ns,slots,cluster,readahead] (see swap.h);
+ *        write references carry REFS_WRITE (refs.h)
+ *   -I : disk under the swap device (needs -D), none |
+ *        fifo|sstf|scan|deadline[:seek_min,seek_max[,read_expire,write_expire]]
+ *        (see disk.h); compare schedulers under each policy with -p
+ *   -t : record every access to trace_dir/replay.0.trace (see trace.h);
+ *        policies are separated by 'run' events
+ *   -P : pacing (pace.h); virtual adds simulated time and effective access
+ *        time to the stats, real waits before every reference
+ *   -T : put a TLB model in front of the page tables (tlb.h)
+ *   -m : no replay; write the LRU fault count for every frame count, per
+ *        process and global, to csv (- = stdout), see mrc.h
+ *   -S : with -m, estimate the curves by SHARDS sampling, tracking at most
+ *        cap pages (constant memory for any trace length)
+ *   f  : number of physical frames
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#include "types.h"
+#include "memory.h"
+#include "mmu_core.h"
+#include "refs.h"
+#include "pace.h"
+#include "mrc.h"
+
+#define TRACE_TAG "REPLAY"
+#include "trace.h"
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Replay every process of 'refs' under one policy. Returns 0 on success. */
+static int replay_one(const refs_t *refs, int f, const char *policy, int global, int run,
+                      const pace_t *pace, const tlb_cfg_t *tlb, const lc_cfg_t *lc, const pf_cfg_t *pf,
+                      const fa_cfg_t *fa, const swap_cfg_t *sw, const disk_cfg_t *disk, uint32_t quantum, int async)
+{
+    int k = refs->k, m = refs->m;
+    int m_req = m; /* what master passes every process as m_req */
+    void *sm1 = malloc(sm1_bytes_for_k_m(k, m));
+    free_frame_list_t *ffl = malloc(sm2_bytes_for_f(f));
+    mmu_core_t core;
+    if (!sm1 || !ffl || pt_init_all(sm1, k, m) != 0 || ffl_init(ffl, f) != 0 ||
+        mmu_core_init(&core, sm1, ffl, k, m, f, policy, global, refs) != 0)
+    {
+        fprintf(stderr, "vms-replay: cannot set up policy '%s' (have: %s)\n", policy, policy_names());
+        free(sm1);
+        free(ffl);
+        return -1;
+    }
+    core.pace = *pace;
+    core.async = async;
+    core.around = *fa;
+    if (tlb->entries > 0 && !(core.tlb = tlb_create(tlb, k)))
+    {
+        fprintf(stderr, "vms-replay: cannot create the TLB\n");
+        mmu_core_destroy(&core);
+        free(sm1);
+        free(ffl);
+        return -1;
+    }
+    uint32_t *pos = calloc((size_t)k, sizeof(uint32_t));
+    if (!pos || (lc->mode != LC_NONE && !(core.lc = lc_create(lc, k, m))) ||
+        (pf->depth > 0 && !(core.pf = pf_create(pf, k))) || (sw->enabled && !(core.swap = swap_create(sw, disk, k, m))))
+    {
+        fprintf(stderr, "vms-replay: cannot set up load control, prefetching or swap\n");
+        free(pos);
+        mmu_core_destroy(&core);
+        free(sm1);
+        free(ffl);
+        return -1;
+    }
+    TRACE_EV(TRACE_EV_RUN, 0, -1, run, f, 0);
+
+    long long n = 0;
+    int live = k;
+    double t0 = now_sec();
+    while (live > 0)
+    {
+        int ran = 0;
+        for (int pid = 0; pid < k; ++pid)
+        {
+            const int32_t *r = refs_of(refs, pid);
+            uint32_t len = refs->len[pid];
+            if (pos[pid] > len || (core.lc && lc_suspended(core.lc, pid)))
+                continue;
+            if (mmu_core_blocked(&core, pid))
+                continue;
+            ran = 1;
+            uint32_t end = quantum && len - pos[pid] > quantum ? pos[pid] + quantum : len;
+            while (pos[pid] < end)
+            {
+                int pfh;
+                if (pace->mode == PACE_REAL)
+                    pace_wait(pace);
+                if (mmu_resolve(&core, pid, r[pos[pid]], m_req, &pfh) == MMU_INVALID_PAGE)
+                {
+                    pos[pid] = len;
+                    break;
+                }
+                pos[pid]++;
+                n++;
+                if (pfh && async)
+                    break; /* blocked until the page arrives */
+            }
+            if (pos[pid] == len)
+            {
+                pos[pid] = len + 1; /* done */
+                mmu_core_exit(&core, pid);
+                live--;
+            }
+        }
+        if (!ran)
+            mmu_core_idle(&core);
+    }
+    double dt = now_sec() - t0;
+    free(pos);
+
+    mmu_core_print_stats(&core);
+    LOG("policy=%s k=%d m=%d f=%d refs=%lld time=%.3fs rate=%.2f Mref/s",
+        core.pol->name, k, m, f, n, dt, dt > 0 ? n / dt / 1e6 : 0.0);
+
+    mmu_core_destroy(&core);
+    free(sm1);
+    free(ffl);
+    return 0;
+}
+
+/* Write the miss-ratio curves of 'refs' to path (- = stdout), exact or,
+ * with cap > 0, sampled. Returns 0 on success. */
+static int write_mrc(const refs_t *refs, const char *path, int cap)
+{
+    mrc_t mrc;
+    double t0 = now_sec();
+    if ((cap > 0 ? mrc_build_sampled(refs, cap, &mrc) : mrc_build(refs, &mrc)) != 0)
+    {
+        fprintf(stderr, "vms-replay: out of memory for the miss-ratio curves\n");
+        return -1;
+    }
+    double dt = now_sec() - t0;
+    FILE *fp = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+    int rc = fp ? mrc_write_csv(&mrc, fp) : -1;
+    if (fp && fp != stdout && fclose(fp) != 0)
+        rc = -1;
+    if (rc != 0)
+        perror(path);
+    else if (cap > 0)
+        LOG("mrc k=%d m=%d refs=%llu rows=%d cap=%d rate=%.6f time=%.3fs", refs->k, refs->m,
+            (unsigned long long)mrc.refs[refs->k], mrc.rows, cap, mrc.rate[refs->k], dt);
+    else
+        LOG("mrc k=%d m=%d refs=%llu rows=%d time=%.3fs", refs->k, refs->m,
+            (unsigned long long)mrc.refs[refs->k], mrc.rows, dt);
+    mrc_free(&mrc);
+    return rc;
+}
+
+static int usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s [-p policy[,policy...]] [-g] [-q quantum] [-A] [-L loadctl] [-F prefetch] [-R around] [-D swap] [-I iosched] [-t trace_dir] [-P pace] [-T tlb] <refs_file> <f>\n"
+                    "       %s -m <csv|-> [-S cap] <refs_file>\n", prog, prog);
+    return 1;
+}
+
+int main(int argc, char **argv)
+{
+    char *policies = "lru";
+    int global = 0;
+    const char *trace_dir = NULL;
+    const char *mrc_path = NULL;
+    int mrc_cap = 0;
+    pace_t pace = {0};
+    tlb_cfg_t tlb = {0};
+    lc_cfg_t lc = {0};
+    pf_cfg_t pf = {0};
+    fa_cfg_t fa = {0};
+    swap_cfg_t sw = {0};
+    disk_cfg_t disk = {0};
+    long quantum = 0;
+    int async = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "+AD:F:gI:L:m:p:P:q:R:S:t:T:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'A':
+            async = 1;
+            break;
+        case 'p':
+            policies = optarg;
+            break;
+        case 'g':
+            global = 1;
+            break;
+        case 'P':
+            if (pace_parse(optarg, &pace) != 0)
+                return usage(argv[0]);
+            break;
+        case 'T':
+            if (tlb_parse(optarg, &tlb) != 0)
+                return usage(argv[0]);
+            break;
+        case 'L':
+            if (lc_parse(optarg, &lc) != 0)
+                return usage(argv[0]);
+            break;
+        case 'F':
+            if (pf_parse(optarg, &pf) != 0)
+                return usage(argv[0]);
+            break;
+        case 'R':
+            if (fa_parse(optarg, &fa) != 0)
+                return usage(argv[0]);
+            break;
+        case 'D':
+            if (swap_parse(optarg, &sw) != 0)
+                return usage(argv[0]);
+            break;
+        case 'I':
+            if (disk_parse(optarg, &disk) != 0)
+                return usage(argv[0]);
+            break;
+        case 'q':
+            quantum = atol(optarg);
+            if (quantum < 0 || quantum > UINT32_MAX)
+                return usage(argv[0]);
+            break;
+        case 't':
+            trace_dir = optarg;
+            break;
+        case 'm':
+            mrc_path = optarg;
+            break;
+        case 'S':
+            mrc_cap = atoi(optarg);
+            if (mrc_cap <= 0)
+                return usage(argv[0]);
+            break;
+        default:
+            return usage(argv[0]);
+        }
+    }
+    if (argc - optind != (mrc_path ? 1 : 2) || (mrc_cap && !mrc_path))
+        return usage(argv[0]);
+    int f = mrc_path ? 0 : atoi(argv[optind + 1]);
+    if ((!mrc_path && f <= 0) || (async && pace.mode != PACE_VIRTUAL) || (disk.enabled && !sw.enabled))
+        return usage(argv[0]);
+
+    refs_t refs;
+    if (refs_load(argv[optind], &refs) != 0)
+        return 1;
+    if (mrc_path)
+    {
+        int rc = write_mrc(&refs, mrc_path, mrc_cap) != 0;
+        refs_free(&refs);
+        return rc;
+    }
+
+    if (trace_dir)
+    {
+        if (mkdir(trace_dir, 0777) == -1 && errno != EEXIST)
+        {
+            perror(trace_dir);
+            return 1;
+        }
+        setenv(TRACE_ENV, trace_dir, 1);
+        if (trace_open("replay", 0) != 0)
+            return 1;
+    }
+
+    int rc = 0;
+    int run = 0;
+    for (char *save = NULL, *name = strtok_r(policies, ",", &save); name;
+         name = strtok_r(NULL, ",", &save))
+    {
+        if (replay_one(&refs, f, name, global, run++, &pace, &tlb, &lc, &pf, &fa, &sw, &disk, (uint32_t)quantum, async) != 0)
+            rc = 1;
+    }
+    refs_free(&refs);
+    return rc;
+}
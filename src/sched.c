@@ -7,6 +7,17 @@
  *   3. Send SIGCONT to that process.
  *   4. Listen for MMU notifications on MQ2 until that process ends.
  *   5. Repeat until all processes are done.
+ *
+ * The MMU's load control (loadctl.h) may ask to suspend or resume a process
+ * (SCHED_NOTE_SUSPEND / SCHED_NOTE_RESUME); it gets SIGSTOP / SIGCONT. Only
+ * a process that already ran holds frames, and load control never suspends
+ * the process whose fault it is handling, so under FCFS the target is never
+ * the process being waited for.
+ *
+ * With -A (the MMU's asynchronous faults) a process that faults waits for
+ * its page without holding the CPU: every fault note also dispatches the
+ * next process from the ready queue, as does a suspension, so the processes
+ * started so far overlap their page I/O with each other's references.
  */
 
 #include <stdio.h>
@@ -19,35 +30,29 @@
 #include "types.h"
 #include "scheduler.h"
 
-#define LOG(fmt, ...)                                        \
-    do                                                       \
-    {                                                        \
-        fprintf(stdout, "[SCHED] " fmt "\n", ##__VA_ARGS__); \
-        fflush(stdout);                                      \
-    } while (0)
+#define TRACE_TAG "SCHED"
+#include "trace.h"
 
 /* Track finished processes */
 static int finished_count = 0;
 
-int scheduler_run(int mq_ready_key, int mq_sched_key, int num_procs)
-{
-    ipc_mqid_t mq_ready = ipc_create_mq((key_t)mq_ready_key, 0666);
-    if (mq_ready == -1)
-    {
-        perror("msgget(mq_ready)");
-        return 1;
-    }
-
-    ipc_mqid_t mq_sched = ipc_create_mq((key_t)mq_sched_key, 0666);
-    if (mq_sched == -1)
-    {
-        perror("masget(mq_sched)");
-        return 1;
-    }
+/* OS pid of each p_ind, learned from the ready queue (0 = not seen yet) */
+static pid_t *os_pids;
 
-    LOG("Scheduler started (FCFS)");
+/* Stop or continue p_ind for the MMU's load control */
+static void apply_load_note(int p_ind, int what, int num_procs)
+{
+    pid_t pid = p_ind >= 0 && p_ind < num_procs ? os_pids[p_ind] : 0;
+    LOG("MMU %s process p_ind=%d (load control)", what == SCHED_NOTE_SUSPEND ? "suspends" : "resumes", p_ind);
+    if (pid > 0 && kill(pid, what == SCHED_NOTE_SUSPEND ? SIGSTOP : SIGCONT) == -1 && errno != ESRCH)
+        perror("kill(load control)");
+}
 
-    while (finished_count < num_procs)
+/* Take the next process from the ready queue and start it.
+ * Returns 0 on success, -1 if the ready queue failed. */
+static int dispatch(ipc_mqid_t mq_ready, int num_procs, const pace_t *pace)
+{
+    for (;;)
     {
         /* Step 1: dequeue next process from ready queue */
         ipc_msg_t reg = {0};
@@ -58,64 +63,137 @@ int scheduler_run(int mq_ready_key, int mq_sched_key, int num_procs)
                 continue;
             }
             perror("recv ready");
-            break;
+            return -1;
         }
         int pid = reg.ints[0];
+        if (reg.ints[1] >= 0 && reg.ints[1] < num_procs)
+            os_pids[reg.ints[1]] = pid;
         LOG("Picked process %d from ready queue", pid);
-        sleep(2);
+        pace_wait(pace);
         /* Step 2: send SIGCONT to start/resume the process */
         if (kill(pid, SIGCONT) == -1)
         {
             perror("kill(SIGCONT)");
             continue;
         }
+        return 0;
+    }
+}
+
+int scheduler_run(int mq_ready_key, int mq_sched_key, int num_procs, ipc_transport_t transport,
+                  const pace_t *pace, int overlap)
+{
+    ipc_mqid_t mq_ready = ipc_create_mq((key_t)mq_ready_key, 0666);
+    if (mq_ready == -1)
+    {
+        perror("msgget(mq_ready)");
+        return 1;
+    }
 
-        for (;;)
+    /* scheduler is the hub of MQ2; the MMU is its only peer */
+    ipc_chan_t ch_sched;
+    if (ipc_chan_open(&ch_sched, transport, (key_t)mq_sched_key, IPC_HUB) == -1)
+    {
+        perror("open(mq_sched)");
+        return 1;
+    }
+    os_pids = calloc((size_t)num_procs, sizeof(pid_t));
+    if (!os_pids)
+    {
+        ipc_chan_close(&ch_sched);
+        return 1;
+    }
+
+    trace_open("sched", 0);
+    LOG("Scheduler started (FCFS%s)", overlap ? ", switching on faults" : "");
+
+    int dispatched = 0;
+    if (num_procs > 0 && dispatch(mq_ready, num_procs, pace) == 0)
+        dispatched++;
+    while (finished_count < num_procs)
+    {
+        ipc_msg_t note = {0};
+        if (ipc_chan_recv(&ch_sched, &note, sizeof(note), MSGTYPE_SCHED_NOTIFY) == -1)
         {
-            ipc_msg_t note = {0};
-            if (ipc_recv_msg(mq_sched, &note, MSGTYPE_SCHED_NOTIFY) == -1)
+            if (errno == EINTR)
             {
-                if (errno == EINTR)
-                {
-                    continue;
-                }
-                perror("recv sched");
-                break;
+                continue;
             }
+            perror("recv sched");
+            break;
+        }
 
-            int from_pid = note.ints[0];
-            int pfh = note.ints[1];
+        int from_pid = note.ints[0];
+        int pfh = note.ints[1];
+        /* Step 3: the CPU is free for the next process when the running one
+         * ends or, with overlap, waits for a page or is suspended */
+        int next = pfh == SCHED_NOTE_DONE;
 
-            if (pfh)
-            {
-                LOG("Process %d: page fault handled", from_pid);
-            }
+        if (pfh == SCHED_NOTE_SUSPEND || pfh == SCHED_NOTE_RESUME)
+        {
+            apply_load_note(from_pid, pfh, num_procs);
+            next = overlap && pfh == SCHED_NOTE_SUSPEND;
+        }
+        if (pfh == SCHED_NOTE_FAULT)
+        {
+            TRACE_EV(TRACE_EV_SCHED_FAULT, 0, from_pid, 0, 0, 0);
+            LOG_DEBUG("Process %d: page fault handled", from_pid);
+            next = overlap;
+        }
 
-            /* End detection convention:
-             * If MMU sends ints[1] = 0 and we already saw end marker from proc,
-             * we can mark it finished.
-             */
-            if (pfh == 0)
-            {
-                LOG("Process %d finished", pid);
-                finished_count++;
+        /* End detection convention:
+         * If MMU sends ints[1] = 0 and we already saw end marker from proc,
+         * we can mark it finished.
+         */
+        if (pfh == SCHED_NOTE_DONE)
+        {
+            pid_t pid = from_pid >= 0 && from_pid < num_procs ? os_pids[from_pid] : 0;
+            TRACE_EV(TRACE_EV_SCHED_DONE, 0, pid, 0, 0, 0);
+            LOG("Process %d finished", pid);
+            finished_count++;
+        }
+        if (next && dispatched < num_procs)
+        {
+            if (dispatch(mq_ready, num_procs, pace) != 0)
                 break;
-            }
+            dispatched++;
         }
     }
     LOG("All %d processes finished, scheduler exiting", num_procs);
+    free(os_pids);
+    ipc_chan_close(&ch_sched);
     return 0;
 }
 
+static int usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s [-A] [-x mq|shm] [-P pace] <mq_ready_key> <mq_sched_key> <num_procs>\n", prog);
+    return 1;
+}
+
 int main(int argc, char **argv)
 {
-    if (argc != 4)
+    ipc_transport_t transport = IPC_TRANSPORT_MQ;
+    pace_t pace = {0};
+    int overlap = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "+Ax:P:")) != -1)
     {
-        fprintf(stderr, "Usage: %s <mq_ready_key> <mq_sched_key> <num_procs>\n", argv[0]);
-        return 1;
+        if (opt == 'A')
+        {
+            overlap = 1;
+            continue;
+        }
+        if (opt == 'x' && ipc_transport_parse(optarg, &transport) == 0)
+            continue;
+        if (opt == 'P' && pace_parse(optarg, &pace) == 0)
+            continue;
+        return usage(argv[0]);
     }
-    int mq_ready_key = atoi(argv[1]);
-    int mq_sched_key = atoi(argv[2]);
-    int num_procs = atoi(argv[3]);
-    return scheduler_run(mq_ready_key, mq_sched_key, num_procs);
+    if (argc - optind != 3)
+        return usage(argv[0]);
+    int mq_ready_key = atoi(argv[optind]);
+    int mq_sched_key = atoi(argv[optind + 1]);
+    int num_procs = atoi(argv[optind + 2]);
+    return scheduler_run(mq_ready_key, mq_sched_key, num_procs, transport, &pace, overlap);
 }
\ No newline at end of file
@@ -0,0 +1,219 @@
+/* swap.c
+ * Swap device model (see swap.h).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "swap.h"
+
+/* One unsigned field of a spec, at most 'max'; advances *s past it */
+static int parse_field(const char **s, uint64_t max, uint64_t *out)
+{
+    char *end;
+    if (**s < '0' || **s > '9')
+        return -1;
+    unsigned long long v = strtoull(*s, &end, 10);
+    if (v > max)
+        return -1;
+    *out = v;
+    *s = end;
+    return 0;
+}
+
+int swap_parse(const char *spec, swap_cfg_t *out)
+{
+    swap_cfg_t c = {0, SWAP_READ_NS, SWAP_WRITE_NS, 0, 0, 0};
+    size_t name_len = strcspn(spec, ":");
+    const char *args = spec[name_len] == ':' ? spec + name_len + 1 : NULL;
+
+    if (name_len == 4 && strncmp(spec, "none", 4) == 0)
+    {
+        if (args)
+            return -1;
+        *out = c;
+        return 0;
+    }
+    if (name_len != 4 || strncmp(spec, "swap", 4) != 0)
+        return -1;
+    c.enabled = 1;
+    const uint64_t max[5] = {UINT32_MAX, UINT32_MAX, 1u << 30, 1u << 30, SWAP_MAX_READAHEAD};
+    uint64_t v[5] = {c.read_ns, c.write_ns, 0, 0, 0};
+    for (int i = 0; args && i < 5; i++)
+    {
+        if (*args != ',' && parse_field(&args, max[i], &v[i]) != 0)
+            return -1;
+        if (*args == '\0')
+            args = NULL;
+        else if (*args++ != ',' || i == 4)
+            return -1;
+    }
+    c.read_ns = (uint32_t)v[0];
+    c.write_ns = (uint32_t)v[1];
+    c.slots = (int)v[2];
+    c.cluster = (int)v[3];
+    c.readahead = (int)v[4];
+    *out = c;
+    return 0;
+}
+
+swap_t *swap_create(const swap_cfg_t *cfg, const disk_cfg_t *disk, int k, int m)
+{
+    if (!cfg->enabled || k <= 0 || m <= 0 || cfg->slots < 0)
+        return NULL;
+    swap_t *sw = calloc(1, sizeof(*sw));
+    if (!sw)
+        return NULL;
+    sw->cfg = *cfg;
+    sw->k = k;
+    sw->m = m;
+    sw->nslots = cfg->slots ? cfg->slots : k * m;
+    sw->slot = malloc((size_t)k * m * sizeof(*sw->slot));
+    sw->owner = malloc((size_t)sw->nslots * sizeof(*sw->owner));
+    sw->map = calloc(((size_t)sw->nslots + 63) / 64, sizeof(*sw->map));
+    sw->cl_next = calloc((size_t)k, sizeof(*sw->cl_next));
+    sw->cl_end = calloc((size_t)k, sizeof(*sw->cl_end));
+    sw->disk = disk_create(disk, sw->nslots, cfg->read_ns, cfg->write_ns, k);
+    if (!sw->slot || !sw->owner || !sw->map || !sw->cl_next || !sw->cl_end || !sw->disk)
+    {
+        swap_destroy(sw);
+        return NULL;
+    }
+    for (size_t i = 0; i < (size_t)k * m; ++i)
+        sw->slot[i] = -1;
+    for (int s = 0; s < sw->nslots; ++s)
+        sw->owner[s] = -1;
+    return sw;
+}
+
+void swap_destroy(swap_t *sw)
+{
+    if (!sw)
+        return;
+    free(sw->slot);
+    free(sw->owner);
+    free(sw->map);
+    free(sw->cl_next);
+    free(sw->cl_end);
+    disk_destroy(sw->disk);
+    free(sw);
+}
+
+static inline int slot_used(const swap_t *sw, int s)
+{
+    return (sw->map[s / 64] >> (s % 64)) & 1;
+}
+
+static inline void slot_take(swap_t *sw, int s)
+{
+    sw->map[s / 64] |= 1ull << (s % 64);
+    sw->used++;
+}
+
+static inline void slot_free(swap_t *sw, int s)
+{
+    sw->map[s / 64] &= ~(1ull << (s % 64));
+    sw->used--;
+    sw->owner[s] = -1;
+}
+
+/* First free slot at or after the hint, wrapping around; -1 if full */
+static int slot_alloc(swap_t *sw)
+{
+    if (sw->used == sw->nslots)
+        return -1;
+    int words = (sw->nslots + 63) / 64;
+    int w = sw->hint / 64;
+    /* the hint's word first, without the bits below the hint */
+    uint64_t free_bits = ~sw->map[w] & (~0ull << (sw->hint % 64));
+    for (int i = 0; i <= words; ++i)
+    {
+        if (free_bits)
+        {
+            int s = w * 64 + __builtin_ctzll(free_bits);
+            if (s < sw->nslots)
+            {
+                slot_take(sw, s);
+                sw->hint = s + 1 == sw->nslots ? 0 : s + 1;
+                return s;
+            }
+        }
+        w = w + 1 == words ? 0 : w + 1;
+        free_bits = ~sw->map[w];
+    }
+    return -1;
+}
+
+/* Next free slot of pid's cluster, starting a new cluster (the first
+ * entirely free one from the hint on) when it is used up; any free slot
+ * if no cluster is free, -1 if none is */
+static int cluster_alloc(swap_t *sw, int pid)
+{
+    int n = sw->cfg.cluster;
+    while (sw->cl_next[pid] < sw->cl_end[pid])
+    {
+        int s = sw->cl_next[pid]++;
+        if (!slot_used(sw, s))
+        {
+            slot_take(sw, s);
+            return s;
+        }
+    }
+    int count = sw->nslots / n; /* whole clusters; the slots after them only by slot_alloc */
+    for (int i = 0, c = count ? sw->hint / n % count : 0; i < count; ++i, c = c + 1 == count ? 0 : c + 1)
+    {
+        int first = c * n, s = first;
+        while (s < first + n && !slot_used(sw, s))
+            s++;
+        if (s < first + n)
+            continue;
+        slot_take(sw, first);
+        sw->cl_next[pid] = first + 1;
+        sw->cl_end[pid] = first + n;
+        sw->hint = first + n == sw->nslots ? 0 : first + n;
+        sw->clusters++;
+        return first;
+    }
+    return slot_alloc(sw);
+}
+
+int swap_write(swap_t *sw, int pid, int page, uint64_t at, int waiter)
+{
+    int32_t *slot = &sw->slot[(size_t)pid * sw->m + page];
+    if (sw->cfg.cluster > 1)
+    {
+        /* the old copy is stale: write the page next to pid's latest evictions */
+        if (*slot >= 0)
+            slot_free(sw, *slot);
+        *slot = cluster_alloc(sw, pid);
+    }
+    else if (*slot < 0)
+        *slot = slot_alloc(sw);
+    if (*slot < 0)
+    {
+        sw->full++;
+        return 0;
+    }
+    sw->owner[*slot] = pid * sw->m + page;
+    sw->writes++;
+    disk_submit(sw->disk, *slot, 1, 1, at, waiter);
+    return 1;
+}
+
+void swap_read(swap_t *sw, int slot, int n, uint64_t at, int waiter)
+{
+    sw->reads++;
+    disk_submit(sw->disk, slot, n, 0, at, waiter);
+}
+
+void swap_release(swap_t *sw, int pid)
+{
+    int32_t *slot = sw->slot + (size_t)pid * sw->m;
+    for (int page = 0; page < sw->m; ++page)
+    {
+        if (slot[page] < 0)
+            continue;
+        slot_free(sw, slot[page]);
+        slot[page] = -1;
+    }
+}
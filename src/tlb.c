@@ -0,0 +1,175 @@
+/* tlb.c
+ * Set-associative TLB model (see tlb.h).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "tlb.h"
+
+static const char *repl_names[] = {"lru", "fifo", "random"};
+
+const char *tlb_repl_name(tlb_repl_t repl)
+{
+    return repl <= TLB_REPL_RANDOM ? repl_names[repl] : "?";
+}
+
+int tlb_parse(const char *spec, tlb_cfg_t *out)
+{
+    tlb_cfg_t c = {0, 4, TLB_REPL_LRU, 0, TLB_LOOKUP_NS};
+    if (strcmp(spec, "none") == 0)
+    {
+        c.entries = 0;
+        *out = c;
+        return 0;
+    }
+    char buf[128];
+    if (strlen(spec) >= sizeof(buf))
+        return -1;
+    strcpy(buf, spec);
+
+    int field = 0;
+    for (char *save = NULL, *tok = strtok_r(buf, ",", &save); tok;
+         tok = strtok_r(NULL, ",", &save), field++)
+    {
+        char *end;
+        long v;
+        switch (field)
+        {
+        case 0:
+        case 1:
+        case 4:
+            v = strtol(tok, &end, 10);
+            if (end == tok || *end != '\0' || v < (field == 4 ? 0 : 1) || v > (1L << 24))
+                return -1;
+            if (field == 0)
+                c.entries = (int)v;
+            else if (field == 1)
+                c.ways = (int)v;
+            else
+                c.lookup_ns = (unsigned)v;
+            break;
+        case 2:
+            if (strcmp(tok, "lru") == 0)
+                c.repl = TLB_REPL_LRU;
+            else if (strcmp(tok, "fifo") == 0)
+                c.repl = TLB_REPL_FIFO;
+            else if (strcmp(tok, "random") == 0)
+                c.repl = TLB_REPL_RANDOM;
+            else
+                return -1;
+            break;
+        case 3:
+            if (strcmp(tok, "asid") == 0)
+                c.flush_on_switch = 0;
+            else if (strcmp(tok, "flush") == 0)
+                c.flush_on_switch = 1;
+            else
+                return -1;
+            break;
+        default:
+            return -1;
+        }
+    }
+    if (field == 0 || c.ways > TLB_MAX_WAYS || c.entries % c.ways != 0)
+        return -1;
+    int sets = c.entries / c.ways;
+    if ((sets & (sets - 1)) != 0)
+        return -1;
+    *out = c;
+    return 0;
+}
+
+tlb_t *tlb_create(const tlb_cfg_t *cfg, int k)
+{
+    int sets = cfg->ways > 0 ? cfg->entries / cfg->ways : 0;
+    if (sets <= 0 || (sets & (sets - 1)) != 0 || cfg->ways > TLB_MAX_WAYS || k <= 0)
+        return NULL;
+
+    tlb_t *t = calloc(1, sizeof(*t));
+    if (!t)
+        return NULL;
+    t->cfg = *cfg;
+    t->set_mask = (unsigned)sets - 1;
+    t->k = k;
+    t->rng = 2463534242u;
+    t->tag = malloc((size_t)cfg->entries * sizeof(*t->tag));
+    t->frame = calloc((size_t)cfg->entries, sizeof(*t->frame));
+    t->stamp = calloc((size_t)cfg->entries, sizeof(*t->stamp));
+    t->hits = calloc((size_t)k, sizeof(*t->hits));
+    t->misses = calloc((size_t)k, sizeof(*t->misses));
+    if (!t->tag || !t->frame || !t->stamp || !t->hits || !t->misses)
+    {
+        tlb_destroy(t);
+        return NULL;
+    }
+    tlb_flush(t);
+    t->flushes = 0;
+    return t;
+}
+
+void tlb_destroy(tlb_t *t)
+{
+    if (!t)
+        return;
+    free(t->tag);
+    free(t->frame);
+    free(t->stamp);
+    free(t->hits);
+    free(t->misses);
+    free(t);
+}
+
+void tlb_fill(tlb_t *t, int asid, int page, int frame)
+{
+    int ways = t->cfg.ways;
+    int base = (int)((unsigned)page & t->set_mask) * ways;
+    int way;
+    if (t->cfg.repl == TLB_REPL_RANDOM)
+    {
+        /* an empty way if there is one, else a random one */
+        way = -1;
+        for (int w = 0; w < ways; w++)
+            way = (way < 0 && t->tag[base + w] == TLB_NO_TAG) ? w : way;
+        if (way < 0)
+        {
+            t->rng ^= t->rng << 13;
+            t->rng ^= t->rng >> 17;
+            t->rng ^= t->rng << 5;
+            way = (int)(t->rng % (unsigned)ways);
+        }
+    }
+    else
+    {
+        /* oldest stamp; empty entries have stamp 0 */
+        way = 0;
+        for (int w = 1; w < ways; w++)
+            way = t->stamp[base + w] < t->stamp[base + way] ? w : way;
+    }
+    t->tag[base + way] = tlb_key(asid, page);
+    t->frame[base + way] = frame;
+    t->stamp[base + way] = ++t->clock;
+}
+
+void tlb_invalidate(tlb_t *t, int asid, int page)
+{
+    uint64_t key = tlb_key(asid, page);
+    int base = (int)((unsigned)page & t->set_mask) * t->cfg.ways;
+    for (int w = 0; w < t->cfg.ways; w++)
+    {
+        if (t->tag[base + w] == key)
+        {
+            t->tag[base + w] = TLB_NO_TAG;
+            t->stamp[base + w] = 0;
+            t->shootdowns++;
+        }
+    }
+}
+
+void tlb_flush(tlb_t *t)
+{
+    for (int i = 0; i < t->cfg.entries; i++)
+        t->tag[i] = TLB_NO_TAG;
+    memset(t->stamp, 0, (size_t)t->cfg.entries * sizeof(*t->stamp));
+    t->flushes++;
+}
@@ -0,0 +1,165 @@
+/* trace.c
+ * Ring buffer and background writer behind TRACE_EV (see trace.h).
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "trace.h"
+
+#define TRACE_IDLE_NS 200000  /* writer nap when the ring is empty (0.2 ms) */
+
+trace_ring_t *g_trace = NULL;
+
+static trace_ring_t *ring;     /* owned here; g_trace aliases it while open */
+static FILE *out;
+static pthread_t writer;
+static atomic_int stop;
+
+#if TRACE_LEVEL >= TRACE_LVL_EVENT
+/* Write every record published so far. Returns 0, or -1 on I/O error. */
+static int drain(void)
+{
+    uint64_t t = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint64_t h = atomic_load_explicit(&ring->head, memory_order_acquire);
+    while (t != h)
+    {
+        /* contiguous run up to the end of the array */
+        uint64_t idx = t & (TRACE_RING_RECS - 1);
+        uint64_t n = h - t;
+        if (n > TRACE_RING_RECS - idx)
+            n = TRACE_RING_RECS - idx;
+        if (fwrite(&ring->rec[idx], sizeof(trace_rec_t), n, out) != n)
+            return -1;
+        t += n;
+        atomic_store_explicit(&ring->tail, t, memory_order_release);
+    }
+    return 0;
+}
+
+static void *writer_main(void *arg)
+{
+    (void)arg;
+    const struct timespec nap = {0, TRACE_IDLE_NS};
+    for (;;)
+    {
+        int stopping = atomic_load(&stop);
+        uint64_t before = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        if (drain() != 0)
+        {
+            perror("trace: write");
+            /* the producer drops what it cannot queue from now on */
+            atomic_store_explicit(&ring->failed, 1, memory_order_release);
+            break;
+        }
+        if (stopping)
+            break;
+        if (atomic_load_explicit(&ring->tail, memory_order_relaxed) == before)
+            nanosleep(&nap, NULL);
+    }
+    return NULL;
+}
+#endif
+
+int trace_wait_space(trace_ring_t *r, uint64_t head)
+{
+    if (atomic_load_explicit(&r->failed, memory_order_acquire))
+    {
+        r->dropped++;
+        return -1;
+    }
+    r->stalls++;
+    for (;;)
+    {
+        r->tail_cache = atomic_load_explicit(&r->tail, memory_order_acquire);
+        if (head - r->tail_cache < TRACE_RING_RECS)
+            return 0;
+        if (atomic_load_explicit(&r->failed, memory_order_acquire))
+        {
+            r->dropped++;
+            return -1;
+        }
+        sched_yield();
+    }
+}
+
+int trace_open(const char *comp, int id)
+{
+#if TRACE_LEVEL >= TRACE_LVL_EVENT
+    const char *dir = getenv(TRACE_ENV);
+    if (!dir || !*dir || ring)
+        return 0;
+
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s.%d.trace", dir, comp, id);
+    out = fopen(path, "wb");
+    if (!out)
+    {
+        fprintf(stderr, "trace: cannot open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    setvbuf(out, NULL, _IOFBF, 1 << 20);
+
+    trace_file_hdr_t hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = TRACE_MAGIC;
+    hdr.version = TRACE_VERSION;
+    hdr.rec_bytes = sizeof(trace_rec_t);
+    strncpy(hdr.comp, comp, sizeof(hdr.comp) - 1);
+    hdr.id = id;
+    hdr.os_pid = (int32_t)getpid();
+
+    ring = aligned_alloc(64, sizeof(trace_ring_t));
+    if (!ring || fwrite(&hdr, sizeof(hdr), 1, out) != 1)
+        goto fail;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    ring->tail_cache = 0;
+    ring->stalls = 0;
+    ring->dropped = 0;
+    atomic_init(&ring->failed, 0);
+    atomic_store(&stop, 0);
+    if (pthread_create(&writer, NULL, writer_main, NULL) != 0)
+        goto fail;
+
+    g_trace = ring;
+    atexit(trace_close);
+    return 0;
+
+fail:
+    fprintf(stderr, "trace: cannot start tracing to %s\n", path);
+    free(ring);
+    ring = NULL;
+    fclose(out);
+    out = NULL;
+    return -1;
+#else
+    (void)comp;
+    (void)id;
+    return 0;
+#endif
+}
+
+void trace_close(void)
+{
+    if (!ring)
+        return;
+    g_trace = NULL;
+    atomic_store(&stop, 1);
+    pthread_join(writer, NULL);
+    if (ring->stalls)
+        fprintf(stderr, "trace: producer waited for the writer %llu times\n",
+                (unsigned long long)ring->stalls);
+    if (ring->dropped)
+        fprintf(stderr, "trace: %llu records dropped after a write error\n",
+                (unsigned long long)ring->dropped);
+    fclose(out);
+    out = NULL;
+    free(ring);
+    ring = NULL;
+}
@@ -0,0 +1,194 @@
+/* tracedump.c
+ * vms-tracedump: print binary trace files (see trace.h) as text.
+ *
+ * Usage:
+ *   vms-tracedump [-c] <file.trace>...
+ *
+ *   -c : only count events per type
+ *
+ * Lines use the wording of the old per-reference logs, e.g.
+ *   [MMU] p_ind=0 hit page=2 -> frame=1 (ts=19)
+ *   [Process 4242] page=2 -> frame=1
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "trace.h"
+
+static const char *ev_names[TRACE_EV_COUNT] = {
+    [TRACE_EV_HIT] = "hit",
+    [TRACE_EV_FAULT] = "fault",
+    [TRACE_EV_EVICT] = "evict",
+    [TRACE_EV_INVALID] = "invalid",
+    [TRACE_EV_FAIL] = "fail",
+    [TRACE_EV_END] = "end",
+    [TRACE_EV_PROC_REF] = "proc_ref",
+    [TRACE_EV_SCHED_FAULT] = "sched_fault",
+    [TRACE_EV_SCHED_DONE] = "sched_done",
+    [TRACE_EV_RUN] = "run",
+    [TRACE_EV_STEAL] = "steal",
+    [TRACE_EV_RELEASE] = "release",
+    [TRACE_EV_SUSPEND] = "suspend",
+    [TRACE_EV_RESUME] = "resume",
+    [TRACE_EV_PREFETCH] = "prefetch",
+    [TRACE_EV_SWAP_OUT] = "swap_out",
+    [TRACE_EV_SWAP_IN] = "swap_in",
+    [TRACE_EV_READAHEAD] = "readahead",
+    [TRACE_EV_AROUND] = "around",
+};
+
+static void print_rec(const trace_file_hdr_t *hdr, const trace_rec_t *e)
+{
+    unsigned long long ts = (unsigned long long)e->ts;
+    switch (e->type)
+    {
+    case TRACE_EV_HIT:
+        printf("[MMU] p_ind=%d %shit page=%d -> frame=%d (ts=%llu)\n", e->pid, e->aux ? "tlb " : "",
+               e->page, e->frame, ts);
+        break;
+    case TRACE_EV_FAULT:
+        printf("[MMU] p_ind=%d fault page=%d allocated frame=%d (ts=%llu)\n", e->pid, e->page, e->frame, ts);
+        break;
+    case TRACE_EV_EVICT:
+        printf("[MMU] p_ind=%d fault page=%d evicted page=%d -> frame=%d (ts=%llu)\n",
+               e->pid, e->page, e->aux, e->frame, ts);
+        break;
+    case TRACE_EV_INVALID:
+        printf("[MMU] p_ind=%d illegal page=%d (limit=%d)\n", e->pid, e->page, e->aux);
+        break;
+    case TRACE_EV_FAIL:
+        printf("[MMU] p_ind=%d cannot handle fault on page=%d (no free frame, no victim)\n", e->pid, e->page);
+        break;
+    case TRACE_EV_END:
+        printf("[MMU] pid=%d end-of-ref\n", e->pid);
+        break;
+    case TRACE_EV_PROC_REF:
+        printf("[Process %d] page=%d -> frame=%d\n", e->pid, e->page, e->frame);
+        break;
+    case TRACE_EV_SCHED_FAULT:
+        printf("[SCHED] Process %d: page fault handled\n", e->pid);
+        break;
+    case TRACE_EV_SCHED_DONE:
+        printf("[SCHED] Process %d finished\n", e->pid);
+        break;
+    case TRACE_EV_STEAL:
+        printf("[MMU] p_ind=%d lost page=%d frame=%d to p_ind=%d (ts=%llu)\n", e->pid, e->page, e->frame,
+               e->aux, ts);
+        break;
+    case TRACE_EV_RELEASE:
+        printf("[MMU] p_ind=%d released page=%d frame=%d (%s, ts=%llu)\n", e->pid, e->page, e->frame,
+               e->aux == 0 ? "trimmed" : e->aux == 1 ? "suspended" : "exit", ts);
+        break;
+    case TRACE_EV_SUSPEND:
+        printf("[MMU] p_ind=%d suspended, %d frames released (ts=%llu)\n", e->pid, e->aux, ts);
+        break;
+    case TRACE_EV_RESUME:
+        printf("[MMU] p_ind=%d resumed (ts=%llu)\n", e->pid, ts);
+        break;
+    case TRACE_EV_PREFETCH:
+        if (e->aux < 0)
+            printf("[MMU] p_ind=%d prefetch page=%d allocated frame=%d (ts=%llu)\n", e->pid, e->page, e->frame, ts);
+        else
+            printf("[MMU] p_ind=%d prefetch page=%d evicted page=%d -> frame=%d (ts=%llu)\n", e->pid, e->page,
+                   e->aux, e->frame, ts);
+        break;
+    case TRACE_EV_SWAP_OUT:
+        printf("[MMU] p_ind=%d write back page=%d frame=%d -> slot=%d (ts=%llu)\n", e->pid, e->page, e->frame,
+               e->aux, ts);
+        break;
+    case TRACE_EV_SWAP_IN:
+        printf("[MMU] p_ind=%d swap in page=%d slot=%d -> frame=%d (ts=%llu)\n", e->pid, e->page, e->aux,
+               e->frame, ts);
+        break;
+    case TRACE_EV_READAHEAD:
+        printf("[MMU] p_ind=%d readahead page=%d slot=%d -> frame=%d (ts=%llu)\n", e->pid, e->page, e->aux,
+               e->frame, ts);
+        break;
+    case TRACE_EV_AROUND:
+        printf("[MMU] p_ind=%d fault-around page=%d (fault on page=%d) -> frame=%d (ts=%llu)\n", e->pid, e->page,
+               e->aux, e->frame, ts);
+        break;
+    case TRACE_EV_RUN:
+        printf("[%s] run %d f=%d\n", hdr->comp, e->page, e->frame);
+        break;
+    default:
+        printf("[%s] unknown event type=%u\n", hdr->comp, e->type);
+        break;
+    }
+}
+
+/* Decode one file. Returns 0 on success, -1 on a bad file. */
+static int dump(const char *path, int count_only)
+{
+    FILE *in = fopen(path, "rb");
+    if (!in)
+    {
+        perror(path);
+        return -1;
+    }
+    trace_file_hdr_t hdr;
+    if (fread(&hdr, sizeof(hdr), 1, in) != 1 || hdr.magic != TRACE_MAGIC ||
+        hdr.version != TRACE_VERSION || hdr.rec_bytes != sizeof(trace_rec_t))
+    {
+        fprintf(stderr, "%s: not a version %d trace file\n", path, TRACE_VERSION);
+        fclose(in);
+        return -1;
+    }
+    hdr.comp[sizeof(hdr.comp) - 1] = '\0';
+
+    unsigned long long counts[TRACE_EV_COUNT + 1] = {0};
+    unsigned long long total = 0;
+    static trace_rec_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, sizeof(trace_rec_t), 4096, in)) > 0)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            unsigned t = buf[i].type < TRACE_EV_COUNT ? buf[i].type : TRACE_EV_COUNT;
+            counts[t]++;
+            if (!count_only)
+                print_rec(&hdr, &buf[i]);
+        }
+        total += n;
+    }
+    fclose(in);
+
+    if (count_only)
+    {
+        printf("%s: comp=%s id=%d os_pid=%d events=%llu\n", path, hdr.comp, hdr.id, hdr.os_pid, total);
+        for (int t = 1; t <= TRACE_EV_COUNT; t++)
+            if (counts[t])
+                printf("  %-12s %llu\n", t < TRACE_EV_COUNT ? ev_names[t] : "unknown", counts[t]);
+    }
+    return 0;
+}
+
+static int usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s [-c] <file.trace>...\n", prog);
+    return 1;
+}
+
+int main(int argc, char **argv)
+{
+    int count_only = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "c")) != -1)
+    {
+        if (opt == 'c')
+            count_only = 1;
+        else
+            return usage(argv[0]);
+    }
+    if (optind >= argc)
+        return usage(argv[0]);
+
+    int rc = 0;
+    for (int i = optind; i < argc; i++)
+        if (dump(argv[i], count_only) != 0)
+            rc = 1;
+    return rc;
+}
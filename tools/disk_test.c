@@ -0,0 +1,122 @@
+/* disk_test.c
+ * Service order of the disk schedulers on fixed request queues.
+ *
+ * Build:
+ *   make disk_test
+ *
+ * Run:
+ *   ./disk_test
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "disk.h"
+
+#define NSLOTS 200
+#define START  53
+
+typedef struct {
+    int slot;
+    int write;
+    uint64_t at;
+} req_t;
+
+/* Serve reqs (one slot each) under spec with the head parked on START, the
+ * order of the slots served in order[]; returns how many were served */
+static int serve(const char *spec, const req_t *reqs, int n, int *order)
+{
+    disk_cfg_t cfg;
+    if (disk_parse(spec, &cfg) != 0)
+        return -1;
+    disk_t *d = disk_create(&cfg, NSLOTS, 100, 100, 1);
+    if (!d)
+        return -1;
+    /* busy with START until well after every arrival below */
+    disk_submit(d, START, 1, 0, 0, -1);
+    disk_step(d);
+    for (int i = 0; i < n; ++i)
+        disk_submit(d, reqs[i].slot, 1, reqs[i].write, reqs[i].at, 0);
+    int served = 0;
+    while (d->len > 0 && served < n)
+    {
+        disk_step(d);
+        order[served++] = d->head;
+    }
+    disk_destroy(d);
+    return served;
+}
+
+static int check(const char *what, const char *spec, const req_t *reqs, int n, const int *want)
+{
+    int order[16];
+    int got = serve(spec, reqs, n, order);
+    int bad = got != n || memcmp(order, want, (size_t)n * sizeof(int)) != 0;
+    if (bad)
+    {
+        printf("%s (%s): served", what, spec);
+        for (int i = 0; i < got; ++i)
+            printf(" %d", order[i]);
+        printf(", expected");
+        for (int i = 0; i < n; ++i)
+            printf(" %d", want[i]);
+        printf("\n");
+    }
+    return bad;
+}
+
+/* The textbook queue, head on 53, everything arrived before the first
+ * pick. LOOK starts upwards (the head's initial direction); C-LOOK wraps
+ * from 183 to the lowest request. */
+static int check_order(void)
+{
+    static const req_t q[] = {{98, 0, 1},  {183, 0, 2}, {37, 0, 3}, {122, 0, 4},
+                              {14, 0, 5},  {124, 0, 6}, {65, 0, 7}, {67, 0, 8}};
+    static const int fifo[] = {98, 183, 37, 122, 14, 124, 65, 67};
+    static const int sstf[] = {65, 67, 37, 14, 98, 122, 124, 183};
+    static const int scan[] = {65, 67, 98, 122, 124, 183, 37, 14};
+    static const int clook[] = {65, 67, 98, 122, 124, 183, 14, 37};
+    int bad = 0;
+    bad += check("textbook queue", "fifo", q, 8, fifo);
+    bad += check("textbook queue", "sstf", q, 8, sstf);
+    bad += check("textbook queue", "scan", q, 8, scan);
+    bad += check("textbook queue", "deadline", q, 8, clook);
+
+    /* a pick only sees what has arrived: 54 comes after the disk is free */
+    static const req_t late[] = {{90, 0, 1}, {54, 0, 100000000}};
+    static const int first[] = {90, 54};
+    bad += check("late arrival", "sstf", late, 2, first);
+    bad += check("late arrival", "scan", late, 2, first);
+    printf("schedulers out of order: %d (expected 0)\n", bad);
+    return bad;
+}
+
+/* deadline: reads go before writes in C-LOOK order until a write expires;
+ * expired requests go first, earliest deadline first, then C-LOOK resumes
+ * from where the head was left */
+static int check_deadline(void)
+{
+    static const req_t q[] = {{90, 1, 2}, {20, 1, 1}, {70, 0, 3}, {60, 0, 4}};
+    static const int reads_first[] = {60, 70, 90, 20};
+    static const int expired_first[] = {20, 90, 60, 70};
+    int bad = 0;
+    bad += check("writes not expired", "deadline", q, 4, reads_first);
+    bad += check("writes expired", "deadline:,,,1000", q, 4, expired_first);
+
+    /* an expired read overtakes the C-LOOK order of the other reads */
+    static const req_t r[] = {{60, 0, 5}, {40, 0, 1}, {70, 0, 6}};
+    static const int look[] = {60, 70, 40};
+    static const int expired[] = {40, 60, 70};
+    bad += check("reads not expired", "deadline", r, 3, look);
+    bad += check("read expired", "deadline:,,1000", r, 3, expired);
+    printf("deadline expiry out of order: %d (expected 0)\n", bad);
+    return bad;
+}
+
+int main(void)
+{
+    int failures = 0;
+    failures += check_order();
+    failures += check_deadline();
+    return failures != 0;
+}
@@ -68,20 +68,103 @@ int main(void)
     pt_touch(sm1, pid, m, 3, ++ts);
 
     /* Now the LRU victim between {3,5} should be 5. */
-    int victim = choose_lru_victim_local(sm1, pid, m);
-    printf("LRU victim for pid=%d is page=%d (expected 5)\n", pid, victim);
+    int victim = lru_victim_local(sm1, pid, m);
+    printf("LRU victim for pid=%d is page=%d (expected 5, scan says %d)\n",
+           pid, victim, choose_lru_victim_local(sm1, pid, m));
 
     /* Evict it: free its frame, invalidate PTE. */
     if (victim >= 0)
     {
-        int frame_to_free = pte_addr(sm1, pid, m, victim)->frame_no;
+        int frame_to_free = pte_frame(pte_addr(sm1, pid, m, victim));
         pt_invalidate(sm1, pid, m, victim);
         ffl_free(ffl, frame_to_free);
         printf("Evicted page=%d, freed frame=%d, FFL count=%d\n",
                victim, frame_to_free, ffl->count);
     }
 
+    /* Random hits/faults/evictions on pid=2: the O(1) list must agree with the
+     * scan, and the frame table must map every resident page back. */
+    frame_entry_t *ft = frame_table(ffl);
+    int mismatches = 0;
+    srand(7);
+    for (int i = 0; i < 10000; ++i)
+    {
+        int page = rand() % m;
+        if (pte_valid(pte_addr(sm1, 2, m, page)))
+        {
+            pt_touch(sm1, 2, m, page, ++ts);
+            continue;
+        }
+        int fr = ffl_alloc(ffl);
+        if (fr < 0)
+        {
+            int v = lru_victim_local(sm1, 2, m);
+            if (v != choose_lru_victim_local(sm1, 2, m))
+                mismatches++;
+            fr = pte_frame(pte_addr(sm1, 2, m, v));
+            pt_invalidate(sm1, 2, m, v);
+            ft_unmap(ft, f, fr);
+        }
+        pt_set_mapping(sm1, 2, m, page, fr, ++ts);
+        ft_map(ft, f, fr, 2, page);
+    }
+    printf("LRU list vs scan mismatches over 10000 refs: %d (expected 0)\n", mismatches);
+
+    int ft_bad = 0, linked = 0, resident = 0;
+    for (int fr = ft_lru(ft, f); fr >= 0 && fr != f; fr = ft[fr].next)
+        linked++;
+    for (int page = 0; page < m; ++page)
+    {
+        pte_t *pte = pte_addr(sm1, 2, m, page);
+        if (!pte_valid(pte))
+            continue;
+        resident++;
+        if (ft[pte_frame(pte)].pid != 2 || ft[pte_frame(pte)].page != page)
+            ft_bad++;
+    }
+    printf("Frame table: %d linked frames (expected %d), %d bad owners (expected 0)\n",
+           linked, resident, ft_bad);
+    ft_bad += linked != resident;
+    mismatches += ft_bad;
+
+    /* Each vectorized scan against the scalar one: odd m (loop tails), sparse
+     * or empty tables, tied and saturated timestamps. */
+    static const char *isas[] = {"sse4.1", "avx2"};
+    void *big = malloc(sm1_bytes_for_k_m(1, 100));
+    for (int i = 0; big && i < 2; ++i)
+    {
+        if (lru_scan_select(isas[i]) != 0)
+        {
+            printf("scan %s: not supported on this CPU\n", isas[i]);
+            continue;
+        }
+        int bad = 0;
+        for (int trial = 0; trial < 20000; ++trial)
+        {
+            int bm = 1 + rand() % 100;
+            pte_t *pt = pt_base_for_pid(big, 0, bm);
+            uint32_t *bts = pt_ts_for_pid(big, 0, bm);
+            int density = rand() % 5; /* 0 = no valid page */
+            for (int p = 0; p < bm; ++p)
+            {
+                if (rand() % 4 < density)
+                    pte_map(&pt[p], p);
+                else
+                    pte_unmap(&pt[p]);
+                bts[p] = trial % 3 == 0 ? UINT32_MAX - (uint32_t)(rand() % 2) : (uint32_t)(rand() % 64);
+            }
+            int got = choose_lru_victim_local(big, 0, bm);
+            lru_scan_select("scalar");
+            if (got != choose_lru_victim_local(big, 0, bm))
+                bad++;
+            lru_scan_select(isas[i]);
+        }
+        printf("scan %s vs scalar mismatches over 20000 tables: %d (expected 0)\n", isas[i], bad);
+        mismatches += bad;
+    }
+    free(big);
+
     free(ffl);
     free(sm1);
-    return 0;
+    return mismatches != 0;
 }
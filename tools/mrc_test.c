@@ -0,0 +1,194 @@
+/* mrc_test.c
+ * Miss-ratio curves of src/mrc.c: the exact ones against LRU replays
+ * through the MMU core, the SHARDS estimates against the exact ones.
+ *
+ * Build:
+ *   make mrc_test
+ *
+ * Run:
+ *   ./mrc_test
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "types.h"
+#include "memory.h"
+#include "mmu_core.h"
+#include "mrc.h"
+#include "refs.h"
+
+enum { K = 3, M = 64, N = 4000 };
+
+static int buf[K][N];
+
+/* Map k reference strings of m pages as a reference file */
+static int load(int k, int m, int *const refs[], const uint32_t lens[], refs_t *out)
+{
+    char path[] = "/tmp/mrc_test.XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0)
+        return -1;
+    close(fd);
+    int rc = refs_write(path, k, m, refs, lens) != 0 || refs_load(path, out) != 0 ? -1 : 0;
+    unlink(path);
+    return rc;
+}
+
+/* Faults of an LRU replay of r with f frames (processes in p_ind order) */
+static long replay(const refs_t *r, int f, int global)
+{
+    int k = r->k, m = r->m;
+    void *sm1 = malloc(sm1_bytes_for_k_m(k, m));
+    free_frame_list_t *ffl = malloc(sm2_bytes_for_f(f));
+    mmu_core_t core;
+    if (!sm1 || !ffl || pt_init_all(sm1, k, m) != 0 || ffl_init(ffl, f) != 0 ||
+        mmu_core_init(&core, sm1, ffl, k, m, f, "lru", global, r) != 0)
+    {
+        free(sm1);
+        free(ffl);
+        return -1;
+    }
+    long faults = 0;
+    for (int pid = 0; pid < k; ++pid)
+    {
+        const int32_t *refs = refs_of(r, pid);
+        for (uint32_t i = 0; i < r->len[pid]; ++i)
+        {
+            int pfh;
+            mmu_resolve(&core, pid, refs[i], m, &pfh);
+        }
+        mmu_core_exit(&core, pid);
+        faults += core.stats[pid].page_faults;
+    }
+    mmu_core_destroy(&core);
+    free(sm1);
+    free(ffl);
+    return faults;
+}
+
+/* Random walk over m pages with some jumps, a different spread per process */
+static void walk(int *refs, int n, int m, int spread, unsigned *seed)
+{
+    int page = rand_r(seed) % m;
+    for (int i = 0; i < n; ++i)
+    {
+        int r = rand_r(seed) % 8;
+        page = r < 6 ? (page + m + rand_r(seed) % (2 * spread + 1) - spread) % m : rand_r(seed) % m;
+        refs[i] = page;
+    }
+}
+
+/* Faults of column c with f frames; past the last row, the cold misses */
+static uint64_t mrc_at(const mrc_t *mrc, int c, int f)
+{
+    return mrc->faults[(size_t)c * mrc->rows + (f <= mrc->rows ? f : mrc->rows) - 1];
+}
+
+/* Each process's column against that process replayed alone with local
+ * LRU, and the global column against all of them with -g */
+static int check_exact(const refs_t *all, refs_t *const alone[])
+{
+    mrc_t mrc;
+    if (mrc_build(all, &mrc) != 0)
+        return 1;
+    const int fs[] = {1, 4, 16, 40, mrc.rows, mrc.rows + 8};
+    int bad = 0, checked = 0;
+    for (int c = 0; c <= K; ++c)
+        for (size_t i = 0; i < sizeof(fs) / sizeof(fs[0]); ++i)
+        {
+            long want = c < K ? replay(alone[c], fs[i], 0) : replay(all, fs[i], 1);
+            if ((long)mrc_at(&mrc, c, fs[i]) != want)
+            {
+                printf("exact mrc column %d f=%d: %llu faults, lru replay %ld\n", c, fs[i],
+                       (unsigned long long)mrc_at(&mrc, c, fs[i]), want);
+                bad++;
+            }
+            checked++;
+        }
+    printf("exact mrc rows unlike the lru replay over %d checks (%d rows): %d (expected 0)\n",
+           checked, mrc.rows, bad);
+    bad += mrc.rows < 40;
+    mrc_free(&mrc);
+    return bad;
+}
+
+/* SHARDS on a trace with a larger footprint: every row of every column
+ * within its reported err of the exact curve, for several caps; with room
+ * for every page nothing is sampled out and the curve is exact */
+static int check_sampled(void)
+{
+    enum { BM = 2048, BN = 100000 };
+    static int big[K][BN];
+    static const int caps[] = {64, 256, 1024, K * BM};
+    unsigned seed = 11;
+    int *strs[K];
+    uint32_t lens[K];
+    for (int pid = 0; pid < K; ++pid)
+    {
+        walk(big[pid], BN, BM, 16 * (pid + 1), &seed);
+        strs[pid] = big[pid];
+        lens[pid] = BN;
+    }
+    refs_t r;
+    mrc_t exact;
+    if (load(K, BM, strs, lens, &r) != 0 || mrc_build(&r, &exact) != 0)
+        return 1;
+    int bad = 0, checked = 0;
+    for (size_t i = 0; i < sizeof(caps) / sizeof(caps[0]); ++i)
+    {
+        mrc_t est;
+        if (mrc_build_sampled(&r, caps[i], &est) != 0)
+            return 1;
+        int whole = est.rate[K] == 1.0;
+        for (int c = 0; c <= K; ++c)
+            for (int f = 1; f <= exact.rows; ++f)
+            {
+                double want = (double)mrc_at(&exact, c, f), got = (double)mrc_at(&est, c, f);
+                double err = est.err[(size_t)c * est.rows + (f <= est.rows ? f : est.rows) - 1];
+                if (whole ? got != want || err != 0 : fabs(got - want) > err)
+                {
+                    if (bad < 8)
+                        printf("shards cap %d column %d f=%d: %.0f faults, exact %.0f, err %.0f\n", caps[i],
+                               c, f, got, want, err);
+                    bad++;
+                }
+                checked++;
+            }
+        bad += whole != (caps[i] >= K * BM);
+        mrc_free(&est);
+    }
+    printf("shards rows outside their err over %d checks: %d (expected 0)\n", checked, bad);
+    mrc_free(&exact);
+    refs_free(&r);
+    return bad;
+}
+
+int main(void)
+{
+    unsigned seed = 7;
+    int *strs[K];
+    uint32_t lens[K];
+    refs_t all, alone[K];
+    refs_t *ap[K];
+    for (int pid = 0; pid < K; ++pid)
+    {
+        walk(buf[pid], N, M, 2 + 4 * pid, &seed);
+        strs[pid] = buf[pid];
+        lens[pid] = N;
+        if (load(1, M, &strs[pid], &lens[pid], &alone[pid]) != 0)
+            return 1;
+        ap[pid] = &alone[pid];
+    }
+    if (load(K, M, strs, lens, &all) != 0)
+        return 1;
+    int failures = 0;
+    failures += check_exact(&all, ap);
+    failures += check_sampled();
+    for (int pid = 0; pid < K; ++pid)
+        refs_free(&alone[pid]);
+    refs_free(&all);
+    return failures != 0;
+}
@@ -0,0 +1,426 @@
+/* policy_test.c
+ * Fault counts of the replacement policies, replayed through the MMU core
+ * the way vms-replay does (FCFS, processes in p_ind order).
+ *
+ * Build:
+ *   make policy_test
+ *
+ * Run:
+ *   ./policy_test
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "types.h"
+#include "memory.h"
+#include "mmu_core.h"
+#include "policy.h"
+#include "refs.h"
+
+/* Map k reference strings of m pages as a reference file */
+static int load(int k, int m, int *const refs[], const uint32_t lens[], refs_t *out)
+{
+    char path[] = "/tmp/policy_test.XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0)
+        return -1;
+    close(fd);
+    int rc = refs_write(path, k, m, refs, lens) != 0 || refs_load(path, out) != 0 ? -1 : 0;
+    unlink(path);
+    return rc;
+}
+
+/* Replay r under 'policy' with f frames, prefetching if pf is not NULL and
+ * with fault-around if fa is not NULL; returns the faults (the summed
+ * counters in *tot), -1 if the policy cannot be set up */
+static long replay(const refs_t *r, const char *policy, int f, int global, const pf_cfg_t *pf,
+                   const fa_cfg_t *fa, proc_stats_t *tot)
+{
+    int k = r->k, m = r->m;
+    void *sm1 = malloc(sm1_bytes_for_k_m(k, m));
+    free_frame_list_t *ffl = malloc(sm2_bytes_for_f(f));
+    mmu_core_t core;
+    if (!sm1 || !ffl || pt_init_all(sm1, k, m) != 0 || ffl_init(ffl, f) != 0 ||
+        mmu_core_init(&core, sm1, ffl, k, m, f, policy, global, r) != 0)
+    {
+        free(sm1);
+        free(ffl);
+        return -1;
+    }
+    if (pf)
+        core.pf = pf_create(pf, k);
+    if (fa)
+        core.around = *fa;
+    long faults = 0;
+    for (int pid = 0; pid < k; ++pid)
+    {
+        const int32_t *refs = refs_of(r, pid);
+        for (uint32_t i = 0; i < r->len[pid]; ++i)
+        {
+            int pfh;
+            mmu_resolve(&core, pid, refs[i], m, &pfh);
+        }
+        mmu_core_exit(&core, pid);
+    }
+    proc_stats_t sum = {0};
+    for (int pid = 0; pid < k; ++pid)
+    {
+        const proc_stats_t *st = &core.stats[pid];
+        faults += st->page_faults;
+        sum.hits += st->hits;
+        sum.page_faults += st->page_faults;
+        sum.prefetched += st->prefetched;
+        sum.prefetch_used += st->prefetch_used;
+        sum.around += st->around;
+    }
+    mmu_core_destroy(&core);
+    free(sm1);
+    free(ffl);
+    if (tot)
+        *tot = sum;
+    return faults;
+}
+
+/* Belady by brute force: on a fault with f pages resident, evict the one
+ * whose next use is furthest (scanning ahead) */
+static long belady(const int *seq, int n, int f)
+{
+    int *res = malloc((size_t)f * sizeof(int));
+    int size = 0;
+    long faults = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        int j;
+        for (j = 0; j < size && res[j] != seq[i]; ++j)
+            ;
+        if (j < size)
+            continue;
+        faults++;
+        if (size < f)
+        {
+            res[size++] = seq[i];
+            continue;
+        }
+        int victim = 0, furthest = -1;
+        for (j = 0; j < size; ++j)
+        {
+            int t;
+            for (t = i + 1; t < n && seq[t] != res[j]; ++t)
+                ;
+            if (t > furthest)
+            {
+                furthest = t;
+                victim = j;
+            }
+        }
+        res[victim] = seq[i];
+    }
+    free(res);
+    return faults;
+}
+
+/* Random walk over m pages with some jumps: enough locality for hits, and
+ * short constant-stride runs that set off prefetching */
+static void walk(int *refs, int n, int m, unsigned *seed)
+{
+    int page = rand_r(seed) % m;
+    for (int i = 0; i < n; ++i)
+    {
+        int r = rand_r(seed) % 8;
+        page = r < 5 ? (page + m + r - 2) % m : rand_r(seed) % m;
+        refs[i] = page;
+    }
+}
+
+static const char *all_policies[] = {"fifo", "lru", "lru-scan", "clock", "esc", "gclock", "arc",
+                                     "car", "mglru", "lirs", "random", "opt"};
+#define N_POLICIES (int)(sizeof(all_policies) / sizeof(all_policies[0]))
+
+/* OPT against brute-force Belady: one process with local replacement, and
+ * three with global replacement (run one after another, so the optimum is
+ * Belady over their concatenated strings). OPT also never faults more
+ * than any other policy. */
+static int check_opt(void)
+{
+    enum { K = 3, M = 12, N = 200 };
+    int bad = 0, worse = 0, runs = 0;
+    int buf[K][N], seq[K * N];
+    int *strs[K] = {buf[0], buf[1], buf[2]};
+    uint32_t lens[K] = {N, N, N};
+    for (unsigned s = 1; s <= 20; ++s)
+    {
+        unsigned seed = s;
+        for (int pid = 0; pid < K; ++pid)
+            walk(buf[pid], N, M, &seed);
+        for (int global = 0; global <= 1; ++global)
+        {
+            int k = global ? K : 1;
+            refs_t r;
+            if (load(k, M, strs, lens, &r) != 0)
+                return 1;
+            for (int pid = 0; pid < k; ++pid)
+                for (int i = 0; i < N; ++i)
+                    seq[pid * N + i] = pid * M + buf[pid][i];
+            for (int f = 1; f <= 8; ++f)
+            {
+                long opt = replay(&r, "opt", f, global, NULL, NULL, NULL);
+                if (opt != belady(seq, k * N, f))
+                    bad++;
+                for (int p = 0; p < N_POLICIES; ++p)
+                {
+                    long other = replay(&r, all_policies[p], f, global, NULL, NULL, NULL);
+                    worse += other >= 0 && other < opt;
+                }
+                runs++;
+            }
+            refs_free(&r);
+        }
+    }
+    printf("opt vs brute-force Belady mismatches over %d runs: %d (expected 0)\n", runs, bad);
+    printf("policies faulting less than opt: %d (expected 0)\n", worse);
+    return bad + worse;
+}
+
+/* Pages mapped ahead of their reference (prefetch, fault-around) must not
+ * move OPT's cursor: OPT keeps at least its hits without them. */
+static int check_opt_ahead(void)
+{
+    enum { K = 3, M = 64, N = 3000 };
+    static int buf[K][N];
+    int *strs[K] = {buf[0], buf[1], buf[2]};
+    uint32_t lens[K] = {N, N, N};
+    pf_cfg_t pf = {4, 1};
+    fa_cfg_t fa = {4, 0};
+    int lower_pf = 0, lower_fa = 0, runs = 0;
+    long prefetched = 0, around = 0;
+    for (unsigned s = 1; s <= 5; ++s)
+    {
+        unsigned seed = s;
+        for (int pid = 0; pid < K; ++pid)
+            walk(buf[pid], N, M, &seed);
+        refs_t r;
+        if (load(K, M, strs, lens, &r) != 0)
+            return 1;
+        for (int global = 0; global <= 1; ++global)
+            for (int f = 8; f <= 32; f += 8)
+            {
+                proc_stats_t base, ahead;
+                replay(&r, "opt", f, global, NULL, NULL, &base);
+                replay(&r, "opt", f, global, &pf, NULL, &ahead);
+                lower_pf += ahead.hits < base.hits;
+                prefetched += ahead.prefetched;
+                replay(&r, "opt", f, global, NULL, &fa, &ahead);
+                lower_fa += ahead.hits < base.hits;
+                around += ahead.around;
+                runs++;
+            }
+        refs_free(&r);
+    }
+    printf("opt with -F 4,evict below its hits without over %d runs: %d (expected 0), %ld pages prefetched\n",
+           runs, lower_pf, prefetched);
+    printf("opt with -R 4 below its hits without over %d runs: %d (expected 0), %ld pages mapped around\n",
+           runs, lower_fa, around);
+    return lower_pf + lower_fa + (prefetched == 0) + (around == 0);
+}
+
+/* Expected faults of one policy on a hand-worked string, with local and
+ * with global replacement */
+typedef struct {
+    const char *policy;
+    int f;
+    long faults[2];
+} expect_t;
+
+/* Replay one process's string under each entry of e, in both modes */
+static int check_string(const char *what, const int *seq, int n, const expect_t *e, int ne)
+{
+    enum { M = 32 };
+    int *strs[1] = {(int *)seq};
+    uint32_t lens[1] = {(uint32_t)n};
+    refs_t r;
+    if (load(1, M, strs, lens, &r) != 0)
+        return 1;
+    int bad = 0;
+    for (int i = 0; i < ne; ++i)
+        for (int global = 0; global <= 1; ++global)
+        {
+            long faults = replay(&r, e[i].policy, e[i].f, global, NULL, NULL, NULL);
+            if (faults != e[i].faults[global])
+            {
+                printf("%s: %s%s f=%d faults %ld (expected %ld)\n", what, e[i].policy,
+                       global ? " -g" : "", e[i].f, faults, e[i].faults[global]);
+                bad++;
+            }
+        }
+    refs_free(&r);
+    printf("%s: %d mismatches (expected 0)\n", what, bad);
+    return bad;
+}
+
+/* The textbook string of Belady's anomaly: FIFO faults more with four
+ * frames than with three, LRU and OPT (stack algorithms) do not. CLOCK's
+ * global hand sweeps the frames in the order they were filled, as in the
+ * textbook, and shows the anomaly too; the local hand sweeps page numbers,
+ * so at f=3 it takes 5 instead of 1 when 3 comes back and faults once more.
+ * With no writes esc's clean pass finds what CLOCK's would. */
+static int check_anomaly(void)
+{
+    static const int seq[] = {1, 2, 3, 4, 1, 2, 5, 1, 2, 3, 4, 5};
+    static const expect_t e[] = {
+        {"fifo", 3, {9, 9}},    {"fifo", 4, {10, 10}}, {"clock", 3, {10, 9}}, {"clock", 4, {10, 10}},
+        {"esc", 3, {10, 9}},    {"esc", 4, {10, 10}},  {"lru", 3, {10, 10}},  {"lru", 4, {8, 8}},
+        {"opt", 3, {7, 7}},     {"opt", 4, {6, 6}},
+    };
+    return check_string("Belady anomaly string", seq, 12, e, sizeof(e) / sizeof(e[0]));
+}
+
+/* MGLRU on hand-worked strings. Without aging (the default interval is
+ * far longer) there is one generation, faults enter it unaccessed and an
+ * accessed page at its LRU end goes round again: on the anomaly string
+ * that gives LRU's 10 and 8 faults. On 1 2 1 3 4 5 1 with 3 frames the
+ * hit on 1 sends it behind 2 and 3 at the fault on 4, so 2 and then 3
+ * are evicted and 1 hits (5 faults). With mglru:3 the pass after the third
+ * access moves 1 to a new generation that 3 and 4 then join behind it;
+ * at the fault on 5 the emptied oldest is retired, the domain ages and 1
+ * is the oldest page, so it faults again (6). */
+static int check_mglru(void)
+{
+    static const int anomaly[] = {1, 2, 3, 4, 1, 2, 5, 1, 2, 3, 4, 5};
+    static const int aged[] = {1, 2, 1, 3, 4, 5, 1};
+    static const expect_t e1[] = {{"mglru", 3, {10, 10}}, {"mglru", 4, {8, 8}}};
+    static const expect_t e2[] = {{"mglru", 3, {5, 5}}, {"mglru:3", 3, {6, 6}}};
+    return check_string("mglru on the anomaly string", anomaly, 12, e1, 2) +
+           check_string("mglru aging", aged, 7, e2, 2);
+}
+
+/* Hot pages 0 and 1 seen twice after a warm-up, a one-time scan of 20
+ * pages, then the hot pages again, with 4 frames: LRU and FIFO lose them
+ * to the scan (4 + 20 + 2 faults). ARC has them in T2 and CAR moves them
+ * there on the first sweep, the scan only churns T1 (4 + 20). */
+static const int hot_scan[] = {0,  1,  2,  3,  0,  1,  0,  1,  10, 11, 12, 13, 14, 15,
+                               16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 0, 1};
+#define HOT_SCAN_LEN (int)(sizeof(hot_scan) / sizeof(hot_scan[0]))
+
+static int check_hot_scan(void)
+{
+    static const expect_t e[] = {
+        {"lru", 4, {26, 26}}, {"fifo", 4, {26, 26}}, {"arc", 4, {24, 24}},
+        {"car", 4, {24, 24}}, {"opt", 4, {24, 24}},
+    };
+    return check_string("hot set and scan", hot_scan, HOT_SCAN_LEN, e, sizeof(e) / sizeof(e[0]));
+}
+
+/* LIRS: a loop over 5 pages, 4 times, with 4 frames. LRU and FIFO evict
+ * every page before its reuse (20 faults). LIRS fills with LIR pages, the
+ * first eviction demotes page 0 to the single HIR slot and takes it; from
+ * then on 1..3 stay LIR and 0 and 4 take turns in the HIR slot, 2 faults a
+ * round (5 + 3 * 2). On the hot set and scan string the warm-up demotes 2
+ * and the scan cycles through the HIR slot, so 0 and 1 stay (24). */
+static int check_lirs(void)
+{
+    static const int loop[] = {0, 1, 2, 3, 4, 0, 1, 2, 3, 4, 0, 1, 2, 3, 4, 0, 1, 2, 3, 4};
+    static const expect_t e1[] = {{"lru", 4, {20, 20}}, {"fifo", 4, {20, 20}}, {"lirs", 4, {11, 11}}};
+    static const expect_t e2[] = {{"lirs", 4, {24, 24}}};
+    return check_string("loop larger than memory", loop, 20, e1, 3) +
+           check_string("lirs on hot set and scan", hot_scan, HOT_SCAN_LEN, e2, 1);
+}
+
+/* Every victim a policy names must be resident, and with local replacement
+ * belong to the faulting process; -1 only when it has nothing resident.
+ * The core's policy calls go through these wrappers. */
+static int (*real_victim)(repl_policy_t *pol, int pid);
+static int (*real_global)(repl_policy_t *pol, int *pid_out);
+static int bad_victims;
+
+static int resident(repl_policy_t *pol, int pid, int page_no)
+{
+    return page_no >= 0 && page_no < pol->m && pte_valid(pte_addr(pol->sm1_base, pid, pol->m, page_no));
+}
+
+static int checked_victim(repl_policy_t *pol, int pid)
+{
+    int page = real_victim(pol, pid);
+    if (page < 0)
+    {
+        for (int p = 0; p < pol->m; ++p)
+            bad_victims += resident(pol, pid, p);
+    }
+    else
+        bad_victims += !resident(pol, pid, page);
+    return page;
+}
+
+static int checked_global(repl_policy_t *pol, int *pid_out)
+{
+    int page = real_global(pol, pid_out);
+    bad_victims += page < 0 || *pid_out < 0 || *pid_out >= pol->k || !resident(pol, *pid_out, page);
+    return page;
+}
+
+static int check_victims(void)
+{
+    enum { K = 3, M = 24, N = 400 };
+    static int buf[K][N];
+    int *strs[K] = {buf[0], buf[1], buf[2]};
+    uint32_t lens[K] = {N, N, N};
+    long picks = 0;
+    bad_victims = 0;
+    for (unsigned s = 1; s <= 5; ++s)
+    {
+        unsigned seed = s;
+        for (int pid = 0; pid < K; ++pid)
+            walk(buf[pid], N, M, &seed);
+        refs_t r;
+        if (load(K, M, strs, lens, &r) != 0)
+            return 1;
+        for (int p = 0; p < N_POLICIES; ++p)
+            for (int global = 0; global <= 1; ++global)
+                for (int f = 4; f <= 16; f += 6)
+                {
+                    void *sm1 = malloc(sm1_bytes_for_k_m(K, M));
+                    free_frame_list_t *ffl = malloc(sm2_bytes_for_f(f));
+                    mmu_core_t core;
+                    if (!sm1 || !ffl || pt_init_all(sm1, K, M) != 0 || ffl_init(ffl, f) != 0 ||
+                        mmu_core_init(&core, sm1, ffl, K, M, f, all_policies[p], global, &r) != 0)
+                        return 1;
+                    real_victim = core.pol->choose_victim;
+                    real_global = core.pol->choose_global;
+                    core.pol->choose_victim = checked_victim;
+                    core.pol->choose_global = checked_global;
+                    /* interleaved, so with -g victims come from other processes */
+                    for (int i = 0; i < N; ++i)
+                        for (int pid = 0; pid < K; ++pid)
+                        {
+                            int pfh;
+                            mmu_resolve(&core, pid, refs_of(&r, pid)[i], M, &pfh);
+                        }
+                    for (int pid = 0; pid < K; ++pid)
+                    {
+                        picks += core.stats[pid].evictions;
+                        mmu_core_exit(&core, pid);
+                    }
+                    mmu_core_destroy(&core);
+                    free(sm1);
+                    free(ffl);
+                }
+        refs_free(&r);
+    }
+    printf("victims not resident (or missing) over %ld evictions: %d (expected 0)\n", picks, bad_victims);
+    return bad_victims + (picks == 0);
+}
+
+int main(void)
+{
+    int failures = 0;
+    failures += check_opt();
+    failures += check_opt_ahead();
+    failures += check_anomaly();
+    failures += check_mglru();
+    failures += check_hot_scan();
+    failures += check_lirs();
+    failures += check_victims();
+    return failures != 0;
+}
@@ -0,0 +1,286 @@
+/* pte_bench.c
+ * Side-by-side benchmark of page-table layouts over a k x m SM1-sized array:
+ *   legacy : 12-byte PTE (three ints)
+ *   packed : 8-byte PTE, packed word + last_used in one struct
+ *   soa-*  : the SM1 layout from types.h (word array + last_used array),
+ *            scanned by each choose_lru_victim_local() implementation the
+ *            CPU supports
+ *
+ * Build:
+ *   gcc -Wall -O2 -I./src/include tools/pte_bench.c src/memory.c -o pte_bench
+ *
+ * Run:
+ *   ./pte_bench [k m]        (default k=256 m=4096)
+ *
+ * Two workloads per layout:
+ *   scan   : LRU victim scan (valid and oldest last_used) over every process
+ *   lookup : random (pid, page) hits: test valid, read frame, write last_used
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include "types.h"
+#include "memory.h"
+
+/* layout before the packed PTE */
+typedef struct {
+    int frame_no;
+    int valid;
+    int last_used;
+} legacy_pte_t;
+
+/* packed PTE with its timestamp alongside (array of structures) */
+typedef struct {
+    pte_t pte;
+    uint32_t last_used;
+} packed_pte_t;
+
+#define SCAN_PASSES 20
+#define LOOKUPS 50000000u
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint32_t rng = 2463534242u;
+static inline uint32_t xorshift32(void)
+{
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+static volatile long long sink;
+
+/* ---- legacy ---- */
+
+static void legacy_fill(legacy_pte_t *pt, size_t n)
+{
+    rng = 2463534242u;
+    for (size_t i = 0; i < n; i++)
+    {
+        int valid = xorshift32() % 4 != 0; /* ~75% resident */
+        pt[i].valid = valid;
+        pt[i].frame_no = valid ? (int)(xorshift32() % 100000) : -1;
+        pt[i].last_used = (int)(xorshift32() >> 1);
+    }
+}
+
+static long long legacy_scan(const legacy_pte_t *pt, int k, int m)
+{
+    long long sum = 0;
+    for (int pid = 0; pid < k; pid++)
+    {
+        const legacy_pte_t *p = pt + (size_t)pid * m;
+        int victim = -1, oldest = 0;
+        for (int i = 0; i < m; i++)
+            if (p[i].valid > 0 && (victim == -1 || p[i].last_used < oldest))
+            {
+                victim = i;
+                oldest = p[i].last_used;
+            }
+        sum += victim;
+    }
+    return sum;
+}
+
+static long long legacy_lookup(legacy_pte_t *pt, int k, int m)
+{
+    long long sum = 0;
+    rng = 88172645u;
+    for (uint32_t i = 0; i < LOOKUPS; i++)
+    {
+        uint32_t r = xorshift32();
+        legacy_pte_t *e = &pt[(size_t)(r % (uint32_t)k) * m + (r >> 12) % (uint32_t)m];
+        if (e->valid > 0)
+        {
+            sum += e->frame_no;
+            e->last_used = (int)i;
+        }
+    }
+    return sum;
+}
+
+/* ---- packed ---- */
+
+static void packed_fill(packed_pte_t *pt, size_t n)
+{
+    rng = 2463534242u;
+    for (size_t i = 0; i < n; i++)
+    {
+        int valid = xorshift32() % 4 != 0;
+        if (valid)
+            pte_map(&pt[i].pte, (int)(xorshift32() % 100000));
+        else
+            pte_unmap(&pt[i].pte);
+        pt[i].last_used = xorshift32() >> 1;
+    }
+}
+
+static long long packed_scan(const packed_pte_t *pt, int k, int m)
+{
+    long long sum = 0;
+    for (int pid = 0; pid < k; pid++)
+    {
+        const packed_pte_t *p = pt + (size_t)pid * m;
+        int victim = -1;
+        uint32_t oldest = 0;
+        for (int i = 0; i < m; i++)
+            if (pte_valid(&p[i].pte) && (victim == -1 || p[i].last_used < oldest))
+            {
+                victim = i;
+                oldest = p[i].last_used;
+            }
+        sum += victim;
+    }
+    return sum;
+}
+
+static long long packed_lookup(packed_pte_t *pt, int k, int m)
+{
+    long long sum = 0;
+    rng = 88172645u;
+    for (uint32_t i = 0; i < LOOKUPS; i++)
+    {
+        uint32_t r = xorshift32();
+        packed_pte_t *e = &pt[(size_t)(r % (uint32_t)k) * m + (r >> 12) % (uint32_t)m];
+        if (pte_valid(&e->pte))
+        {
+            sum += pte_frame(&e->pte);
+            e->last_used = i;
+        }
+    }
+    return sum;
+}
+
+/* ---- soa (SM1) ---- */
+
+static void soa_fill(void *sm1, int k, int m)
+{
+    rng = 2463534242u;
+    for (int pid = 0; pid < k; pid++)
+    {
+        pte_t *pt = pt_base_for_pid(sm1, pid, m);
+        uint32_t *ts = pt_ts_for_pid(sm1, pid, m);
+        for (int i = 0; i < m; i++)
+        {
+            int valid = xorshift32() % 4 != 0;
+            if (valid)
+                pte_map(&pt[i], (int)(xorshift32() % 100000));
+            else
+                pte_unmap(&pt[i]);
+            ts[i] = xorshift32() >> 1;
+        }
+    }
+}
+
+static long long soa_scan(void *sm1, int k, int m)
+{
+    long long sum = 0;
+    for (int pid = 0; pid < k; pid++)
+        sum += choose_lru_victim_local(sm1, pid, m);
+    return sum;
+}
+
+static long long soa_lookup(void *sm1, int k, int m)
+{
+    long long sum = 0;
+    rng = 88172645u;
+    for (uint32_t i = 0; i < LOOKUPS; i++)
+    {
+        uint32_t r = xorshift32();
+        int pid = (int)(r % (uint32_t)k), page = (int)((r >> 12) % (uint32_t)m);
+        pte_t *e = pte_addr(sm1, pid, m, page);
+        if (pte_valid(e))
+        {
+            sum += pte_frame(e);
+            *pte_ts_addr(sm1, pid, m, page) = i;
+        }
+    }
+    return sum;
+}
+
+static void row(const char *name, size_t pte_bytes, size_t sm1_bytes, size_t n,
+                double scan, double lookup, long long victims)
+{
+    printf("%-12s %6zu %12.2f %12.2f %12.3f %12.2f %14lld\n", name, pte_bytes, n * pte_bytes / 1048576.0,
+           sm1_bytes / 1048576.0, scan, lookup, victims);
+}
+
+int main(int argc, char **argv)
+{
+    int k = argc > 2 ? atoi(argv[1]) : 256;
+    int m = argc > 2 ? atoi(argv[2]) : 4096;
+    if (k <= 0 || m <= 0)
+    {
+        fprintf(stderr, "Usage: %s [k m]\n", argv[0]);
+        return 1;
+    }
+    size_t n = (size_t)k * m;
+    size_t links = (size_t)k * (m + 1) * sizeof(lru_link_t);
+    legacy_pte_t *old = malloc(n * sizeof(*old));
+    packed_pte_t *packed = malloc(n * sizeof(*packed));
+    void *sm1 = malloc(sm1_bytes_for_k_m(k, m));
+    if (!old || !packed || !sm1)
+    {
+        perror("malloc");
+        return 1;
+    }
+    legacy_fill(old, n);
+    packed_fill(packed, n);
+    soa_fill(sm1, k, m);
+
+    /* the victims column is the sum of the scan results: equal sums mean
+     * every layout and implementation picked the same pages */
+    printf("k=%d m=%d\n", k, m);
+    printf("%-12s %6s %12s %12s %12s %12s %14s\n", "layout", "pte_B", "ptes_MiB", "sm1_MiB", "scan_ns/pte",
+           "lookup_ns", "victims");
+
+    double t0 = now_sec();
+    long long victims = 0;
+    for (int pass = 0; pass < SCAN_PASSES; pass++)
+        victims = legacy_scan(old, k, m);
+    double scan = (now_sec() - t0) / ((double)SCAN_PASSES * n) * 1e9;
+    t0 = now_sec();
+    sink += legacy_lookup(old, k, m);
+    row("legacy", sizeof(legacy_pte_t), n * sizeof(legacy_pte_t) + links, n, scan,
+        (now_sec() - t0) / LOOKUPS * 1e9, victims);
+
+    t0 = now_sec();
+    for (int pass = 0; pass < SCAN_PASSES; pass++)
+        victims = packed_scan(packed, k, m);
+    scan = (now_sec() - t0) / ((double)SCAN_PASSES * n) * 1e9;
+    t0 = now_sec();
+    sink += packed_lookup(packed, k, m);
+    row("packed", sizeof(packed_pte_t), n * sizeof(packed_pte_t) + links, n, scan,
+        (now_sec() - t0) / LOOKUPS * 1e9, victims);
+
+    t0 = now_sec();
+    sink += soa_lookup(sm1, k, m);
+    double lookup = (now_sec() - t0) / LOOKUPS * 1e9;
+    static const char *isas[] = {"scalar", "sse4.1", "avx2"};
+    for (int i = 0; i < 3; i++)
+    {
+        if (lru_scan_select(isas[i]) != 0)
+            continue;
+        soa_fill(sm1, k, m); /* undo the lookup pass's timestamp writes */
+        t0 = now_sec();
+        for (int pass = 0; pass < SCAN_PASSES; pass++)
+            victims = soa_scan(sm1, k, m);
+        scan = (now_sec() - t0) / ((double)SCAN_PASSES * n) * 1e9;
+        char name[32];
+        snprintf(name, sizeof(name), "soa-%s", isas[i]);
+        row(name, sizeof(pte_t) + sizeof(uint32_t), sm1_bytes_for_k_m(k, m), n, scan, lookup, victims);
+    }
+
+    free(old);
+    free(packed);
+    free(sm1);
+    return 0;
+}
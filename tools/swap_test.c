@@ -0,0 +1,198 @@
+/* swap_test.c
+ * Swap slot clustering and swap-in readahead on fixed eviction sequences.
+ *
+ * Build:
+ *   make swap_test
+ *
+ * Run:
+ *   ./swap_test
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "types.h"
+#include "memory.h"
+#include "mmu_core.h"
+#include "swap.h"
+
+/* Slots given to a sequence of write-backs, with 4-slot clusters on a
+ * 16-slot device. Two processes alternate, so each fills a cluster of its
+ * own; a rewritten page moves to its process's current cluster; once no
+ * cluster is entirely free, any free slot goes; then the device is full. */
+static int check_clusters(void)
+{
+    static const struct {
+        int pid, page, slot;
+    } w[] = {
+        {0, 0, 0},   {1, 0, 4},  {0, 1, 1},  {1, 1, 5},  {0, 2, 2},  {1, 2, 6},  {0, 3, 3},
+        {1, 3, 7},   {0, 4, 8},  {1, 4, 12}, {0, 5, 9},  {1, 5, 13}, /* clusters 2 and 3 */
+        {0, 0, 10},  /* rewrite: slot 0 is freed, the page follows 5 */
+        {0, 6, 11},  /* cluster 2 used up, none free: the first free slot */
+        {0, 7, 0},   {1, 6, 14}, {1, 7, 15}, {1, 8, -1}, /* full */
+    };
+    swap_cfg_t cfg;
+    disk_cfg_t disk;
+    if (swap_parse("swap:,,16,4", &cfg) != 0 || disk_parse("none", &disk) != 0)
+        return 1;
+    swap_t *sw = swap_create(&cfg, &disk, 2, 16);
+    if (!sw)
+        return 1;
+    int bad = 0;
+    for (size_t i = 0; i < sizeof(w) / sizeof(w[0]); ++i)
+    {
+        int written = swap_write(sw, w[i].pid, w[i].page, 0, -1);
+        int slot = swap_slot(sw, w[i].pid, w[i].page);
+        if (slot != w[i].slot || written != (w[i].slot >= 0) ||
+            (slot >= 0 && swap_page(sw, slot, w[i].pid) != w[i].page))
+        {
+            printf("write %zu (p%d page %d): slot %d (expected %d)\n", i, w[i].pid, w[i].page, slot,
+                   w[i].slot);
+            bad++;
+        }
+    }
+    bad += sw->clusters != 4 || sw->full != 1;
+    swap_release(sw, 0);
+    for (int page = 0; page < 8; ++page)
+        bad += swap_slot(sw, 0, page) != -1;
+    bad += sw->used != 8;
+    printf("cluster placement mismatches: %d (expected 0)\n", bad);
+    swap_destroy(sw);
+    return bad;
+}
+
+/* One process of 16 pages on a core with a swap device (readahead window
+ * of 4 slots) and load control 'lc' */
+typedef struct {
+    void *sm1;
+    free_frame_list_t *ffl;
+    mmu_core_t core;
+} rig_t;
+
+enum { M = 16 };
+
+static int rig_init(rig_t *t, int f, const char *lc)
+{
+    swap_cfg_t sw;
+    disk_cfg_t disk;
+    lc_cfg_t lcc;
+    t->sm1 = malloc(sm1_bytes_for_k_m(1, M));
+    t->ffl = malloc(sm2_bytes_for_f(f));
+    if (!t->sm1 || !t->ffl || pt_init_all(t->sm1, 1, M) != 0 || ffl_init(t->ffl, f) != 0 ||
+        swap_parse("swap:,,,,4", &sw) != 0 || disk_parse("none", &disk) != 0 || lc_parse(lc, &lcc) != 0 ||
+        mmu_core_init(&t->core, t->sm1, t->ffl, 1, M, f, "lru", 0, NULL) != 0)
+        return -1;
+    t->core.swap = swap_create(&sw, &disk, 1, M);
+    t->core.lc = lc_create(&lcc, 1, M);
+    return t->core.swap && t->core.lc ? 0 : -1;
+}
+
+static void rig_free(rig_t *t)
+{
+    mmu_core_destroy(&t->core);
+    free(t->sm1);
+    free(t->ffl);
+}
+
+static void ref(rig_t *t, int page)
+{
+    int pfh;
+    mmu_resolve(&t->core, 0, page, M, &pfh);
+}
+
+static int resident(rig_t *t, int page)
+{
+    return pte_valid(pte_addr(t->sm1, 0, M, page));
+}
+
+/* Written pages 0..10 leave a working set of 2 (ws:2) in that order, so
+ * page p sits in slot p. A fault on page 5 reads slots 4..7, the aligned
+ * window around slot 5, and maps 4, 6 and 7 in one request that leaves
+ * the head on 7; 3 and 8 stay out. With f=3 only page 10 stays resident
+ * beside the faulting page, so the FFL runs dry after one page of the
+ * window: a fault on 1 (window 0..3) maps 0 only, reading slots 0..1. */
+static int check_window(void)
+{
+    int bad = 0;
+    for (int f = 16; f >= 3; f -= 13)
+    {
+        rig_t t;
+        if (rig_init(&t, f, "ws:2") != 0)
+            return 1;
+        for (int page = 0; page <= 10; ++page)
+            ref(&t, page | REFS_WRITE);
+        for (int page = 0; page <= 8; ++page)
+            bad += swap_slot(t.core.swap, 0, page) != page;
+        int fault = f == 16 ? 5 : 1;
+        ref(&t, fault);
+        const proc_stats_t *st = &t.core.stats[0];
+        for (int page = 0; page <= 8; ++page)
+        {
+            int in_window = page / 4 == fault / 4;
+            int want = page == fault || (in_window && (f == 16 || page == 0));
+            if (resident(&t, page) != want)
+            {
+                printf("f=%d fault on %d: page %d resident %d (expected %d)\n", f, fault, page,
+                       resident(&t, page), want);
+                bad++;
+            }
+        }
+        int ahead = f == 16 ? 3 : 1, last = f == 16 ? 7 : 1;
+        if (st->readahead != ahead || st->swap_ins != 1 || t.core.swap->disk->head != last)
+        {
+            printf("f=%d fault on %d: %d read ahead (expected %d), head on %d (expected %d)\n", f, fault,
+                   st->readahead, ahead, t.core.swap->disk->head, last);
+            bad++;
+        }
+        rig_free(&t);
+    }
+    printf("readahead window mismatches: %d (expected 0)\n", bad);
+    return bad;
+}
+
+/* pff:0.1,0.4 decides by the references since the previous fault. Pages
+ * 0..3 are written, ten hits later the fault on 4 releases 0..2 to slots
+ * 0..2. A fault on 1 right after (rate 1) takes a free frame and reads 0
+ * and 2 ahead; after three more hits on 4 (rate 1/4) it replaces one of
+ * the process's own pages and reads nothing ahead, though frames are free. */
+static int check_replace(void)
+{
+    int bad = 0;
+    for (int hits = 0; hits <= 3; hits += 3)
+    {
+        rig_t t;
+        if (rig_init(&t, 8, "pff:0.1,0.4") != 0)
+            return 1;
+        for (int page = 0; page <= 3; ++page)
+            ref(&t, page | REFS_WRITE);
+        for (int i = 0; i < 10; ++i)
+            ref(&t, 3);
+        ref(&t, 4);
+        for (int page = 0; page <= 2; ++page)
+            bad += swap_slot(t.core.swap, 0, page) != page;
+        for (int i = 0; i < hits; ++i)
+            ref(&t, 4);
+        ref(&t, 1);
+        int grow = hits == 0;
+        const proc_stats_t *st = &t.core.stats[0];
+        if (st->readahead != 2 * grow || resident(&t, 0) != grow || resident(&t, 2) != grow ||
+            t.ffl->count != (grow ? 3 : 6))
+        {
+            printf("fault on 1 after %d hits: %d read ahead (expected %d), %d frames free\n", hits,
+                   st->readahead, 2 * grow, t.ffl->count);
+            bad++;
+        }
+        rig_free(&t);
+    }
+    printf("readahead when replacing mismatches: %d (expected 0)\n", bad);
+    return bad;
+}
+
+int main(void)
+{
+    int failures = 0;
+    failures += check_clusters();
+    failures += check_window();
+    failures += check_replace();
+    return failures != 0;
+}